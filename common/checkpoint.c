@@ -0,0 +1,229 @@
+/*
+ * checkpoint.c - CS50 crawl checkpoint module
+ *
+ * see checkpoint.h for more information.
+ *
+ * Charlie Childress, February 2022
+ */
+
+#define _GNU_SOURCE       // fsync, fileno, open
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "checkpoint.h"
+#include "file.h"
+
+/**************** file-local global variables ****************/
+static const char* MAGIC = "crawler-checkpoint 2";    // first line of every checkpoint
+static const char* SEEN = "seen";                     // line between the urls and the fingerprints
+
+/**************** global types ****************/
+typedef struct checkpoint {
+  FILE* fp;                   // the temporary file being written
+  char* tmpname;              // its name
+  char* filename;             // the name it gets once committed
+  char* dirname;              // the pageDirectory, to flush the rename
+  bool failed;                // a write has failed
+  bool seen;                  // the fingerprints have begun
+} checkpoint_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static char* pathname(const char* pageDirectory, const char* name);
+static void checkpointFree(checkpoint_t* checkpoint);
+
+/**************** checkpoint_begin() ****************/
+/* see checkpoint.h for description */
+checkpoint_t* checkpoint_begin(const char* pageDirectory, const char* seedURL,
+                               const int maxDepth, const int nextDocID) {
+  if (pageDirectory == NULL || seedURL == NULL) {
+    return NULL;
+  }
+  checkpoint_t* checkpoint = calloc(1, sizeof(checkpoint_t));
+  if (checkpoint == NULL) {
+    return NULL;
+  }
+  checkpoint->tmpname = pathname(pageDirectory, ".checkpoint.tmp");
+  checkpoint->filename = pathname(pageDirectory, ".checkpoint");
+  checkpoint->dirname = strdup(pageDirectory);
+  if (checkpoint->tmpname == NULL || checkpoint->filename == NULL || checkpoint->dirname == NULL
+      || (checkpoint->fp = fopen(checkpoint->tmpname, "w")) == NULL) {
+    checkpointFree(checkpoint);
+    return NULL;
+  }
+  if (fprintf(checkpoint->fp, "%s\n%s\n%d %d\n", MAGIC, seedURL, maxDepth, nextDocID) < 0) {
+    checkpoint->failed = true;
+  }
+  return checkpoint;
+}
+
+/**************** checkpoint_addURL() ****************/
+/* see checkpoint.h for description */
+void checkpoint_addURL(checkpoint_t* checkpoint, const char* url, const int depth) {
+  if (checkpoint != NULL && url != NULL) {
+    if (checkpoint->seen || fprintf(checkpoint->fp, "%d %s\n", depth, url) < 0) {
+      checkpoint->failed = true;
+    }
+  }
+}
+
+/**************** checkpoint_addSeen() ****************/
+/* see checkpoint.h for description */
+void checkpoint_addSeen(checkpoint_t* checkpoint, const uint64_t fingerprint) {
+  if (checkpoint != NULL) {
+    if (!checkpoint->seen) {
+      checkpoint->seen = true;
+      if (fprintf(checkpoint->fp, "%s\n", SEEN) < 0) {
+        checkpoint->failed = true;
+      }
+    }
+    if (fprintf(checkpoint->fp, "%016" PRIx64 "\n", fingerprint) < 0) {
+      checkpoint->failed = true;
+    }
+  }
+}
+
+/**************** checkpoint_commit() ****************/
+/* see checkpoint.h for description */
+bool checkpoint_commit(checkpoint_t* checkpoint) {
+  if (checkpoint == NULL) {
+    return false;
+  }
+  // the data must be on disk before the rename makes it the checkpoint...
+  if (!checkpoint->seen && fprintf(checkpoint->fp, "%s\n", SEEN) < 0) {
+    checkpoint->failed = true;    // no fingerprints, but the file still needs its divider
+  }
+  bool ok = !checkpoint->failed && fflush(checkpoint->fp) == 0 && fsync(fileno(checkpoint->fp)) == 0;
+  ok = (fclose(checkpoint->fp) == 0) && ok;
+  checkpoint->fp = NULL;
+  ok = ok && rename(checkpoint->tmpname, checkpoint->filename) == 0;
+  if (ok) {
+    // ...and the rename itself must be on disk before we count on it
+    int dirfd = open(checkpoint->dirname, O_RDONLY | O_DIRECTORY);
+    if (dirfd >= 0) {
+      fsync(dirfd);
+      close(dirfd);
+    }
+  } else {
+    unlink(checkpoint->tmpname);
+  }
+  checkpointFree(checkpoint);
+  return ok;
+}
+
+/**************** checkpoint_abandon() ****************/
+/* see checkpoint.h for description */
+void checkpoint_abandon(checkpoint_t* checkpoint) {
+  if (checkpoint == NULL) {
+    return;
+  }
+  unlink(checkpoint->tmpname);
+  checkpointFree(checkpoint);
+}
+
+/**************** checkpoint_load() ****************/
+/* see checkpoint.h for description */
+bool checkpoint_load(const char* pageDirectory, char** seedURL, int* maxDepth, int* nextDocID,
+                     void* arg, void (*urlfunc)(void* arg, const char* url, const int depth),
+                     void (*seenfunc)(void* arg, const uint64_t fingerprint)) {
+  if (pageDirectory == NULL || seedURL == NULL || maxDepth == NULL || nextDocID == NULL) {
+    return false;
+  }
+  char* filename = pathname(pageDirectory, ".checkpoint");
+  FILE* fp = filename ? fopen(filename, "r") : NULL;
+  free(filename);
+  if (fp == NULL) {
+    return false;
+  }
+
+  // the header: magic line, seedURL, maxDepth and nextDocID
+  bool ok = false;
+  char* magic = file_readLine(fp);
+  char* seed = file_readLine(fp);
+  char* numbers = file_readLine(fp);
+  char ignore;
+  if (magic != NULL && strcmp(magic, MAGIC) == 0 && seed != NULL && numbers != NULL
+      && sscanf(numbers, "%d %d%c", maxDepth, nextDocID, &ignore) == 2) {
+    ok = true;
+  }
+  free(magic);
+  free(numbers);
+
+  // then one url per line, up to the divider...
+  char* line;
+  bool seen = false;
+  while (ok && !seen && (line = file_readLine(fp)) != NULL) {
+    int depth;
+    int urlStart;
+    if (strcmp(line, SEEN) == 0) {
+      seen = true;
+    } else if (sscanf(line, "%d %n", &depth, &urlStart) != 1 || line[urlStart] == '\0') {
+      ok = false;
+    } else if (urlfunc != NULL) {
+      (*urlfunc)(arg, line + urlStart, depth);
+    }
+    free(line);
+  }
+  // ...and then one fingerprint per line, to the end of the file
+  while (ok && (line = file_readLine(fp)) != NULL) {
+    uint64_t fingerprint;
+    if (sscanf(line, "%" SCNx64 "%c", &fingerprint, &ignore) != 1) {
+      ok = false;
+    } else if (seenfunc != NULL) {
+      (*seenfunc)(arg, fingerprint);
+    }
+    free(line);
+  }
+  ok = ok && seen;    // a checkpoint cut short before the divider is not whole
+  fclose(fp);
+
+  if (ok) {
+    *seedURL = seed;
+  } else {
+    free(seed);
+  }
+  return ok;
+}
+
+/**************** checkpoint_remove() ****************/
+/* see checkpoint.h for description */
+void checkpoint_remove(const char* pageDirectory) {
+  if (pageDirectory != NULL) {
+    char* filename = pathname(pageDirectory, ".checkpoint");
+    if (filename != NULL) {
+      unlink(filename);
+      free(filename);
+    }
+  }
+}
+
+/**************** pathname() ****************/
+/* Return pageDirectory/name in newly allocated memory, which the
+ * caller must free, or NULL if out of memory.
+ */
+static char* pathname(const char* pageDirectory, const char* name) {
+  char* path = malloc(strlen(pageDirectory) + strlen(name) + 2);
+  if (path != NULL) {
+    sprintf(path, "%s/%s", pageDirectory, name);
+  }
+  return path;
+}
+
+/**************** checkpointFree() ****************/
+/* Free the checkpoint and whatever of it has been allocated.
+ */
+static void checkpointFree(checkpoint_t* checkpoint) {
+  if (checkpoint->fp != NULL) {
+    fclose(checkpoint->fp);
+  }
+  free(checkpoint->tmpname);
+  free(checkpoint->filename);
+  free(checkpoint->dirname);
+  free(checkpoint);
+}
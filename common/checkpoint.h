@@ -0,0 +1,118 @@
+/*
+ * checkpoint.h - header file for CS50 crawl checkpoint module
+ *
+ * A checkpoint records how far a crawl has got, in the pageDirectory
+ * next to .crawler, so that a crawl that dies can be resumed rather
+ * than started over: the seedURL and maxDepth it was started with,
+ * the next unused docID, every URL still to be crawled, with its
+ * depth, and the fingerprint (see urlset.h) of every URL seen so far.
+ *
+ * A checkpoint is written to a temporary file, flushed to disk, and
+ * only then renamed over the previous one, so that a crash at any
+ * point leaves either the old checkpoint or the new one, whole.
+ *
+ * File format (.checkpoint), one item per line:
+ *   crawler-checkpoint 2
+ *   seedURL
+ *   maxDepth nextDocID
+ *   depth url              (a url still to be crawled)
+ *   ...
+ *   seen
+ *   fingerprint            (of a url seen, in 16 hex digits)
+ *   ...
+ *
+ * Charlie Childress, February 2022, cs50
+ */
+
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************** global types ****************/
+typedef struct checkpoint checkpoint_t;   // a checkpoint being written
+
+/**************** checkpoint_begin ****************/
+/* Parameters:
+ *  pageDirectory to checkpoint, the seedURL and maxDepth of the
+ *  crawl, and the next unused docID
+ *
+ * Start writing a new checkpoint, to a temporary file; the previous
+ * checkpoint, if any, stays in place until checkpoint_commit.
+ *
+ * Return the checkpoint being written, or NULL on any error
+ */
+checkpoint_t* checkpoint_begin(const char* pageDirectory, const char* seedURL,
+                               const int maxDepth, const int nextDocID);
+
+/**************** checkpoint_addURL ****************/
+/* Parameters:
+ *  checkpoint being written, a url still to be crawled, and its depth
+ *
+ * Record the url. Every url must be added before any fingerprint is.
+ * Ignores a NULL checkpoint or url.
+ */
+void checkpoint_addURL(checkpoint_t* checkpoint, const char* url, const int depth);
+
+/**************** checkpoint_addSeen ****************/
+/* Parameters:
+ *  checkpoint being written, and the fingerprint of a url seen by the
+ *  crawl, whether crawled or not
+ *
+ * Record the fingerprint. Ignores a NULL checkpoint.
+ */
+void checkpoint_addSeen(checkpoint_t* checkpoint, const uint64_t fingerprint);
+
+/**************** checkpoint_commit ****************/
+/* Parameters:
+ *  checkpoint being written
+ *
+ * Flush the checkpoint to disk and make it replace the previous one,
+ * then free it.
+ *
+ * Return true if the new checkpoint is in place
+ * Return false on any error; the previous checkpoint is left in place
+ */
+bool checkpoint_commit(checkpoint_t* checkpoint);
+
+/**************** checkpoint_abandon ****************/
+/* Parameters:
+ *  checkpoint being written
+ *
+ * Throw the checkpoint away, e.g., when what it counts on is not yet on
+ * disk, and free it. The previous checkpoint is left in place.
+ * Ignores a NULL checkpoint.
+ */
+void checkpoint_abandon(checkpoint_t* checkpoint);
+
+/**************** checkpoint_load ****************/
+/* Parameters:
+ *  pageDirectory to read the checkpoint from, pointers to the seedURL
+ *  (which the caller must free), maxDepth, and nextDocID to fill in,
+ *  an arg for the callbacks, urlfunc to call on every url still to be
+ *  crawled, and seenfunc to call on every fingerprint
+ *
+ * Read the last committed checkpoint, calling urlfunc(arg, url, depth)
+ * on every url in it, which is only valid during the call, and
+ * seenfunc(arg, fingerprint) on every fingerprint.
+ *
+ * Return true if the whole checkpoint was read
+ * Return false if there is none or it is malformed
+ */
+bool checkpoint_load(const char* pageDirectory, char** seedURL, int* maxDepth, int* nextDocID,
+                     void* arg, void (*urlfunc)(void* arg, const char* url, const int depth),
+                     void (*seenfunc)(void* arg, const uint64_t fingerprint));
+
+/**************** checkpoint_remove ****************/
+/* Parameters:
+ *  pageDirectory whose checkpoint is no longer needed, e.g., once the
+ *  crawl is complete
+ *
+ * Delete the checkpoint, if any.
+ */
+void checkpoint_remove(const char* pageDirectory);
+
+#endif // __CHECKPOINT_H
@@ -0,0 +1,281 @@
+/*
+ * docmeta.c - CS50 docmeta module
+ *
+ * see docmeta.h for more information.
+ *
+ * Charlie Childress, cs50, February 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "docmeta.h"
+
+/**************** file-local global variables ****************/
+static const char MAGIC[8] = { 'T', 'S', 'E', 'M', 'E', 'T', 'A', '1' };
+static const char MAGIC_FROM[8] = { 'T', 'S', 'E', 'M', 'E', 'T', 'A', '2' };   // entries from a docID past 1
+static const uint64_t NO_URL = UINT64_MAX;    // the urlOffset of a docID with no document
+
+/**************** local types ****************/
+typedef struct header {
+  char magic[8];              // MAGIC, or MAGIC_FROM if a first docID follows
+  uint64_t numEntries;        // entries that follow, for docIDs 1 (or first) on
+} header_t;
+
+typedef struct entry {
+  uint64_t urlOffset;         // where the URL starts in the strings, or NO_URL
+  uint32_t depth;
+  uint32_t length;            // of the HTML, capped at UINT32_MAX
+} entry_t;
+
+/**************** global types ****************/
+typedef struct docmeta {
+  entry_t* entries;           // entries[docID - first]
+  size_t numEntries;
+  int first;                  // the docID of entries[0]; 1 unless built from a later docID
+  char* strings;              // the URLs, each null-terminated
+  size_t stringsLength;
+  size_t entriesRoom;         // while building: room in entries and strings
+  size_t stringsRoom;
+  void* map;                  // once loaded: the mapped file, which entries and strings point into
+  size_t mapLength;
+} docmeta_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static entry_t* entryOf(docmeta_t* meta, const int docID);
+
+/**************** docmeta_new() ****************/
+/* see docmeta.h for description */
+docmeta_t* docmeta_new(void) {
+  docmeta_t* meta = calloc(1, sizeof(docmeta_t));
+  if (meta != NULL) {
+    meta->first = 1;
+  }
+  return meta;
+}
+
+/**************** docmeta_add() ****************/
+/* see docmeta.h for description */
+bool docmeta_add(docmeta_t* meta, const int docID, const char* url, const int depth, const size_t length) {
+  if (meta == NULL || meta->map != NULL || docID < 1 || url == NULL || depth < 0) {
+    return false;
+  }
+  // the table starts at the first docID added, moving up if a lower one comes later
+  size_t below = 0;
+  if (meta->numEntries == 0) {
+    meta->first = docID;
+  } else if (docID < meta->first) {
+    below = meta->first - docID;
+  }
+  size_t at = docID < meta->first ? 0 : (size_t) (docID - meta->first);
+
+  // make room for the entry, marking any docIDs skipped on the way as absent
+  size_t needed = at + 1 > meta->numEntries + below ? at + 1 : meta->numEntries + below;
+  if (needed > meta->entriesRoom) {
+    size_t room = meta->entriesRoom ? meta->entriesRoom : 64;
+    while (room < needed) {
+      room *= 2;
+    }
+    entry_t* entries = realloc(meta->entries, room * sizeof(entry_t));
+    if (entries == NULL) {
+      return false;
+    }
+    meta->entries = entries;
+    meta->entriesRoom = room;
+  }
+  if (below > 0) {
+    memmove(&meta->entries[below], meta->entries, meta->numEntries * sizeof(entry_t));
+    for (size_t i = 0; i < below; i++) {
+      meta->entries[i] = (entry_t) { NO_URL, 0, 0 };
+    }
+    meta->numEntries += below;
+    meta->first = docID;
+  }
+  while (meta->numEntries <= at) {
+    meta->entries[meta->numEntries++] = (entry_t) { NO_URL, 0, 0 };
+  }
+
+  // and for the URL
+  size_t urlLength = strlen(url) + 1;
+  if (meta->stringsLength + urlLength > meta->stringsRoom) {
+    size_t room = meta->stringsRoom ? meta->stringsRoom : 4096;
+    while (room < meta->stringsLength + urlLength) {
+      room *= 2;
+    }
+    char* strings = realloc(meta->strings, room);
+    if (strings == NULL) {
+      return false;
+    }
+    meta->strings = strings;
+    meta->stringsRoom = room;
+  }
+  memcpy(meta->strings + meta->stringsLength, url, urlLength);
+  meta->entries[at] = (entry_t) {
+    meta->stringsLength, depth, length < UINT32_MAX ? length : UINT32_MAX
+  };
+  meta->stringsLength += urlLength;
+  return true;
+}
+
+/**************** docmeta_truncate() ****************/
+/* see docmeta.h for description */
+void docmeta_truncate(docmeta_t* meta, const int lastDocID) {
+  if (meta != NULL && meta->map == NULL && lastDocID >= meta->first - 1
+      && (size_t) (lastDocID - meta->first + 1) < meta->numEntries) {
+    meta->numEntries = lastDocID - meta->first + 1;    // their URLs stay in the strings, but are not written
+  }
+}
+
+/**************** docmeta_write() ****************/
+/* see docmeta.h for description */
+bool docmeta_write(docmeta_t* meta, const char* filename) {
+  if (meta == NULL || filename == NULL) {
+    return false;
+  }
+  FILE* fp = fopen(filename, "w");
+  if (fp == NULL) {
+    return false;
+  }
+  // lay the URLs out in docID order, whatever order they were added in, so that the
+  // file is the same however the table was built
+  entry_t* entries = malloc((meta->numEntries + 1) * sizeof(entry_t));
+  if (entries == NULL) {
+    fclose(fp);
+    return false;
+  }
+  uint64_t offset = 0;
+  for (size_t i = 0; i < meta->numEntries; i++) {
+    entries[i] = meta->entries[i];
+    if (entries[i].urlOffset != NO_URL) {
+      entries[i].urlOffset = offset;
+      offset += strlen(meta->strings + meta->entries[i].urlOffset) + 1;
+    }
+  }
+
+  // a table from docID 1 is written as it always was; one from later says where it starts
+  header_t header;
+  uint64_t first = meta->first;
+  memcpy(header.magic, first > 1 ? MAGIC_FROM : MAGIC, sizeof(MAGIC));
+  header.numEntries = meta->numEntries;
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+         && (first <= 1 || fwrite(&first, sizeof(first), 1, fp) == 1)
+         && fwrite(entries, sizeof(entry_t), meta->numEntries, fp) == meta->numEntries;
+  for (size_t i = 0; ok && i < meta->numEntries; i++) {
+    if (meta->entries[i].urlOffset != NO_URL) {
+      const char* url = meta->strings + meta->entries[i].urlOffset;
+      ok = fwrite(url, 1, strlen(url) + 1, fp) == strlen(url) + 1;
+    }
+  }
+  free(entries);
+  return fclose(fp) == 0 && ok;
+}
+
+/**************** docmeta_load() ****************/
+/* see docmeta.h for description */
+docmeta_t* docmeta_load(const char* filename) {
+  if (filename == NULL) {
+    return NULL;
+  }
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  void* map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(header_t)) {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);    // the mapping keeps the file open
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+
+  // check that it is a docmeta file, and that its parts fit in it
+  const header_t* header = map;
+  size_t size = st.st_size;
+  bool from = memcmp(header->magic, MAGIC_FROM, sizeof(MAGIC_FROM)) == 0;
+  size_t entriesStart = sizeof(header_t) + (from ? sizeof(uint64_t) : 0);
+  uint64_t first = 1;
+  if (from && size >= entriesStart) {
+    memcpy(&first, (char*) map + sizeof(header_t), sizeof(first));
+  }
+  size_t entriesEnd = entriesStart + header->numEntries * sizeof(entry_t);
+  docmeta_t* meta = NULL;
+  if ((from || memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0)
+      && size >= entriesStart && first >= 1 && first <= INT_MAX
+      && header->numEntries <= (size - entriesStart) / sizeof(entry_t)
+      && (entriesEnd == size || ((char*) map)[size - 1] == '\0')
+      && (meta = calloc(1, sizeof(docmeta_t))) != NULL) {
+    meta->map = map;
+    meta->mapLength = size;
+    meta->entries = (entry_t*) ((char*) map + entriesStart);
+    meta->numEntries = header->numEntries;
+    meta->first = first;
+    meta->strings = (char*) map + entriesEnd;
+    meta->stringsLength = size - entriesEnd;
+    return meta;
+  }
+  munmap(map, size);
+  return NULL;
+}
+
+/**************** docmeta_getURL() ****************/
+/* see docmeta.h for description */
+const char* docmeta_getURL(docmeta_t* meta, const int docID) {
+  entry_t* entry = entryOf(meta, docID);
+  return entry ? meta->strings + entry->urlOffset : NULL;
+}
+
+/**************** docmeta_getDepth() ****************/
+/* see docmeta.h for description */
+int docmeta_getDepth(docmeta_t* meta, const int docID) {
+  entry_t* entry = entryOf(meta, docID);
+  return entry ? (int) entry->depth : -1;
+}
+
+/**************** docmeta_getLength() ****************/
+/* see docmeta.h for description */
+size_t docmeta_getLength(docmeta_t* meta, const int docID) {
+  entry_t* entry = entryOf(meta, docID);
+  return entry ? entry->length : 0;
+}
+
+/**************** docmeta_count() ****************/
+/* see docmeta.h for description */
+int docmeta_count(docmeta_t* meta) {
+  return meta && meta->numEntries > 0 ? meta->first + (int) meta->numEntries - 1 : 0;
+}
+
+/**************** docmeta_delete() ****************/
+/* see docmeta.h for description */
+void docmeta_delete(docmeta_t* meta) {
+  if (meta != NULL) {
+    if (meta->map != NULL) {
+      munmap(meta->map, meta->mapLength);
+    } else {
+      free(meta->entries);
+      free(meta->strings);
+    }
+    free(meta);
+  }
+}
+
+/**************** entryOf() ****************/
+/* Return the entry of the docID, or NULL if there is no such document
+ * (or its URL would lie outside the strings, in a damaged file).
+ */
+static entry_t* entryOf(docmeta_t* meta, const int docID) {
+  if (meta == NULL || docID < meta->first || (size_t) (docID - meta->first) >= meta->numEntries) {
+    return NULL;
+  }
+  entry_t* entry = &meta->entries[docID - meta->first];
+  return entry->urlOffset < meta->stringsLength ? entry : NULL;
+}
@@ -0,0 +1,104 @@
+/*
+ * docmeta.h - header file for CS50 docmeta module
+ *
+ * A docmeta is a table of what the querier needs to know about each
+ * document to print it as a result - its URL, the depth the crawler
+ * found it at, and the length of its HTML - indexed by docID. The
+ * indexer builds one as it reads the pages and writes it next to the
+ * index, as <indexFilename>.meta; the querier maps that file once, so
+ * that looking up a result is an array access, not a page file read.
+ *
+ * The file is, in the machine's byte order:
+ *   a header: the 8 bytes "TSEMETA1", then the number of entries, as a
+ *     64-bit integer - or, for a table whose first docID is past 1 (as
+ *     in a segment of the index, see segments.h), "TSEMETA2", the number
+ *     of entries, and that first docID;
+ *   one 16-byte entry per docID, from 1 (or the first) up: the offset of the URL in
+ *     the strings that follow (all ones if there is no such document),
+ *     as a 64-bit integer, then the depth and the HTML length, as
+ *     32-bit integers;
+ *   the URLs, each followed by a '\0'.
+ *
+ * Charlie Childress, February 2022, cs50
+ */
+
+#ifndef __DOCMETA_H
+#define __DOCMETA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct docmeta docmeta_t;
+
+/**************** docmeta_new ****************/
+/* Return a new, empty docmeta to add documents to and write, or NULL
+ * if there are any errors
+ */
+docmeta_t* docmeta_new(void);
+
+/**************** docmeta_add ****************/
+/* Parameters:
+ *  docmeta from docmeta_new, and the docID, URL, depth, and HTML
+ *  length of a document; docIDs may come in any order, and any left
+ *  out have no entry
+ *
+ * Return true if the document was added (replacing any earlier entry
+ * for the docID), false on bad parameters or out of memory
+ */
+bool docmeta_add(docmeta_t* meta, const int docID, const char* url, const int depth, const size_t length);
+
+/**************** docmeta_truncate ****************/
+/* Drop the entries of docIDs past lastDocID, if any, from a docmeta
+ * being built
+ */
+void docmeta_truncate(docmeta_t* meta, const int lastDocID);
+
+/**************** docmeta_write ****************/
+/* Parameters:
+ *  docmeta, and the name of the file to write it to
+ *
+ * Return true if the file was written, false on any error
+ */
+bool docmeta_write(docmeta_t* meta, const char* filename);
+
+/**************** docmeta_load ****************/
+/* Parameters:
+ *  name of a file written by docmeta_write
+ *
+ * Map the file into memory, read-only; lookups read it in place.
+ *
+ * Return the docmeta, or NULL if the file does not exist or is not a
+ * docmeta file
+ */
+docmeta_t* docmeta_load(const char* filename);
+
+/**************** docmeta_getURL ****************/
+/* Return the URL of the docID, which belongs to the docmeta (do not
+ * free it), or NULL if there is no such document
+ */
+const char* docmeta_getURL(docmeta_t* meta, const int docID);
+
+/**************** docmeta_getDepth ****************/
+/* Return the crawl depth of the docID, or -1 if there is no such document
+ */
+int docmeta_getDepth(docmeta_t* meta, const int docID);
+
+/**************** docmeta_getLength ****************/
+/* Return the HTML length of the docID, or 0 if there is no such document
+ */
+size_t docmeta_getLength(docmeta_t* meta, const int docID);
+
+/**************** docmeta_count ****************/
+/* Return the highest docID with an entry, or 0 if none or if meta is
+ * NULL
+ */
+int docmeta_count(docmeta_t* meta);
+
+/**************** docmeta_delete ****************/
+/* Free the docmeta, unmapping its file if loaded. NULL is ignored.
+ */
+void docmeta_delete(docmeta_t* meta);
+
+#endif // __DOCMETA_H
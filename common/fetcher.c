@@ -0,0 +1,863 @@
+/*
+ * fetcher.c - CS50 event-driven page fetching engine
+ *
+ * see fetcher.h for more information.
+ *
+ * Charlie Childress, cs50, February 2022
+ */
+
+#define _GNU_SOURCE       // strndup, strncasecmp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "fetcher.h"
+#include "webpage.h"
+#include "dnscache.h"
+#include "hashtable.h"
+#include "mem.h"
+
+/**************** file-local global variables ****************/
+static const int MAX_TRY = 3;         // maximum attempts to connect, as in webpage_fetch
+static const int HTTP_PORT = 80;      // default web server port
+static const int MAX_EVENTS = 64;     // events handled per epoll_wait
+static const size_t READ_CHUNK = 16384;   // bytes asked of each read()
+
+/**************** local types ****************/
+// the states a connection moves through, in order; a kept-alive
+// connection goes from READING_BODY to IDLE and back to SENDING
+typedef enum connstate {
+  CONNECTING,         // non-blocking connect() in progress
+  SENDING,            // writing the request
+  READING_HEADERS,    // reading the status line and headers
+  READING_BODY,       // reading the page content
+  IDLE                // between requests, waiting in its host's pool
+} connstate_t;
+
+// where a chunked body's decoder is, between reads
+typedef enum chunkstate {
+  CHUNK_SIZE,         // expecting a chunk-size line
+  CHUNK_DATA,         // copying chunk data
+  CHUNK_DATA_END,     // expecting the line end after chunk data
+  CHUNK_TRAILER,      // skipping trailer lines after the last chunk
+  CHUNK_DONE          // the whole body is in
+} chunkstate_t;
+
+// one connection to a server, fetching one page at a time
+typedef struct conn {
+  int fd;                     // the socket, or -1 when not connected
+  connstate_t state;          // where this connection is in the exchange
+  webpage_t* page;            // the page being fetched, or NULL when idle
+  char* key;                  // "host:port", naming the pool it returns to
+  int tries;                  // connection attempts so far
+  bool reused;                // the request went out on a kept-alive connection
+  struct sockaddr_storage addr;   // server address
+  socklen_t addrlen;          // length of addr
+  char* request;              // the HTTP request
+  size_t requestLen;          // length of request
+  size_t requestSent;         // bytes of request written so far
+  char* buf;                  // response bytes read so far
+  size_t len;                 // bytes used in buf
+  size_t cap;                 // bytes allocated to buf
+  size_t bodyStart;           // offset of the body in buf, once headers are read
+  long contentLength;         // Content-Length of the body, or -1 if not given
+  bool chunked;               // the body comes in chunks
+  chunkstate_t chunkState;    // how far the chunked body is decoded
+  size_t chunkLeft;           // bytes of the current chunk still to copy
+  size_t bodyLen;             // decoded bytes of a chunked body, at bodyStart
+  size_t rawPos;              // offset of the first undecoded byte of a chunked body
+  bool keepAlive;             // the server will keep the connection open
+  struct conn* prev;          // neighbors in the fetcher's list of connections
+  struct conn* next;
+  struct conn* nextIdle;      // neighbors in the host's pool, when idle
+  struct conn* prevIdle;
+} conn_t;
+
+// the idle connections to one host
+typedef struct hostpool {
+  conn_t* idle;               // kept-alive connections, most recently used first
+  int numIdle;                // connections in idle
+} hostpool_t;
+
+// a page that is done, fetched or not, waiting for fetcher_next
+typedef struct completion {
+  webpage_t* page;
+  bool success;
+  struct completion* next;
+} completion_t;
+
+/**************** global types ****************/
+typedef struct fetcher {
+  int epfd;                   // epoll instance watching every connection
+  int wakefd;                 // eventfd that fetcher_wake writes to
+  int maxInFlight;            // capacity
+  int inFlight;               // pages submitted and not yet returned
+  conn_t* conns;              // every open connection, fetching or idle
+  hashtable_t* pools;         // "host:port" -> hostpool_t of idle connections
+  completion_t* doneHead;     // completed pages, oldest first
+  completion_t* doneTail;
+} fetcher_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool burst(const char* url, char** hostname, int* port, char** pathname);
+static void setRequest(conn_t* conn, const char* hostname, const char* pathname);
+static bool startConnect(fetcher_t* fetcher, conn_t* conn);
+static void handleEvent(fetcher_t* fetcher, conn_t* conn, const unsigned int events);
+static bool doSend(conn_t* conn);
+static int doRead(conn_t* conn);
+static bool parseHeaders(conn_t* conn, bool* done);
+static bool decodeChunks(conn_t* conn);
+static bool bodyComplete(conn_t* conn);
+static size_t bodyLength(conn_t* conn);
+static void fail(fetcher_t* fetcher, conn_t* conn);
+static void finish(fetcher_t* fetcher, conn_t* conn, const bool success);
+static void park(fetcher_t* fetcher, conn_t* conn);
+static conn_t* unpark(fetcher_t* fetcher, const char* key);
+static void closeConn(fetcher_t* fetcher, conn_t* conn);
+static void hostpoolDelete(void* item);
+static void complete(fetcher_t* fetcher, webpage_t* page, const bool success);
+static void watch(fetcher_t* fetcher, conn_t* conn, const unsigned int events, const int op);
+static long nowMs(void);
+
+/**************** fetcher_new() ****************/
+/* see fetcher.h for description */
+fetcher_t* fetcher_new(const int maxInFlight) {
+  if (maxInFlight < 1) {
+    return NULL;
+  }
+  fetcher_t* fetcher = mem_malloc(sizeof(fetcher_t));
+  if (fetcher == NULL) {
+    return NULL;
+  }
+  // few hosts are expected; the crawler is limited to internal URLs
+  fetcher->pools = hashtable_new(50);
+  fetcher->epfd = epoll_create1(EPOLL_CLOEXEC);
+  fetcher->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fetcher->pools == NULL || fetcher->epfd < 0 || fetcher->wakefd < 0) {   // out of memory or descriptors
+    hashtable_delete(fetcher->pools, NULL);
+    if (fetcher->epfd >= 0) close(fetcher->epfd);
+    if (fetcher->wakefd >= 0) close(fetcher->wakefd);
+    mem_free(fetcher);
+    return NULL;
+  }
+  // the wake descriptor is the only one registered with a NULL pointer
+  struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+  epoll_ctl(fetcher->epfd, EPOLL_CTL_ADD, fetcher->wakefd, &event);
+  fetcher->maxInFlight = maxInFlight;
+  fetcher->inFlight = 0;
+  fetcher->conns = NULL;
+  fetcher->doneHead = NULL;
+  fetcher->doneTail = NULL;
+  return fetcher;
+}
+
+/**************** fetcher_submit() ****************/
+/* see fetcher.h for description */
+bool fetcher_submit(fetcher_t* fetcher, webpage_t* page) {
+  if (fetcher == NULL || page == NULL || webpage_getURL(page) == NULL
+      || webpage_getHTML(page) != NULL || fetcher_isFull(fetcher)) {
+    return false;
+  }
+  fetcher->inFlight++;    // from here on the page comes back through fetcher_next
+
+  // burst the URL; all we care about are hostname, port, and pathname
+  char* hostname;
+  int port;
+  char* pathname;
+  if (!burst(webpage_getURL(page), &hostname, &port, &pathname)) {
+    complete(fetcher, page, false);
+    return true;
+  }
+  char* key = mem_malloc_assert(strlen(hostname) + 16, "key");
+  sprintf(key, "%s:%d", hostname, port);
+
+  // send the request over an idle connection to the same server, if there is one
+  conn_t* conn = unpark(fetcher, key);
+  if (conn != NULL) {
+    mem_free(key);
+    conn->page = page;
+    conn->reused = true;
+    setRequest(conn, hostname, pathname);
+    free(hostname);
+    free(pathname);
+    conn->state = SENDING;
+    watch(fetcher, conn, EPOLLOUT, EPOLL_CTL_MOD);
+    return true;
+  }
+
+  // look up the server; this is the one blocking step, and only on a cache miss
+  conn = mem_calloc_assert(1, sizeof(conn_t), "conn");
+  if (!dnscache_lookup(hostname, port, &conn->addr, &conn->addrlen)) {
+    free(hostname);
+    free(pathname);
+    mem_free(key);
+    mem_free(conn);
+    complete(fetcher, page, false);
+    return true;
+  }
+  conn->fd = -1;
+  conn->page = page;
+  conn->key = key;
+  setRequest(conn, hostname, pathname);
+  free(hostname);
+  free(pathname);
+
+  // link it into the list of connections
+  conn->next = fetcher->conns;
+  if (conn->next != NULL) {
+    conn->next->prev = conn;
+  }
+  fetcher->conns = conn;
+
+  if (!startConnect(fetcher, conn)) {
+    finish(fetcher, conn, false);
+  }
+  return true;
+}
+
+/**************** fetcher_inFlight() ****************/
+/* see fetcher.h for description */
+int fetcher_inFlight(fetcher_t* fetcher) {
+  return fetcher ? fetcher->inFlight : 0;
+}
+
+/**************** fetcher_isFull() ****************/
+/* see fetcher.h for description */
+bool fetcher_isFull(fetcher_t* fetcher) {
+  return fetcher == NULL || fetcher->inFlight >= fetcher->maxInFlight;
+}
+
+/**************** fetcher_next() ****************/
+/* see fetcher.h for description */
+webpage_t* fetcher_next(fetcher_t* fetcher, const int timeoutMs, bool* success) {
+  if (fetcher == NULL || success == NULL) {
+    return NULL;
+  }
+  *success = false;
+  struct epoll_event events[MAX_EVENTS];
+  bool woken = false;
+  // the timeout is for the whole call: events that complete nothing
+  // (a connect, a send, part of a body) must not restart it
+  long deadline = timeoutMs >= 0 ? nowMs() + timeoutMs : -1;
+  // drive the connections until something completes, we are woken, or time runs out
+  while (fetcher->doneHead == NULL && !woken) {
+    long left = deadline >= 0 ? deadline - nowMs() : -1;
+    if (deadline >= 0 && left < 0) {
+      left = 0;     // still look once for events already in
+    }
+    int n = epoll_wait(fetcher->epfd, events, MAX_EVENTS, (int) left);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {   // timed out (or epoll failed)
+      break;
+    }
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.ptr == NULL) {   // fetcher_wake was called
+        uint64_t count;
+        if (read(fetcher->wakefd, &count, sizeof(count)) < 0) {
+          // nothing to drain; another wake already did
+        }
+        woken = true;
+      } else {
+        handleEvent(fetcher, events[i].data.ptr, events[i].events);
+      }
+    }
+    if (deadline >= 0 && nowMs() >= deadline) {
+      break;        // time is up, even if events keep coming
+    }
+  }
+
+  // hand back the oldest completed page, if any
+  completion_t* done = fetcher->doneHead;
+  if (done == NULL) {
+    return NULL;
+  }
+  fetcher->doneHead = done->next;
+  if (fetcher->doneHead == NULL) {
+    fetcher->doneTail = NULL;
+  }
+  webpage_t* page = done->page;
+  *success = done->success;
+  mem_free(done);
+  fetcher->inFlight--;
+  return page;
+}
+
+/**************** fetcher_wake() ****************/
+/* see fetcher.h for description */
+void fetcher_wake(fetcher_t* fetcher) {
+  if (fetcher != NULL) {
+    uint64_t one = 1;
+    if (write(fetcher->wakefd, &one, sizeof(one)) < 0) {
+      // counter is saturated; fetcher_next will wake anyway
+    }
+  }
+}
+
+/**************** fetcher_delete() ****************/
+/* see fetcher.h for description */
+void fetcher_delete(fetcher_t* fetcher) {
+  if (fetcher == NULL) {
+    return;
+  }
+  // fail every connection that is fetching and close every idle one, then delete every page
+  while (fetcher->conns != NULL) {
+    if (fetcher->conns->page != NULL) {
+      finish(fetcher, fetcher->conns, false);
+    } else {
+      closeConn(fetcher, fetcher->conns);
+    }
+  }
+  bool success;
+  webpage_t* page;
+  while ((page = fetcher_next(fetcher, 0, &success)) != NULL) {
+    webpage_delete(page);
+  }
+  hashtable_delete(fetcher->pools, hostpoolDelete);
+  close(fetcher->wakefd);
+  close(fetcher->epfd);
+  mem_free(fetcher);
+}
+
+/**************** burst() ****************/
+/* Parameters:
+ *  a normalized url of form http://host[:port][/pathname], and
+ *  pointers to the hostname, port, and pathname to fill in
+ *
+ * Split the url into the pieces needed to fetch it; the caller
+ * must free the hostname and pathname.
+ *
+ * Return true if successful, false if the url is not of that form
+ */
+static bool burst(const char* url, char** hostname, int* port, char** pathname) {
+  const char* scheme = "http://";
+  if (strncasecmp(url, scheme, strlen(scheme)) != 0) {
+    return false;
+  }
+  const char* host = url + strlen(scheme);
+  size_t hostLen = strcspn(host, ":/");
+  if (hostLen == 0) {
+    return false;
+  }
+  const char* rest = host + hostLen;
+  *port = HTTP_PORT;
+  if (*rest == ':') {   // explicit port
+    char* end;
+    long value = strtol(rest + 1, &end, 10);
+    if (end == rest + 1 || value <= 0 || value > 65535) {
+      return false;
+    }
+    *port = value;
+    rest = end;
+  }
+  if (*rest != '\0' && *rest != '/') {
+    return false;
+  }
+  *hostname = strndup(host, hostLen);
+  *pathname = strdup(*rest == '\0' ? "/" : rest);
+  if (*hostname == NULL || *pathname == NULL) {
+    free(*hostname);
+    free(*pathname);
+    return false;
+  }
+  return true;
+}
+
+/**************** setRequest() ****************/
+/* Prepare the HTTP request for the conn's page, replacing any earlier
+ * one, and reset the conn to read a fresh response. HTTP/1.1 keeps the
+ * connection open unless either side says otherwise.
+ */
+static void setRequest(conn_t* conn, const char* hostname, const char* pathname) {
+  const char* httpFormat = "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n";
+  mem_free(conn->request);
+  conn->requestLen = strlen(httpFormat) + strlen(pathname) + strlen(hostname);
+  conn->request = mem_malloc_assert(conn->requestLen + 1, "request");
+  conn->requestLen = sprintf(conn->request, httpFormat, pathname, hostname);
+  conn->requestSent = 0;
+  conn->len = 0;
+  conn->bodyStart = 0;
+  conn->contentLength = -1;
+  conn->chunked = false;
+  conn->keepAlive = false;
+}
+
+/**************** startConnect() ****************/
+/* Parameters:
+ *  fetcher and the conn to (re)connect
+ *
+ * Open a non-blocking socket to the server and start connecting it;
+ * the connection is watched for writability, which signals the end
+ * of the connect.
+ *
+ * Return true if the connect is under way, false if no more tries
+ * remain or the socket could not be created
+ */
+static bool startConnect(fetcher_t* fetcher, conn_t* conn) {
+  while (conn->tries < MAX_TRY) {
+    conn->tries++;
+    conn->fd = socket(conn->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn->fd < 0) {
+      return false;
+    }
+    conn->state = CONNECTING;
+    if (connect(conn->fd, (struct sockaddr*) &conn->addr, conn->addrlen) == 0 || errno == EINPROGRESS) {
+      watch(fetcher, conn, EPOLLOUT, EPOLL_CTL_ADD);
+      return true;
+    }
+    close(conn->fd);    // refused right away; try again
+    conn->fd = -1;
+  }
+  return false;
+}
+
+/**************** handleEvent() ****************/
+/* Parameters:
+ *  fetcher, a conn with activity, and the epoll events reported
+ *
+ * Advance the conn through its states as far as the socket allows.
+ */
+static void handleEvent(fetcher_t* fetcher, conn_t* conn, const unsigned int events) {
+  if (conn->state == IDLE) {    // the server closed (or wrote to) a connection nobody is using
+    closeConn(fetcher, conn);
+    return;
+  }
+
+  if (conn->state == CONNECTING) {
+    int error = 0;
+    socklen_t errlen = sizeof(error);
+    getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &errlen);
+    if (error != 0) {   // connect failed; retry with a fresh socket
+      epoll_ctl(fetcher->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+      close(conn->fd);
+      conn->fd = -1;
+      if (!startConnect(fetcher, conn)) {
+        finish(fetcher, conn, false);
+      }
+      return;
+    }
+    conn->state = SENDING;
+  }
+
+  if (conn->state == SENDING) {
+    if (!doSend(conn)) {
+      fail(fetcher, conn);
+      return;
+    }
+    if (conn->requestSent < conn->requestLen) {
+      return;   // wait until the socket can take more
+    }
+    conn->state = READING_HEADERS;
+    watch(fetcher, conn, EPOLLIN, EPOLL_CTL_MOD);
+    return;
+  }
+
+  // reading: drain what the socket has
+  int got;
+  while ((got = doRead(conn)) > 0) {
+    if (conn->state == READING_HEADERS) {
+      bool done;
+      if (!parseHeaders(conn, &done)) {
+        finish(fetcher, conn, false);
+        return;
+      }
+      if (done) {
+        conn->state = READING_BODY;
+      }
+    }
+    if (conn->state == READING_BODY && conn->chunked && !decodeChunks(conn)) {
+      finish(fetcher, conn, false);
+      return;
+    }
+    if (conn->state == READING_BODY && bodyComplete(conn)) {
+      finish(fetcher, conn, true);
+      return;
+    }
+  }
+  if (got == 0 && conn->len == 0) {   // server closed the connection before answering
+    fail(fetcher, conn);
+  } else if (got == 0) {    // server closed the connection: the body ends here, if it is unframed
+    conn->keepAlive = false;
+    finish(fetcher, conn, conn->state == READING_BODY && !conn->chunked && conn->contentLength < 0);
+  } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+    fail(fetcher, conn);
+  }
+}
+
+/**************** doSend() ****************/
+/* Write as much of the request as the socket takes.
+ * Return false on a write error.
+ */
+static bool doSend(conn_t* conn) {
+  while (conn->requestSent < conn->requestLen) {
+    ssize_t sent = send(conn->fd, conn->request + conn->requestSent,
+                        conn->requestLen - conn->requestSent, MSG_NOSIGNAL);
+    if (sent < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    conn->requestSent += sent;
+  }
+  return true;
+}
+
+/**************** doRead() ****************/
+/* Read the next chunk of the response into conn->buf, growing it
+ * geometrically as needed.
+ * Return the number of bytes read, 0 at end of file, or -1 with
+ * errno set (EAGAIN when nothing more is available right now).
+ */
+static int doRead(conn_t* conn) {
+  if (conn->cap - conn->len < READ_CHUNK + 1) {   // room for a chunk and a terminating null
+    size_t cap = conn->cap ? conn->cap * 2 : 4 * READ_CHUNK;
+    while (cap - conn->len < READ_CHUNK + 1) {
+      cap *= 2;
+    }
+    char* buf = realloc(conn->buf, cap);
+    if (buf == NULL) {
+      errno = ENOMEM;
+      return -1;
+    }
+    conn->buf = buf;
+    conn->cap = cap;
+  }
+  ssize_t got;
+  do {
+    got = read(conn->fd, conn->buf + conn->len, READ_CHUNK);
+  } while (got < 0 && errno == EINTR);
+  if (got > 0) {
+    conn->len += got;
+  }
+  return got;
+}
+
+/**************** parseHeaders() ****************/
+/* Look for the end of the headers in what has been read so far; once
+ * found, check the status and note how the body is framed and whether
+ * the connection stays open.
+ * Set *done to whether the headers are complete.
+ * Return false if the response is not a successful one.
+ */
+static bool parseHeaders(conn_t* conn, bool* done) {
+  conn->buf[conn->len] = '\0';
+  char* end = strstr(conn->buf, "\r\n\r\n");
+  size_t endLen = 4;
+  char* bare = strstr(conn->buf, "\n\n");   // tolerate servers that send bare newlines
+  if (bare != NULL && (end == NULL || bare < end)) {
+    end = bare;
+    endLen = 2;
+  }
+  *done = (end != NULL);
+  if (end == NULL) {
+    return true;    // keep reading
+  }
+  conn->bodyStart = end - conn->buf + endLen;
+  *end = '\0';    // headers are now one string, status line first
+
+  // check response code to see whether we succeeded
+  int minor;
+  int code;
+  if (sscanf(conn->buf, "HTTP/1.%d %d", &minor, &code) != 2 || code != 200) {
+    return false;
+  }
+  // the headers we care about frame the body and say whether the connection stays open;
+  // HTTP/1.1 connections persist unless closed, HTTP/1.0 ones only if asked to
+  bool persist = minor >= 1;
+  for (char* line = strchr(conn->buf, '\n'); line != NULL; line = strchr(line, '\n')) {
+    line++;
+    if (strncasecmp(line, "Content-Length:", 15) == 0) {
+      conn->contentLength = strtol(line + 15, NULL, 10);
+    } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+      const char* value = line + 18;
+      size_t valueLen = strcspn(value, "\r\n");
+      for (size_t i = 0; i + 7 <= valueLen; i++) {    // look for the token within this line only
+        if (strncasecmp(value + i, "chunked", 7) == 0) {
+          conn->chunked = true;
+        }
+      }
+    } else if (strncasecmp(line, "Connection:", 11) == 0) {
+      char* value = line + 11;
+      value += strspn(value, " \t");
+      if (strncasecmp(value, "close", 5) == 0) {
+        persist = false;
+      } else if (strncasecmp(value, "keep-alive", 10) == 0) {
+        persist = true;
+      }
+    }
+  }
+  if (conn->chunked) {   // chunking wins over any Content-Length
+    conn->contentLength = -1;
+    conn->chunkState = CHUNK_SIZE;
+    conn->chunkLeft = 0;
+    conn->bodyLen = 0;
+    conn->rawPos = conn->bodyStart;
+  }
+  // a body that runs to the end of the connection leaves nothing to reuse
+  conn->keepAlive = persist && (conn->chunked || conn->contentLength >= 0);
+  return true;
+}
+
+/**************** decodeChunks() ****************/
+/* Decode as much of a chunked body as has been read, in place: chunk
+ * data is moved down to follow the data already decoded at bodyStart,
+ * and the undecoded bytes after it, so the buffer holds no framing.
+ * Return false if the framing is malformed.
+ */
+static bool decodeChunks(conn_t* conn) {
+  size_t pos = conn->rawPos;
+  while (conn->chunkState != CHUNK_DONE) {
+    size_t avail = conn->len - pos;
+    if (conn->chunkState == CHUNK_DATA) {
+      size_t n = avail < conn->chunkLeft ? avail : conn->chunkLeft;
+      memmove(conn->buf + conn->bodyStart + conn->bodyLen, conn->buf + pos, n);
+      conn->bodyLen += n;
+      conn->chunkLeft -= n;
+      pos += n;
+      if (conn->chunkLeft > 0) {
+        break;    // the rest of the chunk is still to come
+      }
+      conn->chunkState = CHUNK_DATA_END;
+      continue;
+    }
+
+    // every other state consumes one whole line
+    char* line = conn->buf + pos;
+    char* newline = memchr(line, '\n', avail);
+    if (newline == NULL) {
+      break;      // the rest of the line is still to come
+    }
+    size_t lineLen = newline - line;
+    pos += lineLen + 1;
+    if (lineLen > 0 && line[lineLen - 1] == '\r') {
+      lineLen--;
+    }
+    if (conn->chunkState == CHUNK_SIZE) {   // hex size, then any extensions we ignore
+      char* end;
+      conn->chunkLeft = strtoul(line, &end, 16);
+      if (end == line || (*end != ';' && *end != '\r' && *end != '\n')) {
+        return false;
+      }
+      conn->chunkState = conn->chunkLeft == 0 ? CHUNK_TRAILER : CHUNK_DATA;
+    } else if (conn->chunkState == CHUNK_DATA_END) {
+      if (lineLen != 0) {
+        return false;
+      }
+      conn->chunkState = CHUNK_SIZE;
+    } else if (lineLen == 0) {    // CHUNK_TRAILER: a blank line ends the body
+      conn->chunkState = CHUNK_DONE;
+    }
+  }
+  // close the gap between the decoded data and the undecoded bytes
+  size_t decodedEnd = conn->bodyStart + conn->bodyLen;
+  memmove(conn->buf + decodedEnd, conn->buf + pos, conn->len - pos);
+  conn->len = decodedEnd + (conn->len - pos);
+  conn->rawPos = decodedEnd;
+  return true;
+}
+
+/**************** bodyComplete() ****************/
+/* Return true if the whole body, as given by Content-Length or the
+ * last chunk, is in; a body framed neither way runs to the end of the
+ * connection.
+ */
+static bool bodyComplete(conn_t* conn) {
+  if (conn->chunked) {
+    return conn->chunkState == CHUNK_DONE;
+  }
+  return conn->contentLength >= 0 && conn->len - conn->bodyStart >= (size_t) conn->contentLength;
+}
+
+/**************** bodyLength() ****************/
+/* Return the number of body bytes, at bodyStart, read so far.
+ */
+static size_t bodyLength(conn_t* conn) {
+  if (conn->chunked) {
+    return conn->bodyLen;
+  }
+  size_t bodyLen = conn->len - conn->bodyStart;
+  if (conn->contentLength >= 0 && bodyLen > (size_t) conn->contentLength) {
+    bodyLen = conn->contentLength;
+  }
+  return bodyLen;
+}
+
+/**************** fail() ****************/
+/* The conn broke before a response came back. A kept-alive connection
+ * may simply have been closed by the server while idle, so the request
+ * is retried once on a fresh connection; otherwise the page fails.
+ */
+static void fail(fetcher_t* fetcher, conn_t* conn) {
+  if (conn->reused && conn->len == 0) {
+    epoll_ctl(fetcher->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->fd = -1;
+    conn->reused = false;
+    conn->tries = 0;
+    conn->requestSent = 0;
+    if (startConnect(fetcher, conn)) {
+      return;
+    }
+  }
+  finish(fetcher, conn, false);
+}
+
+/**************** finish() ****************/
+/* Complete the conn's page; on success the body becomes the page's
+ * html. Then return the conn to its host's pool if the server keeps it
+ * open and nothing unexpected follows the body, or else close it.
+ */
+static void finish(fetcher_t* fetcher, conn_t* conn, const bool success) {
+  bool fetched = false;
+  size_t bodyLen = bodyLength(conn);
+  size_t extra = conn->chunked ? conn->len - conn->rawPos : conn->len - conn->bodyStart - bodyLen;
+  bool reusable = success && conn->keepAlive && extra == 0;
+  if (success && bodyLen > 0) {   // an empty body counts as a failure, as in webpage_fetch
+    memmove(conn->buf, conn->buf + conn->bodyStart, bodyLen);
+    conn->buf[bodyLen] = '\0';
+    fetched = webpage_setHTML(conn->page, conn->buf, bodyLen);
+  }
+  if (fetched) {    // the page has the buffer now
+    conn->buf = NULL;
+    conn->len = conn->cap = 0;
+  }
+  complete(fetcher, conn->page, fetched);
+  conn->page = NULL;
+  if (reusable) {
+    park(fetcher, conn);
+  } else {
+    closeConn(fetcher, conn);
+  }
+}
+
+/**************** park() ****************/
+/* Put a conn whose response is done into its host's pool, to carry a
+ * later request, unless the pool is full already. While idle, the conn
+ * is watched for the server closing it.
+ */
+static void park(fetcher_t* fetcher, conn_t* conn) {
+  hostpool_t* pool = hashtable_find(fetcher->pools, conn->key);
+  if (pool == NULL) {
+    pool = mem_calloc_assert(1, sizeof(hostpool_t), "pool");
+    hashtable_insert(fetcher->pools, conn->key, pool);
+  }
+  if (pool->numIdle >= fetcher->maxInFlight) {    // more idle connections than could ever be busy
+    closeConn(fetcher, conn);
+    return;
+  }
+  conn->state = IDLE;
+  conn->prevIdle = NULL;
+  conn->nextIdle = pool->idle;
+  if (pool->idle != NULL) {
+    pool->idle->prevIdle = conn;
+  }
+  pool->idle = conn;
+  pool->numIdle++;
+  watch(fetcher, conn, EPOLLIN, EPOLL_CTL_MOD);
+}
+
+/**************** unpark() ****************/
+/* Return the most recently used idle conn to the host named by key,
+ * taken out of its pool, or NULL if there is none.
+ */
+static conn_t* unpark(fetcher_t* fetcher, const char* key) {
+  hostpool_t* pool = hashtable_find(fetcher->pools, key);
+  if (pool == NULL || pool->idle == NULL) {
+    return NULL;
+  }
+  conn_t* conn = pool->idle;
+  pool->idle = conn->nextIdle;
+  if (pool->idle != NULL) {
+    pool->idle->prevIdle = NULL;
+  }
+  pool->numIdle--;
+  return conn;
+}
+
+/**************** closeConn() ****************/
+/* Close the conn's socket, take it out of its pool (if idle) and the
+ * list of connections, and free it. Its page, if any, must have been
+ * completed already.
+ */
+static void closeConn(fetcher_t* fetcher, conn_t* conn) {
+  if (conn->fd >= 0) {
+    epoll_ctl(fetcher->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+  }
+  if (conn->state == IDLE) {
+    hostpool_t* pool = hashtable_find(fetcher->pools, conn->key);
+    if (conn->prevIdle != NULL) {
+      conn->prevIdle->nextIdle = conn->nextIdle;
+    } else {
+      pool->idle = conn->nextIdle;
+    }
+    if (conn->nextIdle != NULL) {
+      conn->nextIdle->prevIdle = conn->prevIdle;
+    }
+    pool->numIdle--;
+  }
+  // unlink it from the list of connections
+  if (conn->prev != NULL) {
+    conn->prev->next = conn->next;
+  } else {
+    fetcher->conns = conn->next;
+  }
+  if (conn->next != NULL) {
+    conn->next->prev = conn->prev;
+  }
+  free(conn->buf);
+  mem_free(conn->request);
+  mem_free(conn->key);
+  mem_free(conn);
+}
+
+/**************** hostpoolDelete() ****************/
+/* Free a hostpool_t, for hashtable_delete; its connections are closed
+ * already.
+ */
+static void hostpoolDelete(void* item) {
+  mem_free(item);
+}
+
+/**************** complete() ****************/
+/* Queue the page for fetcher_next.
+ */
+static void complete(fetcher_t* fetcher, webpage_t* page, const bool success) {
+  completion_t* done = mem_malloc_assert(sizeof(completion_t), "completion");
+  done->page = page;
+  done->success = success;
+  done->next = NULL;
+  if (fetcher->doneTail == NULL) {
+    fetcher->doneHead = done;
+  } else {
+    fetcher->doneTail->next = done;
+  }
+  fetcher->doneTail = done;
+}
+
+/**************** watch() ****************/
+/* Add (op EPOLL_CTL_ADD) or change (op EPOLL_CTL_MOD) the events
+ * that epoll reports for the conn's socket.
+ */
+static void watch(fetcher_t* fetcher, conn_t* conn, const unsigned int events, const int op) {
+  struct epoll_event event = { .events = events, .data.ptr = conn };
+  epoll_ctl(fetcher->epfd, op, conn->fd, &event);
+}
+
+/**************** nowMs() ****************/
+/* Return the time in milliseconds on a monotonic clock.
+ */
+static long nowMs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
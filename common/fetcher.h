@@ -0,0 +1,96 @@
+/*
+ * fetcher.h - header file for CS50 fetcher module
+ *
+ * A fetcher is an event-driven engine that fetches many webpages at
+ * once from a single thread. Pages are handed to the fetcher with
+ * fetcher_submit; each one comes back exactly once, fetched or not,
+ * from fetcher_next. Internally every page is fetched over a
+ * non-blocking HTTP/1.1 connection driven by epoll through the states
+ * connecting, sending, reading headers, and reading body. Connections
+ * the server keeps alive go back to a pool for their host and carry
+ * later requests to it, saving a TCP handshake per page; bodies may be
+ * framed by Content-Length, by chunks, or by the end of the connection.
+ *
+ * Limitations are those of webpage_fetch: http only, URLs of form
+ * http://host[:port][/pathname], and no redirects.
+ *
+ * Charlie Childress, February 2022, cs50
+ */
+
+#ifndef __FETCHER_H
+#define __FETCHER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "webpage.h"
+
+/**************** global types ****************/
+typedef struct fetcher fetcher_t;
+
+/**************** fetcher_new ****************/
+/* Parameters:
+ *  maxInFlight, the most pages that may be fetched at once
+ *
+ * Create a new fetcher with nothing in flight.
+ *
+ * Return the new fetcher if everything is successful
+ * Return NULL if there are any errors
+ */
+fetcher_t* fetcher_new(const int maxInFlight);
+
+/**************** fetcher_submit ****************/
+/* Parameters:
+ *  fetcher to fetch with, and a webpage_t* with a URL and
+ *  NULL html, as for webpage_fetch
+ *
+ * Start fetching the page, over an idle connection to its server if
+ * there is one. The fetcher owns the page until it is
+ * returned by fetcher_next, which happens even if the fetch fails
+ * right away (e.g., an unknown host).
+ *
+ * Return true if the page was accepted
+ * Return false if any parameter is bad or the fetcher is full;
+ * the caller still owns the page in that case
+ */
+bool fetcher_submit(fetcher_t* fetcher, webpage_t* page);
+
+/**************** fetcher_inFlight ****************/
+/* Return the number of submitted pages not yet returned by
+ * fetcher_next, or 0 if fetcher is NULL
+ */
+int fetcher_inFlight(fetcher_t* fetcher);
+
+/**************** fetcher_isFull ****************/
+/* Return true if fetcher_submit would refuse another page
+ */
+bool fetcher_isFull(fetcher_t* fetcher);
+
+/**************** fetcher_next ****************/
+/* Parameters:
+ *  fetcher, timeoutMs to wait at most in all (-1 waits indefinitely),
+ *  and a bool* set to whether the returned page was fetched
+ *
+ * Drive the connections in flight until one of them completes,
+ * fetcher_wake is called, or the timeout expires.
+ *
+ * Return a page submitted earlier; if *success is true its html has
+ * been filled in, as by webpage_fetch. The caller owns the page again.
+ * Return NULL if woken or timed out before anything completed
+ */
+webpage_t* fetcher_next(fetcher_t* fetcher, const int timeoutMs, bool* success);
+
+/**************** fetcher_wake ****************/
+/* Make a blocked (or the next) fetcher_next return NULL promptly.
+ * Safe to call from any thread, e.g., when another thread has
+ * produced more pages to submit.
+ */
+void fetcher_wake(fetcher_t* fetcher);
+
+/**************** fetcher_delete ****************/
+/* Close every connection, delete every page still in flight or
+ * not yet returned, and free the fetcher. NULL is ignored.
+ */
+void fetcher_delete(fetcher_t* fetcher);
+
+#endif // __FETCHER_H
@@ -6,28 +6,138 @@
  * Charlie Childress, cs50, February 2022
  */
 
+#define _GNU_SOURCE       // madvise, sysconf
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
 #include "index.h"
-#include "hashtable.h"
-#include "file.h"
 #include "mem.h"
-#include "counters.h"
+#include "postings.h"
+#include "tombstones.h"
+#include "word.h"
 
 
 /**************** file-local global variables ****************/
-/* none */
+#define SPAN_BUFFER 64        // index_insertSpan copies words shorter than this on the stack
+#define MAX_LOAD_THREADS 16   // most threads loadText parses a file with
+static const size_t MIN_SLOTS = 256;    // smallest term table, a power of two
+static const char BINARY_MAGIC[8] = { 'T', 'S', 'E', 'I', 'N', 'D', 'E', 'X' };
+static const uint32_t BINARY_VERSION = 1;   // of the binary index format index_writeBinary writes
+static const size_t LOAD_CHUNK = 8 << 20;   // bytes of a text index file worth a loader thread of their own
+static const size_t MERGE_BUFFER = 64 << 10;  // stdio buffer of each file index_mergeFiles reads
 
 /**************** local types ****************/
-/* none */
+// a word of the index and its postings, for index_write to sort
+typedef struct wordentry {
+  const char* word;
+  postings_t* postings;
+} wordentry_t;
+
+// a growing array, filled by an iterator
+typedef struct array {
+  void* items;
+  int count;
+} array_t;
+
+// what index_merge passes to word_merge
+typedef struct merge {
+  index_t* index;             // the index merged into
+  int limit;                  // docIDs from limit on are dropped, if limit > 0
+  bool ok;                    // false once out of memory
+} merge_t;
+
+// the header of a binary index file
+typedef struct binaryheader {
+  char magic[8];              // BINARY_MAGIC
+  uint32_t version;           // BINARY_VERSION
+  uint32_t reserved;          // 0
+  uint64_t numTerms;          // binaryterm_t that follow the header
+  uint64_t wordsOffset;       // where the words start in the file
+  uint64_t postingsOffset;    // where the postings start in the file
+  uint64_t length;            // of the whole file
+} binaryheader_t;
+
+// a term of a binary index file; they are in strcmp order of their words
+typedef struct binaryterm {
+  uint64_t word;              // where its word starts in the words
+  uint64_t postings;          // where its postings start in the postings
+  uint32_t numDocs;           // (docID, count) pairs in its postings
+  uint32_t length;            // bytes of its postings
+} binaryterm_t;
+
+// the parts of a binary index file, once its header is checked
+typedef struct binaryfile {
+  const binaryterm_t* terms;
+  uint64_t numTerms;
+  const char* words;          // ends with a '\0', so every word in it does
+  uint64_t wordsLength;
+  const uint8_t* postings;
+  uint64_t postingsLength;
+} binaryfile_t;
+
+// room to decode one term's postings into, for index_load
+typedef struct scratch {
+  int* docIDs;
+  int* counts;
+  uint32_t room;
+} scratch_t;
+
+// a piece of a text index file, whole lines, that loadText parses
+// into an index of its own, on a thread of its own
+typedef struct chunk {
+  char* start;
+  char* end;                  // just past its last line
+  index_t* index;             // what it parsed into, or NULL if out of memory
+  pthread_t thread;
+  bool started;               // whether it is being parsed on that thread
+} chunk_t;
+
+// one of the files index_mergeFiles merges, and where it is in it
+typedef struct run {
+  FILE* fp;
+  char* word;                 // the word of the line it is on, unless ended
+  size_t wordRoom;
+  bool ended;                 // once it has no more words
+  bool hasPair;               // whether it is at a pair on the line, and if so
+  int docID;                  // the pair
+  int count;
+} run_t;
+
+// a slot of the term table
+typedef struct term {
+  uint64_t hash;              // of the word, cached; 0 in an empty slot
+  size_t word;                // where the word is in the arena
+  postings_t* postings;       // (docID, count) pairs of the word
+} term_t;
 
 /**************** global types ****************/
 typedef struct index {
-  hashtable_t* hashtable;
+  term_t* terms;              // open-addressed by hash, with linear probing
+  size_t numSlots;            // a power of two, at least 4/3 of numWords
+  size_t numWords;
+  char* arena;                // the words, each null-terminated, back to back
+  size_t arenaLength;         // bytes of the arena in use
+  size_t arenaRoom;           // and allocated
+  size_t postingsSize;        // bytes the words' postings have allocated, for index_size
+  void* map;                  // for index_map: the mapped binary index file, or NULL
+  size_t mapLength;
+  binaryfile_t binary;        // and its parts
 } index_t;
 
+/* Note: the term table and arena are allocated with plain
+ * malloc/realloc/free; mem.h has no realloc.
+ */
+
 /**************** global functions ****************/
 /* that is, visible outside this file */
 /* see hashtable.h for comments about exported functions */
@@ -36,49 +146,204 @@ typedef struct index {
 /* not visible outside this file */
 void word_write(void* arg, const char* word, void* item);
 void counter_write(void* arg, const int docID, const int counter);
-void hashtable_indexDelete(void* item);
+static uint64_t hashWord(const char* word);
+static term_t* lookup(index_t* index, const char* word, const uint64_t hash);
+static postings_t* findOrAdd(index_t* index, const char* word);
+static term_t* addWord(index_t* index, const char* word, const uint64_t hash, postings_t* postings);
+static bool adopt(index_t* index, index_t* other);
+static void account(index_t* index, const postings_t* postings, const size_t before);
+static bool grow(index_t* index);
+static void word_collect(void* arg, const char* word, postings_t* postings);
+static int word_compare(const void* a, const void* b);
+static void word_merge(void* arg, const char* word, postings_t* postings);
+static wordentry_t* sortWords(index_t* index, int* numWords);
+static char* readFile(FILE* fp, size_t* size);
+static index_t* loadText(FILE* fp);
+static void* parseChunk(void* arg);
+static index_t* parseText(char* text, const char* end);
+static bool parseInt(char** at, const char* end, int* value);
+static const char* leastTerm(index_t** inputs, const int numInputs, const uint64_t* next, bool* ok);
+static postings_t* gatherTerm(index_t** inputs, const int numInputs, uint64_t* next, const char* word,
+                              const tombstones_t* deleted, scratch_t* scratch);
+static bool runNextWord(run_t* run);
+static void runNextPair(run_t* run);
+static bool readNumber(FILE* fp, int* value);
+static index_t* loadBinary(FILE* fp);
+static index_t* parseBinary(const uint8_t* file, const size_t size);
+static bool openBinary(const uint8_t* file, const size_t size, binaryfile_t* binary);
+static bool termFits(const binaryfile_t* binary, const binaryterm_t* term);
+static postings_t* decodeTerm(const binaryfile_t* binary, const binaryterm_t* term);
+static bool decodePostings(const uint8_t* at, const uint8_t* end, const uint32_t numDocs,
+                           scratch_t* scratch, postings_t* postings);
+static size_t encodePostings(const postings_t* postings, uint8_t* buffer);
+static size_t putVarint(uint8_t* buffer, uint32_t value);
+static bool getVarint(const uint8_t** at, const uint8_t* end, uint32_t* value);
 
-/**************** index_get_hashtable() ****************/
+/**************** index_new() ****************/
 /* see index.h for description */
-hashtable_t* index_get_hashtable(index_t* index) {
-  return index ? index->hashtable : 0;
+index_t* index_new(void) {
+  return index_newSized(0);
 }
 
-/**************** index_new() ****************/
+/**************** index_newSized() ****************/
 /* see index.h for description */
-index_t* index_new() {
-  index_t* index = mem_malloc(sizeof(index_t));  
+index_t* index_newSized(const int expectedWords) {
+  index_t* index = calloc(1, sizeof(index_t));
   if (index == NULL) {  // error allocating index
-    index_delete(index);  // free the memory allocated
     return NULL;  // return nothing
-  } else {
-    index->hashtable = hashtable_new(200);  // create a hashtable for the index (size could be 200-900 according to specs)
-    if (index->hashtable == NULL) { // if there is an error creating hashtable...
-      index_delete(index);  // free the memory allocated
-      return NULL;   // and return nothing
-    }
-    return index;   // otherwise return the index with the new hashtable
   }
+  // a table big enough for the words expected at three-quarters full
+  index->numSlots = MIN_SLOTS;
+  while (expectedWords > 0 && index->numSlots * 3 < (size_t) expectedWords * 4) {
+    index->numSlots *= 2;
+  }
+  index->terms = calloc(index->numSlots, sizeof(term_t));
+  if (index->terms == NULL) { // if there is an error creating the table...
+    index_delete(index);  // free the memory allocated
+    return NULL;   // and return nothing
+  }
+  return index;   // otherwise return the index with the new table
 }
 
 /**************** index_insert() ****************/
 /* see index.h for description */
 bool index_insert(index_t* index, const char* word, int docID) {
-  counters_t* counter;
-  if (index != NULL && word != NULL && docID >= 0) {  // make sure all parameters are valid
-    // set counter to the current count of the word in the hashtable
-    if ((counter = hashtable_find(index->hashtable, word)) == NULL) {   // if the the word is not in the hashtable
-      counter = counters_new();   // create a new counter for the word
-      // then insert the word into the hashtable with the new counter
-      if (!hashtable_insert(index->hashtable, word, counter)) {  // if there is an error creating a set for the word, return false
-        return false;
+  postings_t* postings;
+  if (index == NULL || index->map != NULL || word == NULL || docID < 0) {  // make sure all parameters are valid
+    return false;
+  }
+  // find the word's postings, adding the word if it is new
+  if ((postings = findOrAdd(index, word)) == NULL) {
+    return false;
+  }
+  size_t before = postings_size(postings);
+  bool added = postings_add(postings, docID, 1);   // count one more of the word in the docID
+  account(index, postings, before);
+  return added;
+}
+
+/**************** index_find() ****************/
+/* see index.h for description */
+postings_t* index_find(index_t* index, const char* word) {
+  if (index == NULL || index->map != NULL || word == NULL) {
+    return NULL;
+  }
+  return lookup(index, word, hashWord(word))->postings;
+}
+
+/**************** index_lookup() ****************/
+/* see index.h for description */
+postings_t* index_lookup(index_t* index, const char* word) {
+  if (index == NULL || word == NULL) {
+    return NULL;
+  }
+  if (index->map == NULL) {
+    // a copy, so that the caller owns the postings whichever kind of index it is
+    return postings_union(index_find(index, word), NULL);
+  }
+
+  // binary search of the terms, which are in strcmp order of their words
+  const binaryfile_t* binary = &index->binary;
+  uint64_t low = 0;
+  uint64_t high = binary->numTerms;
+  while (low < high) {
+    uint64_t mid = low + (high - low) / 2;
+    const binaryterm_t* term = &binary->terms[mid];
+    if (term->word >= binary->wordsLength) {
+      break;    // a damaged file; the word counts as absent
+    }
+    int compare = strcmp(word, binary->words + term->word);
+    if (compare == 0) {
+      return decodeTerm(binary, term);
+    } else if (compare < 0) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return postings_new();
+}
+
+/**************** index_map() ****************/
+/* see index.h for description */
+index_t* index_map(const char* indexFilename) {
+  if (indexFilename == NULL) {
+    return NULL;
+  }
+  int fd = open(indexFilename, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  void* map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(binaryheader_t)) {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);    // the mapping keeps the file open
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+
+  // check the header only; the terms and postings are checked as lookups read them
+  index_t* index = calloc(1, sizeof(index_t));
+  if (index != NULL && openBinary(map, st.st_size, &index->binary)) {
+    madvise(map, st.st_size, MADV_RANDOM);    // each lookup reads a few scattered pages
+    index->map = map;
+    index->mapLength = st.st_size;
+    return index;
+  }
+  free(index);
+  munmap(map, st.st_size);
+  return NULL;
+}
+
+/**************** index_count() ****************/
+/* see index.h for description */
+int index_count(index_t* index) {
+  if (index == NULL) {
+    return 0;
+  }
+  return index->map ? (int) index->binary.numTerms : (int) index->numWords;
+}
+
+/**************** index_size() ****************/
+/* see index.h for description */
+size_t index_size(index_t* index) {
+  if (index == NULL) {
+    return 0;
+  }
+  return sizeof(index_t) + index->numSlots * sizeof(term_t) + index->arenaRoom + index->postingsSize;
+}
+
+/**************** index_iterate() ****************/
+/* see index.h for description */
+void index_iterate(index_t* index, void* arg, void (*itemfunc)(void* arg, const char* word, postings_t* postings)) {
+  if (index != NULL && index->map == NULL && itemfunc != NULL) {
+    for (size_t i = 0; i < index->numSlots; i++) {
+      if (index->terms[i].hash != 0) {
+        (*itemfunc)(arg, index->arena + index->terms[i].word, index->terms[i].postings);
       }
     }
-  } else {  // if there are any faulty parameters
+  }
+}
+
+/**************** index_insertSpan() ****************/
+/* see index.h for description */
+bool index_insertSpan(index_t* index, const char* word, const size_t len, int docID) {
+  if (index == NULL || index->map != NULL || word == NULL || docID < 0) {
     return false;
   }
-  counters_add(counter, docID);   // add the word counter in the hashtable to current counter for the docID
-  return true;
+  // the table wants a null-terminated key; most words fit on the stack
+  char small[SPAN_BUFFER];
+  char* key = len < SPAN_BUFFER ? small : mem_malloc(len + 1);
+  if (key == NULL) {
+    return false;
+  }
+  bool inserted = index_insert(index, normalizeSpan(word, len, key), docID);
+  if (key != small) {
+    mem_free(key);
+  }
+  return inserted;
 }
 
 /**************** index_load() ****************/
@@ -96,31 +361,186 @@ index_t* index_load(const char* oldIndexFilename) {
     fclose(fp);
     return NULL;
   }
-  // to get the size of the hashtable, find how many lines as each one represents a slot
-  int indexSize = file_numLines(fp);
-  index_t* index = index_new(indexSize + 1);
-  char* word;
-  while ((word = file_readWord(fp)) != NULL) { // go through each word of the file as long as words exists
+  // a binary index starts with its magic; anything else is read as text
+  char magic[sizeof(BINARY_MAGIC)];
+  bool binary = fread(magic, 1, sizeof(magic), fp) == sizeof(magic)
+             && memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+  rewind(fp);
+  index_t* index = binary ? loadBinary(fp) : loadText(fp);
+  if (index == NULL) {
+    fprintf(stderr, "usage: %s [index_load]; not a valid index file\n", oldIndexFilename);
+  }
+  fclose(fp);
+  return index;
+}
+
+/**************** loadText() ****************/
+/* Read the index from a file index_write wrote, open on fp, in one
+ * pass over a copy of the whole file. A big file is split into chunks
+ * of whole lines, which threads parse into indexes of their own, to
+ * be gathered into the first one.
+ * Return the index, or NULL if out of memory.
+ */
+static index_t* loadText(FILE* fp) {
+  size_t size;
+  char* text = readFile(fp, &size);
+  if (text == NULL) {
+    return NULL;
+  }
+  long numChunks = size / LOAD_CHUNK;
+  long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+  if (numChunks > numCPUs) {
+    numChunks = numCPUs;
+  }
+  if (numChunks > MAX_LOAD_THREADS) {
+    numChunks = MAX_LOAD_THREADS;
+  }
+  if (numChunks < 2) {
+    index_t* index = parseText(text, text + size);
+    free(text);
+    return index;
+  }
+
+  // cut the file into about equal chunks, each ending at a newline
+  chunk_t chunks[MAX_LOAD_THREADS];
+  char* start = text;
+  for (long i = 0; i < numChunks; i++) {
+    char* end = text + size;
+    if (i < numChunks - 1) {
+      char* cut = text + size * (i + 1) / numChunks;
+      cut = cut > start ? cut : start;
+      char* newline = memchr(cut, '\n', end - cut);
+      end = newline ? newline + 1 : end;
+    }
+    chunks[i] = (chunk_t) { start, end, NULL };
+    start = end;
+  }
+  // parse the first chunk here and the rest on threads of their own,
+  // or here too if there are no threads to be had
+  for (long i = 1; i < numChunks; i++) {
+    chunks[i].started = pthread_create(&chunks[i].thread, NULL, parseChunk, &chunks[i]) == 0;
+  }
+  parseChunk(&chunks[0]);
+  for (long i = 1; i < numChunks; i++) {
+    if (chunks[i].started) {
+      pthread_join(chunks[i].thread, NULL);
+    } else {
+      parseChunk(&chunks[i]);
+    }
+  }
+  free(text);
+
+  // gather the chunks' words into the first chunk's index
+  index_t* index = chunks[0].index;
+  for (long i = 1; i < numChunks; i++) {
+    if (index != NULL && (chunks[i].index == NULL || !adopt(index, chunks[i].index))) {
+      index_delete(index);
+      index = NULL;
+    }
+    index_delete(chunks[i].index);
+  }
+  return index;
+}
+
+/**************** parseChunk() ****************/
+/* pthread start routine: parse the chunk_t at arg into its index
+ */
+static void* parseChunk(void* arg) {
+  chunk_t* chunk = arg;
+  chunk->index = parseText(chunk->start, chunk->end);
+  return NULL;
+}
+
+/**************** parseText() ****************/
+/* Build an index from the lines of a text index file from text up to
+ * end: on each line a word, then its docIDs and counts, in pairs. The
+ * word is null-terminated in place, over the whitespace after it, so
+ * it can be added without a copy; text must be writable, and end must
+ * be the end of a line or have a byte after it to write. A pair that
+ * is not two numbers ends the line; a count of 0 is skipped.
+ * Return the index, or NULL if out of memory.
+ */
+static index_t* parseText(char* text, const char* end) {
+  index_t* index = index_new();
+  char* at = text;
+  while (index != NULL && at < end) {
+    // the word, after any blank lines or space
+    while (at < end && isspace((unsigned char) *at)) {
+      at++;
+    }
+    char* word = at;
+    while (at < end && !isspace((unsigned char) *at)) {
+      at++;
+    }
+    if (at == word) {
+      break;
+    }
+    bool lineEnds = at == end || *at == '\n';
+    const bool wordEndsLine = lineEnds;   // then its newline is the '\0', and at the next line
+    *at++ = '\0';
+
+    // then its pairs
+    postings_t* postings = NULL;   // the word's, once it has a pair
     int docID;
-    int counter;
-    // scan the rest of the line for pairs of ints for the docID and counter
-    while(fscanf(fp, " %d %d ", &docID, &counter) == 2) {
-      for (int i = 0; i < counter; i++) {
-        // insert for each counter
-        index_insert(index, word, docID);
+    int count;
+    while (!lineEnds && parseInt(&at, end, &docID) && parseInt(&at, end, &count)) {
+      if (count > 0) {
+        if (postings == NULL) {
+          postings = findOrAdd(index, word);
+        }
+        size_t before = postings_size(postings);
+        if (postings == NULL || !postings_add(postings, docID, count)) {
+          index_delete(index);    // out of memory
+          return NULL;
+        }
+        account(index, postings, before);
       }
+      while (at < end && *at != '\n' && isspace((unsigned char) *at)) {
+        at++;
+      }
+      lineEnds = at == end || *at == '\n';
+    }
+    // skip whatever is left of the line, unless the word was all of it
+    while (!wordEndsLine && at < end && *at != '\n') {
+      at++;
     }
-    free(word);
   }
-  fclose(fp);
   return index;
 }
 
+/**************** parseInt() ****************/
+/* Parse the decimal number at *at, after any spaces on its line, into
+ * value, and move *at past it.
+ * Return false if there is no number there, or it is too big for an int.
+ */
+static bool parseInt(char** at, const char* end, int* value) {
+  char* c = *at;
+  while (c < end && *c != '\n' && isspace((unsigned char) *c)) {
+    c++;
+  }
+  if (c == end || *c < '0' || *c > '9') {
+    return false;
+  }
+  long long number = 0;
+  for (; c < end && *c >= '0' && *c <= '9'; c++) {
+    number = number * 10 + (*c - '0');
+    if (number > INT_MAX) {
+      return false;
+    }
+  }
+  if (c < end && !isspace((unsigned char) *c)) {
+    return false;   // as in "12abc"
+  }
+  *value = number;
+  *at = c;
+  return true;
+}
+
 /**************** index_write() ****************/
 /* see index.h for description */
 bool index_write(index_t* index, char* newIndexFilename) {
-  // if index if empty return false as there is nothing to write
-  if (index == NULL) {
+  // if index if empty (or mapped, and so cannot be iterated) return false as there is nothing to write
+  if (index == NULL || index->map != NULL) {
     return false;
   }
   FILE* fp;
@@ -128,29 +548,313 @@ bool index_write(index_t* index, char* newIndexFilename) {
   if ((fp = fopen(newIndexFilename, "w")) == NULL) {
     fprintf(stderr, "usage: %s [index_write]; error when trying to open or create newIndexFilename\n", newIndexFilename);
     return false;
-  } else {
-    hashtable_iterate(index->hashtable, fp, word_write);  // print out the contents of the index into the newIndexFilename
   }
+  // gather the words and sort them, so that the file is the same however the index was built
+  int numWords;
+  wordentry_t* entries = sortWords(index, &numWords);
+  for (int i = 0; i < numWords; i++) {
+    word_write(fp, entries[i].word, entries[i].postings);  // print out the contents of the index into the newIndexFilename
+  }
+  mem_free(entries);
   fclose(fp);
   return true;
 }
 
+/**************** index_writeBinary() ****************/
+/* see index.h for description */
+bool index_writeBinary(index_t* index, const char* newIndexFilename) {
+  if (index == NULL || index->map != NULL || newIndexFilename == NULL) {
+    return false;
+  }
+  FILE* fp;
+  if ((fp = fopen(newIndexFilename, "w")) == NULL) {
+    fprintf(stderr, "usage: %s [index_writeBinary]; error when trying to open or create newIndexFilename\n", newIndexFilename);
+    return false;
+  }
+  int numWords;
+  wordentry_t* entries = sortWords(index, &numWords);
+
+  // lay the words and postings out first, so that the terms, which say where
+  // they are, can be written ahead of them
+  binaryterm_t* terms = mem_malloc_assert((numWords + 1) * sizeof(binaryterm_t), "index_writeBinary terms");
+  uint64_t wordsLength = 0;
+  uint64_t postingsLength = 0;
+  size_t longest = 0;
+  bool ok = true;
+  for (int i = 0; i < numWords; i++) {
+    size_t length = encodePostings(entries[i].postings, NULL);
+    terms[i] = (binaryterm_t) { wordsLength, postingsLength, postings_length(entries[i].postings), length };
+    ok = ok && length <= UINT32_MAX;
+    longest = length > longest ? length : longest;
+    wordsLength += strlen(entries[i].word) + 1;
+    postingsLength += length;
+  }
+  binaryheader_t header = { { 0 }, BINARY_VERSION, 0, numWords };
+  memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  header.wordsOffset = sizeof(binaryheader_t) + numWords * sizeof(binaryterm_t);
+  header.postingsOffset = header.wordsOffset + wordsLength;
+  header.length = header.postingsOffset + postingsLength;
+
+  ok = ok && fwrite(&header, sizeof(header), 1, fp) == 1
+          && fwrite(terms, sizeof(binaryterm_t), numWords, fp) == (size_t) numWords;
+  for (int i = 0; ok && i < numWords; i++) {
+    ok = fputs(entries[i].word, fp) != EOF && fputc('\0', fp) != EOF;
+  }
+  uint8_t* buffer = mem_malloc_assert(longest + 1, "index_writeBinary postings");
+  for (int i = 0; ok && i < numWords; i++) {
+    size_t length = encodePostings(entries[i].postings, buffer);
+    ok = fwrite(buffer, 1, length, fp) == length;
+  }
+  mem_free(buffer);
+  mem_free(terms);
+  mem_free(entries);
+  return fclose(fp) == 0 && ok;
+}
+
+/**************** index_merge() ****************/
+/* see index.h for description */
+bool index_merge(index_t* index, index_t* other, const int limit) {
+  if (index == NULL || other == NULL || index == other || index->map != NULL || other->map != NULL) {
+    return false;
+  }
+  merge_t merge = { index, limit, true };
+  index_iterate(other, &merge, word_merge);
+  return merge.ok;
+}
+
+/**************** index_mergeFiles() ****************/
+/* see index.h for description */
+bool index_mergeFiles(char** indexFilenames, const int numFiles, const char* newIndexFilename, const int limit) {
+  if (indexFilenames == NULL || numFiles < 0 || newIndexFilename == NULL) {
+    return false;
+  }
+  run_t* runs = calloc(numFiles + 1, sizeof(run_t));
+  int* at = malloc((numFiles + 1) * sizeof(int));   // the runs on the word being merged
+  bool ok = runs != NULL && at != NULL;
+  for (int i = 0; ok && i < numFiles; i++) {
+    if ((runs[i].fp = fopen(indexFilenames[i], "r")) == NULL) {
+      fprintf(stderr, "usage: %s [index_mergeFiles]; error when trying to open an index file\n", indexFilenames[i]);
+      ok = false;
+    } else {
+      setvbuf(runs[i].fp, NULL, _IOFBF, MERGE_BUFFER);
+      ok = runNextWord(&runs[i]);
+    }
+  }
+  FILE* fp = NULL;
+  if (ok && (fp = fopen(newIndexFilename, "w")) == NULL) {
+    fprintf(stderr, "usage: %s [index_mergeFiles]; error when trying to open or create newIndexFilename\n", newIndexFilename);
+    ok = false;
+  }
+
+  while (ok) {
+    // find the least word any run is on, and the runs on it; there are
+    // few runs, so a scan of them costs less than keeping a heap
+    const char* word = NULL;
+    int numAt = 0;
+    for (int i = 0; i < numFiles; i++) {
+      int order = runs[i].ended ? 1 : word == NULL ? -1 : strcmp(runs[i].word, word);
+      if (order < 0) {
+        word = runs[i].word;
+        numAt = 0;
+      }
+      if (order <= 0) {
+        at[numAt++] = i;
+      }
+    }
+    if (word == NULL) {
+      break;
+    }
+
+    // write its pairs in docID order, summing the counts of a docID in several runs
+    bool written = false;
+    for (;;) {
+      int docID = INT_MAX;
+      bool found = false;
+      for (int j = 0; j < numAt; j++) {
+        if (runs[at[j]].hasPair && runs[at[j]].docID <= docID) {
+          docID = runs[at[j]].docID;
+          found = true;
+        }
+      }
+      if (!found) {
+        break;
+      }
+      int count = 0;
+      for (int j = 0; j < numAt; j++) {
+        run_t* run = &runs[at[j]];
+        if (run->hasPair && run->docID == docID) {
+          count = count > INT_MAX - run->count ? INT_MAX : count + run->count;
+          runNextPair(run);
+        }
+      }
+      if (count > 0 && (limit <= 0 || docID < limit)) {
+        if (!written) {
+          fprintf(fp, "%s", word);
+          written = true;
+        }
+        counter_write(fp, docID, count);
+      }
+    }
+    if (written) {
+      fprintf(fp, "\n");
+    }
+    // and move those runs on to their next words; word is one of theirs
+    for (int j = 0; ok && j < numAt; j++) {
+      ok = runNextWord(&runs[at[j]]);
+    }
+  }
+
+  for (int i = 0; runs != NULL && i < numFiles; i++) {
+    if (runs[i].fp != NULL) {
+      ok = !ferror(runs[i].fp) && ok;
+      fclose(runs[i].fp);
+    }
+    free(runs[i].word);
+  }
+  free(runs);
+  free(at);
+  if (fp != NULL) {
+    ok = !ferror(fp) && ok;
+    ok = fclose(fp) == 0 && ok;
+  }
+  return ok;
+}
+
+/**************** index_mergeBinary() ****************/
+/* see index.h for description */
+bool index_mergeBinary(char** indexFilenames, const int numFiles, const char* newIndexFilename,
+                       const tombstones_t* deleted) {
+  if (indexFilenames == NULL || numFiles < 0 || newIndexFilename == NULL) {
+    return false;
+  }
+  index_t** inputs = calloc(numFiles + 1, sizeof(index_t*));
+  uint64_t* next = calloc(numFiles + 1, sizeof(uint64_t));    // the next term of each input
+  bool ok = inputs != NULL && next != NULL;
+  for (int i = 0; ok && i < numFiles; i++) {
+    if ((inputs[i] = index_map(indexFilenames[i])) == NULL) {
+      fprintf(stderr, "usage: %s [index_mergeBinary]; not a binary index file\n", indexFilenames[i]);
+      ok = false;
+    } else {
+      madvise(inputs[i]->map, inputs[i]->mapLength, MADV_SEQUENTIAL);   // read front to back, once
+    }
+  }
+
+  // count the terms and the bytes of their words first, which fixes where every part goes;
+  // a word with no postings left (all deleted) is dropped, so that dead words do not pile up
+  binaryheader_t header = { { 0 }, BINARY_VERSION, 0, 0 };
+  memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  uint64_t wordsLength = 0;
+  const char* word;
+  scratch_t scratch = { NULL, NULL, 0 };
+  while (ok && (word = leastTerm(inputs, numFiles, next, &ok)) != NULL) {
+    uint64_t numDocs = 0;
+    if (tombstones_count(deleted) > 0) {
+      // which of its docIDs are deleted takes decoding its postings
+      postings_t* postings = gatherTerm(inputs, numFiles, next, word, deleted, &scratch);
+      ok = postings != NULL;
+      numDocs = postings_length(postings);
+      postings_delete(postings);
+    } else {
+      for (int i = 0; i < numFiles; i++) {
+        const binaryfile_t* binary = &inputs[i]->binary;
+        if (next[i] < binary->numTerms && strcmp(binary->words + binary->terms[next[i]].word, word) == 0) {
+          numDocs += binary->terms[next[i]++].numDocs;
+        }
+      }
+    }
+    if (numDocs > 0) {
+      header.numTerms++;
+      wordsLength += strlen(word) + 1;
+    }
+  }
+  header.wordsOffset = sizeof(binaryheader_t) + header.numTerms * sizeof(binaryterm_t);
+  header.postingsOffset = header.wordsOffset + wordsLength;
+
+  // then write the terms, words, and postings, each through a stream of its
+  // own onto its part of the file, so that nothing is held but one term's postings
+  FILE* termsFp = NULL;
+  FILE* wordsFp = NULL;
+  FILE* postingsFp = NULL;
+  if (ok && (termsFp = fopen(newIndexFilename, "w")) == NULL) {
+    fprintf(stderr, "usage: %s [index_mergeBinary]; error when trying to open or create newIndexFilename\n", newIndexFilename);
+    ok = false;
+  }
+  ok = ok && (wordsFp = fopen(newIndexFilename, "r+")) != NULL
+          && (postingsFp = fopen(newIndexFilename, "r+")) != NULL
+          && fseek(termsFp, sizeof(binaryheader_t), SEEK_SET) == 0
+          && fseek(wordsFp, header.wordsOffset, SEEK_SET) == 0
+          && fseek(postingsFp, header.postingsOffset, SEEK_SET) == 0;
+  memset(next, 0, (numFiles + 1) * sizeof(uint64_t));
+  binaryterm_t out = { 0, 0, 0, 0 };
+  uint8_t* buffer = NULL;
+  size_t room = 0;
+  while (ok && (word = leastTerm(inputs, numFiles, next, &ok)) != NULL) {
+    postings_t* postings = gatherTerm(inputs, numFiles, next, word, deleted, &scratch);
+    ok = postings != NULL;
+    if (ok && postings_length(postings) == 0) {
+      postings_delete(postings);    // left out of the count above too
+      continue;
+    }
+    size_t length = ok ? encodePostings(postings, NULL) : 0;
+    if (ok && length > room) {
+      uint8_t* more = realloc(buffer, length);
+      if (more != NULL) {
+        buffer = more;
+        room = length;
+      } else {
+        ok = false;
+      }
+    }
+    if (ok) {
+      encodePostings(postings, buffer);
+      out.numDocs = postings_length(postings);
+      out.length = length;
+      size_t wordLength = strlen(word) + 1;
+      ok = length <= UINT32_MAX
+        && fwrite(&out, sizeof(out), 1, termsFp) == 1
+        && fwrite(word, 1, wordLength, wordsFp) == wordLength
+        && fwrite(buffer, 1, length, postingsFp) == length;
+      out.word += wordLength;
+      out.postings += length;
+    }
+    postings_delete(postings);
+  }
+  header.length = header.postingsOffset + out.postings;
+  ok = ok && fseek(termsFp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, termsFp) == 1;
+
+  free(scratch.docIDs);
+  free(scratch.counts);
+  free(buffer);
+  FILE* streams[] = { termsFp, wordsFp, postingsFp };
+  for (int i = 0; i < 3; i++) {
+    if (streams[i] != NULL) {
+      ok = fclose(streams[i]) == 0 && ok;
+    }
+  }
+  for (int i = 0; inputs != NULL && i < numFiles; i++) {
+    index_delete(inputs[i]);
+  }
+  free(inputs);
+  free(next);
+  return ok;
+}
+
 /**************** word_write() ****************/
 /* Parameters:
  *  arg which is the file we want to print the index
  *  into, docID for specific file that is a key of 
- *  the hashtable, and a counter which is the item 
+ *  the index, and postings which is the item 
  *  of the key.
  *
- * print the contents of the index
+ * print the contents of the index, the postings in
+ * docID order
  *
  */
 void word_write(void* arg, const char* word, void* item) {
   FILE* fp = arg;
   fprintf(fp, "%s", word);  // print the words into the index file
-  if (item != NULL) {  // then if there are counters
-    counters_iterate(item, fp, counter_write); // go through the counters and print the, too
-  }
+  // then go through the postings, which are sorted by docID, and print them, too
+  postings_iterate(item, fp, counter_write);
   fprintf(fp, "\n");
 }
 
@@ -158,7 +862,7 @@ void word_write(void* arg, const char* word, void* item) {
 /* Parameters:
  *  arg which is the file we want to print the index
  *  into, docID for specific file that is a key of 
- *  the hashtable, and a counter which is the item 
+ *  the postings, and a counter which is the item 
  *  of the key.
  *
  * print the contents of the counter
@@ -172,23 +876,589 @@ void counter_write(void* arg, const int docID, const int counter) {
 /**************** index_delete() ****************/
 /* see index.h for description */
 void index_delete(index_t* index) {
-  if (index != NULL) {  // if there is a hashtable in the index...
-    hashtable_delete(index->hashtable, hashtable_indexDelete);  // delete the hashtable and its items
+  if (index != NULL) {  // if there is a table in the index...
+    for (size_t i = 0; index->terms != NULL && i < index->numSlots; i++) {
+      postings_delete(index->terms[i].postings);  // delete the postings of each word
+    }
+    free(index->terms);
+    free(index->arena);
+    if (index->map != NULL) {
+      munmap(index->map, index->mapLength);   // or unmap its file
+    }
     free(index);   // and free the index
   }
 }
 
-/**************** hashtable_indexDelete() ****************/
-/* Parameter:
- *  item/counter in the hashtable that we want to be deleted
- *
- * if the counter is not NULL, delete it
- * if the counter is NULL, do nothing as there is nothing to
- * delete.
+/**************** hashWord() ****************/
+/* Return the hash of the word, never 0: FNV-1a, then a finalizer so
+ * that the low bits, which pick a slot, depend on every byte.
+ */
+static uint64_t hashWord(const char* word) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const unsigned char* c = (const unsigned char*) word; *c != '\0'; c++) {
+    hash = (hash ^ *c) * 0x100000001b3ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash != 0 ? hash : 1;    // 0 marks an empty slot
+}
+
+/**************** lookup() ****************/
+/* Probe for the word, whose hash is given, from the slot its low bits
+ * pick; comparing cached hashes first, so strcmp runs (almost) only on
+ * the word itself.
+ * Return its slot, or the empty slot where it would go.
+ */
+static term_t* lookup(index_t* index, const char* word, const uint64_t hash) {
+  size_t mask = index->numSlots - 1;
+  size_t i = hash & mask;
+  while (index->terms[i].hash != 0
+         && (index->terms[i].hash != hash || strcmp(index->arena + index->terms[i].word, word) != 0)) {
+    i = (i + 1) & mask;
+  }
+  return &index->terms[i];
+}
+
+/**************** findOrAdd() ****************/
+/* Return the postings of the word, first adding it to the index, with
+ * new postings, if it is not there; or NULL if out of memory.
+ */
+static postings_t* findOrAdd(index_t* index, const char* word) {
+  term_t* term = addWord(index, word, hashWord(word), NULL);
+  return term ? term->postings : NULL;
+}
+
+/**************** addWord() ****************/
+/* Return the term of the word, whose hash is given, first adding it to
+ * the index if it is not there, with the given postings, which the
+ * index then owns, or new ones if NULL; or NULL if out of memory.
+ */
+static term_t* addWord(index_t* index, const char* word, const uint64_t hash, postings_t* postings) {
+  term_t* term = lookup(index, word, hash);
+  if (term->hash != 0) {
+    return term;
+  }
+
+  // keep the table at most three-quarters full, so probes stay short
+  if ((index->numWords + 1) * 4 > index->numSlots * 3) {
+    if (!grow(index)) {
+      return NULL;
+    }
+    term = lookup(index, word, hash);
+  }
+  // copy the word to the end of the arena
+  size_t length = strlen(word) + 1;
+  if (index->arenaLength + length > index->arenaRoom) {
+    size_t room = index->arenaRoom ? index->arenaRoom * 2 : 4096;
+    while (room < index->arenaLength + length) {
+      room *= 2;
+    }
+    char* arena = realloc(index->arena, room);
+    if (arena == NULL) {
+      return NULL;
+    }
+    index->arena = arena;
+    index->arenaRoom = room;
+  }
+  if (postings == NULL && (postings = postings_new()) == NULL) {
+    return NULL;
+  }
+  memcpy(index->arena + index->arenaLength, word, length);
+  *term = (term_t) { hash, index->arenaLength, postings };
+  index->arenaLength += length;
+  index->postingsSize += postings_size(postings);
+  index->numWords++;
+  return term;
+}
+
+/**************** adopt() ****************/
+/* Move every word of other, with its postings, into the index, merging
+ * its postings into the index's if the word is there already; other is
+ * left with only those it could not give away, for index_delete.
+ * Return false if out of memory.
+ */
+static bool adopt(index_t* index, index_t* other) {
+  for (size_t i = 0; i < other->numSlots; i++) {
+    term_t* from = &other->terms[i];
+    if (from->hash == 0) {
+      continue;
+    }
+    term_t* into = addWord(index, other->arena + from->word, from->hash, from->postings);
+    if (into == NULL) {
+      return false;
+    }
+    if (into->postings == from->postings) {
+      from->postings = NULL;    // the index has them now
+      continue;
+    }
+    size_t before = postings_size(into->postings);
+    bool merged = postings_merge(into->postings, from->postings, 0);
+    account(index, into->postings, before);
+    if (!merged) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**************** account() ****************/
+/* Count, in the index's postingsSize, any change in the bytes that
+ * postings of the index allocated, from before bytes, so that
+ * index_size need not look at every word.
+ */
+static void account(index_t* index, const postings_t* postings, const size_t before) {
+  index->postingsSize = index->postingsSize - before + postings_size(postings);
+}
+
+/**************** grow() ****************/
+/* Move every word into a table of twice as many slots, placing each by
+ * its cached hash; the words stay where they are in the arena.
+ * Return false if out of memory, leaving the index as it was.
+ */
+static bool grow(index_t* index) {
+  size_t numSlots = index->numSlots * 2;
+  term_t* terms = calloc(numSlots, sizeof(term_t));
+  if (terms == NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < index->numSlots; i++) {
+    if (index->terms[i].hash != 0) {
+      size_t j = index->terms[i].hash & (numSlots - 1);
+      while (terms[j].hash != 0) {
+        j = (j + 1) & (numSlots - 1);
+      }
+      terms[j] = index->terms[i];
+    }
+  }
+  free(index->terms);
+  index->terms = terms;
+  index->numSlots = numSlots;
+  return true;
+}
+
+/**************** word_collect() ****************/
+/* index itemfunc: append the word and its postings to the array_t
+ * of wordentry_t at arg
+ */
+static void word_collect(void* arg, const char* word, postings_t* postings) {
+  array_t* words = arg;
+  ((wordentry_t*) words->items)[words->count++] = (wordentry_t) { word, postings };
+}
+
+/**************** word_compare() ****************/
+/* qsort comparator: wordentry_t by word
+ */
+static int word_compare(const void* a, const void* b) {
+  return strcmp(((const wordentry_t*) a)->word, ((const wordentry_t*) b)->word);
+}
+
+/**************** word_merge() ****************/
+/* index itemfunc for index_merge: merge the word's postings, up to
+ * the limit, into the index's postings for the word, adding the word
+ * only if some docID is below the limit, so that no word ends up with
+ * no postings
+ */
+static void word_merge(void* arg, const char* word, postings_t* postings) {
+  merge_t* merge = arg;
+  const int* docIDs = postings_docIDs(postings);
+  if (docIDs == NULL || (merge->limit > 0 && docIDs[0] >= merge->limit)) {
+    return;
+  }
+  postings_t* into = findOrAdd(merge->index, word);
+  size_t before = postings_size(into);
+  if (into == NULL || !postings_merge(into, postings, merge->limit)) {
+    merge->ok = false;
+  }
+  if (into != NULL) {
+    account(merge->index, into, before);
+  }
+}
+
+/**************** sortWords() ****************/
+/* Return an array of the words of the index, with their postings, in
+ * strcmp order, which the caller must mem_free, and set numWords to
+ * their number.
+ */
+static wordentry_t* sortWords(index_t* index, int* numWords) {
+  array_t words = { NULL, 0 };
+  words.items = mem_malloc_assert((index->numWords + 1) * sizeof(wordentry_t), "index words");
+  index_iterate(index, &words, word_collect);
+  qsort(words.items, words.count, sizeof(wordentry_t), word_compare);
+  *numWords = words.count;
+  return words.items;
+}
+
+/**************** leastTerm() ****************/
+/* Return the least word of the next terms of the mapped inputs, in
+ * strcmp order, or NULL if they have none left; clear ok, and return
+ * NULL, if one of those terms is damaged.
+ */
+static const char* leastTerm(index_t** inputs, const int numInputs, const uint64_t* next, bool* ok) {
+  const char* least = NULL;
+  for (int i = 0; i < numInputs; i++) {
+    const binaryfile_t* binary = &inputs[i]->binary;
+    if (next[i] < binary->numTerms) {
+      if (binary->terms[next[i]].word >= binary->wordsLength) {
+        *ok = false;
+        return NULL;
+      }
+      const char* word = binary->words + binary->terms[next[i]].word;
+      if (least == NULL || strcmp(word, least) < 0) {
+        least = word;
+      }
+    }
+  }
+  return least;
+}
+
+/**************** gatherTerm() ****************/
+/* Gather the word's postings from every input whose next term it is,
+ * moving those inputs past it, and leave the deleted docIDs out.
+ * Return the postings, which the caller must postings_delete, or NULL
+ * if an input's postings are damaged, or out of memory.
  */
-void hashtable_indexDelete(void* item) { 
-  if (item != NULL) { // if there are counters in the hashtable
-    counters_delete(item);  // delete the counters
+static postings_t* gatherTerm(index_t** inputs, const int numInputs, uint64_t* next, const char* word,
+                              const tombstones_t* deleted, scratch_t* scratch) {
+  postings_t* postings = postings_new();
+  postings_t* part = postings_new();
+  bool ok = postings != NULL && part != NULL;
+  for (int i = 0; ok && i < numInputs; i++) {
+    const binaryfile_t* binary = &inputs[i]->binary;
+    if (next[i] < binary->numTerms && strcmp(binary->words + binary->terms[next[i]].word, word) == 0) {
+      const binaryterm_t* term = &binary->terms[next[i]++];
+      ok = term->numDocs == 0
+        || (termFits(binary, term)
+            && decodePostings(binary->postings + term->postings, binary->postings + term->postings + term->length,
+                              term->numDocs, scratch, part)
+            && postings_merge(postings, part, 0));
+      postings_delete(part);
+      part = postings_new();
+      ok = ok && part != NULL;
+    }
+  }
+  postings_delete(part);
+  if (!ok) {
+    postings_delete(postings);
+    return NULL;
   }
+  tombstones_filter(deleted, postings);
+  return postings;
 }
 
+/**************** runNextWord() ****************/
+/* Move the run on to the word at the start of its next line, and the
+ * first pair after it, or set ended if there is none.
+ * Return false if out of memory.
+ */
+static bool runNextWord(run_t* run) {
+  int c;
+  do {
+    c = getc_unlocked(run->fp);   // no other thread has the file
+  } while (c != EOF && isspace(c));
+  if (c == EOF) {
+    run->ended = true;
+    run->hasPair = false;
+    return true;
+  }
+  size_t length = 0;
+  for (; c != EOF && !isspace(c); c = getc_unlocked(run->fp)) {
+    if (length + 1 >= run->wordRoom) {
+      size_t room = run->wordRoom ? run->wordRoom * 2 : 64;
+      char* word = realloc(run->word, room);
+      if (word == NULL) {
+        return false;
+      }
+      run->word = word;
+      run->wordRoom = room;
+    }
+    run->word[length++] = c;
+  }
+  run->word[length] = '\0';
+  if (c != EOF) {
+    ungetc(c, run->fp);   // it may be the newline that ends the word's pairs
+  }
+  runNextPair(run);
+  return true;
+}
+
+/**************** runNextPair() ****************/
+/* Move the run on to the next pair of its line, or, if the line has
+ * no more pairs (or the rest of it is not pairs), past the end of the
+ * line, clearing hasPair.
+ */
+static void runNextPair(run_t* run) {
+  run->hasPair = readNumber(run->fp, &run->docID) && readNumber(run->fp, &run->count);
+  if (!run->hasPair) {
+    int c;
+    while ((c = getc_unlocked(run->fp)) != EOF && c != '\n') {
+    }
+  }
+}
+
+/**************** readNumber() ****************/
+/* Read the decimal number after any spaces on the line of fp into
+ * value, leaving what follows it unread.
+ * Return false if there is no number there, or it is too big for an int.
+ */
+static bool readNumber(FILE* fp, int* value) {
+  int c;
+  do {
+    c = getc_unlocked(fp);
+  } while (c != EOF && c != '\n' && isspace(c));
+  if (c < '0' || c > '9') {
+    if (c != EOF) {
+      ungetc(c, fp);
+    }
+    return false;
+  }
+  long long number = 0;
+  for (; c >= '0' && c <= '9'; c = getc_unlocked(fp)) {
+    number = number * 10 + (c - '0');
+    if (number > INT_MAX) {
+      return false;
+    }
+  }
+  if (c != EOF) {
+    ungetc(c, fp);
+  }
+  if (c != EOF && !isspace(c)) {
+    return false;   // as in "12abc"
+  }
+  *value = number;
+  return true;
+}
+
+/**************** readFile() ****************/
+/* Read the whole of the file open on fp into memory, and set size to
+ * its length. Return the bytes, with a '\0' after them, which the
+ * caller must free, or NULL if the file cannot be read or out of memory.
+ */
+static char* readFile(FILE* fp, size_t* size) {
+  if (fseek(fp, 0, SEEK_END) != 0) {
+    return NULL;
+  }
+  long length = ftell(fp);
+  rewind(fp);
+  if (length < 0) {
+    return NULL;
+  }
+  char* text = malloc(length + 1);
+  if (text != NULL && fread(text, 1, length, fp) != (size_t) length) {
+    free(text);
+    return NULL;
+  }
+  if (text != NULL) {
+    text[length] = '\0';
+    *size = length;
+  }
+  return text;
+}
+
+/**************** loadBinary() ****************/
+/* Read the index from a file index_writeBinary wrote, open on fp.
+ * Return the index, or NULL if the file is not a valid binary index
+ * or out of memory.
+ */
+static index_t* loadBinary(FILE* fp) {
+  size_t size;
+  char* file = readFile(fp, &size);
+  index_t* index = NULL;
+  if (file != NULL && size >= sizeof(binaryheader_t)) {
+    index = parseBinary((const uint8_t*) file, size);
+  }
+  free(file);
+  return index;
+}
+
+/**************** parseBinary() ****************/
+/* Build an index from the size bytes of a binary index file at file,
+ * checking that every part of the file lies where the header says and
+ * decodes to sorted, positive postings.
+ * Return the index, or NULL if the file is not valid or out of memory.
+ */
+static index_t* parseBinary(const uint8_t* file, const size_t size) {
+  binaryfile_t binary;
+  if (!openBinary(file, size, &binary)) {
+    return NULL;
+  }
+  index_t* index = index_newSized(binary.numTerms);
+  scratch_t scratch = { NULL, NULL, 0 };
+  bool ok = index != NULL;
+  for (uint64_t i = 0; ok && i < binary.numTerms; i++) {
+    const binaryterm_t* term = &binary.terms[i];
+    ok = termFits(&binary, term);
+    if (ok && term->numDocs > 0) {
+      postings_t* into = findOrAdd(index, binary.words + term->word);
+      size_t before = postings_size(into);
+      ok = into != NULL
+        && decodePostings(binary.postings + term->postings, binary.postings + term->postings + term->length,
+                          term->numDocs, &scratch, into);
+      if (into != NULL) {
+        account(index, into, before);
+      }
+    }
+  }
+  free(scratch.docIDs);
+  free(scratch.counts);
+  if (!ok) {
+    index_delete(index);
+    return NULL;
+  }
+  return index;
+}
+
+/**************** openBinary() ****************/
+/* Check the header of the size bytes of a binary index file at file:
+ * its magic and version, and that the terms, words, and postings it
+ * says are there fit the file, one after the other.
+ * Return true, and set binary to where the parts are, if they do.
+ */
+static bool openBinary(const uint8_t* file, const size_t size, binaryfile_t* binary) {
+  const binaryheader_t* header = (const binaryheader_t*) file;
+  const size_t termsOffset = sizeof(binaryheader_t);
+  if (size < termsOffset
+      || memcmp(header->magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0
+      || header->version != BINARY_VERSION
+      || header->length != size
+      || header->numTerms > (size - termsOffset) / sizeof(binaryterm_t)
+      || header->numTerms > INT_MAX
+      || header->wordsOffset != termsOffset + header->numTerms * sizeof(binaryterm_t)
+      || header->postingsOffset < header->wordsOffset || header->postingsOffset > size
+      || (header->postingsOffset > header->wordsOffset && file[header->postingsOffset - 1] != '\0')) {
+    return false;
+  }
+  binary->terms = (const binaryterm_t*) (file + termsOffset);
+  binary->numTerms = header->numTerms;
+  binary->words = (const char*) file + header->wordsOffset;
+  binary->wordsLength = header->postingsOffset - header->wordsOffset;
+  binary->postings = file + header->postingsOffset;
+  binary->postingsLength = size - header->postingsOffset;
+  return true;
+}
+
+/**************** termFits() ****************/
+/* Return true if the term's word starts within the words (and so ends
+ * there too) and its postings lie within the postings.
+ */
+static bool termFits(const binaryfile_t* binary, const binaryterm_t* term) {
+  return term->word < binary->wordsLength
+      && term->postings <= binary->postingsLength
+      && term->length <= binary->postingsLength - term->postings;
+}
+
+/**************** decodeTerm() ****************/
+/* Return new postings of the term of a mapped index, which the caller
+ * must postings_delete; empty if the term is out of place or its
+ * postings are damaged, and NULL if out of memory.
+ */
+static postings_t* decodeTerm(const binaryfile_t* binary, const binaryterm_t* term) {
+  postings_t* postings = postings_new();
+  scratch_t scratch = { NULL, NULL, 0 };
+  if (postings != NULL && term->numDocs > 0 && termFits(binary, term)) {
+    // leaves the postings empty if they do not decode
+    decodePostings(binary->postings + term->postings, binary->postings + term->postings + term->length,
+                   term->numDocs, &scratch, postings);
+  }
+  free(scratch.docIDs);
+  free(scratch.counts);
+  return postings;
+}
+
+/**************** decodePostings() ****************/
+/* Decode the numDocs (docID delta, count) varint pairs that fill the
+ * bytes from at to end, into scratch, and append them to the postings.
+ * Return false if they do not fill the bytes exactly, a docID is out
+ * of range, or out of memory.
+ */
+static bool decodePostings(const uint8_t* at, const uint8_t* end, const uint32_t numDocs,
+                           scratch_t* scratch, postings_t* postings) {
+  if (numDocs > (end - at) / 2) {   // each pair takes at least two bytes
+    return false;
+  }
+  if (numDocs > scratch->room) {
+    int* docIDs = realloc(scratch->docIDs, numDocs * sizeof(int));
+    if (docIDs != NULL) {
+      scratch->docIDs = docIDs;
+    }
+    int* counts = realloc(scratch->counts, numDocs * sizeof(int));
+    if (counts != NULL) {
+      scratch->counts = counts;
+    }
+    if (docIDs == NULL || counts == NULL) {
+      return false;
+    }
+    scratch->room = numDocs;
+  }
+  int64_t docID = 0;
+  for (uint32_t i = 0; i < numDocs; i++) {
+    uint32_t delta;
+    uint32_t count;
+    if (!getVarint(&at, end, &delta) || !getVarint(&at, end, &count)
+        || (docID += delta) > INT_MAX || count == 0 || count > INT_MAX) {
+      return false;
+    }
+    scratch->docIDs[i] = docID;
+    scratch->counts[i] = count;
+  }
+  // postings_append checks that the docIDs increase
+  return at == end && postings_append(postings, scratch->docIDs, scratch->counts, numDocs);
+}
+
+/**************** encodePostings() ****************/
+/* Encode the postings as (docID delta, count) varint pairs, the first
+ * delta from 0, into the buffer, unless it is NULL.
+ * Return the number of bytes they take.
+ */
+static size_t encodePostings(const postings_t* postings, uint8_t* buffer) {
+  const int* docIDs = postings_docIDs(postings);
+  const int* counts = postings_counts(postings);
+  size_t bytes = 0;
+  int previous = 0;
+  for (int i = 0; i < postings_length(postings); i++) {
+    bytes += putVarint(buffer ? buffer + bytes : NULL, docIDs[i] - previous);
+    bytes += putVarint(buffer ? buffer + bytes : NULL, counts[i]);
+    previous = docIDs[i];
+  }
+  return bytes;
+}
+
+/**************** putVarint() ****************/
+/* Write the value as a varint, seven bits a byte, least significant
+ * first, with the high bit set on all but the last byte, into the
+ * buffer, unless it is NULL.
+ * Return the number of bytes it takes, 1 to 5.
+ */
+static size_t putVarint(uint8_t* buffer, uint32_t value) {
+  size_t bytes = 0;
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (buffer != NULL) {
+      buffer[bytes] = byte | (value != 0 ? 0x80 : 0);
+    }
+    bytes++;
+  } while (value != 0);
+  return bytes;
+}
+
+/**************** getVarint() ****************/
+/* Read a varint that putVarint wrote, from *at but not past end, into
+ * value, moving *at past it.
+ * Return false if it runs past end or does not fit 32 bits.
+ */
+static bool getVarint(const uint8_t** at, const uint8_t* end, uint32_t* value) {
+  uint32_t result = 0;
+  for (int shift = 0; shift < 35 && *at < end; shift += 7) {
+    uint8_t byte = *(*at)++;
+    if (shift == 28 && (byte & 0x70) != 0) {
+      return false;
+    }
+    result |= (uint32_t) (byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
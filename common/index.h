@@ -5,6 +5,51 @@
  * the in-memory index, and functions to read and write 
  * index files.
  *
+ * The index maps each word to its postings: the (docID,
+ * count) pairs of the documents it is in, sorted by docID
+ * (see postings.h). Its words live in an open-addressed table that
+ * caches each word's hash and doubles when three-quarters
+ * full, with the words themselves packed back to back in
+ * one arena, so that finding or adding a word costs a probe
+ * or two and no allocation beyond the word's postings.
+ *
+ * An index file is written as text (index_write), one word
+ * per line followed by its docID count pairs, or in a binary
+ * format (index_writeBinary) that is smaller and quicker to
+ * load; index_load reads either. The binary file is, in the
+ * machine's byte order:
+ *   a header: the 8 bytes "TSEINDEX", the format version (1)
+ *     and a reserved 0, as 32-bit integers, then the number
+ *     of terms, the file offsets of the words and of the
+ *     postings, and the file length, as 64-bit integers;
+ *   one 24-byte term per word, in strcmp order of the words:
+ *     the offsets of its word in the words and of its postings
+ *     in the postings, as 64-bit integers, then the number of
+ *     its docIDs and the length of its postings in bytes, as
+ *     32-bit integers;
+ *   the words, each followed by a '\0';
+ *   the postings of each term: for each docID, in increasing
+ *     order, its difference from the docID before (or from 0),
+ *     then its count, each as a varint - seven bits a byte,
+ *     least significant first, with the high bit set on all
+ *     but the last byte.
+ *
+ * A binary index file can also be mapped into memory as is
+ * (index_map), read-only, and searched in place: a lookup
+ * binary-searches the terms and decodes just the postings of
+ * the word looked up, so mapping takes the same (short) time
+ * however big the index, and processes that map one file
+ * share one copy of it in the page cache.
+ *
+ * Since a text index file has its words in strcmp order,
+ * several of them can be merged into one (index_mergeFiles)
+ * a line at a time, without loading any: so an index too big
+ * for memory can be built in pieces, each written out once
+ * index_size says it has grown big enough, and merged at the end.
+ * Binary index files merge the same way (index_mergeBinary),
+ * a term at a time; that is how the segments of an index
+ * built up in increments are combined (see segments.h).
+ *
  * Charlie Childress, February 2022, cs50
  */
 
@@ -15,60 +60,150 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
-#include "hashtable.h"
+#include "postings.h"
+#include "tombstones.h"
 
 /**************** global types ****************/
 typedef struct index index_t;
 
-/**************** global types ****************/
-hashtable_t* index_get_hashtable(index_t* index);
-
 /**************** index_new ****************/
 /* Parameters:
  *  none
  *
- * create a new index and instantiate it with
- * a hashtable of size 200. This size is arbitrary
- * as it is difficult to know the size of the 
- * hashtable. Could be any size from 200-900
- * according to the specs
+ * create a new, empty index, whose table starts
+ * small and grows as words are added
+ *
+ * Return the new index if everything is successful
+ * Return NULL if there are any errors
+ */
+index_t* index_new(void);
+
+/**************** index_newSized ****************/
+/* Parameters:
+ *  the number of words expected, or 0 if unknown
+ *
+ * create a new, empty index as index_new does, with
+ * its table sized up front to hold that many words
+ * without growing
  *
  * Return the new index if everything is successful
  * Return NULL if there are any errors
  */
-index_t* index_new();
+index_t* index_newSized(const int expectedWords);
 
 /**************** index_insert ****************/
 /* Parameters:
- *  index struct that has a hashtable item, a char*
- *  that we want to put into the hashtable, and a
- *  int for the docID for the counter
+ *  index, a char* word that we want to put into
+ *  the index, and a int for the docID it is in
  *
  * Make sure all of the paramters are valid and 
- * then use the word as a key for the hashtable 
- * and the docID as the item/counter for the index.
+ * then add one to the word's count for the docID
+ * in its postings, adding the word if it is new.
  *
  * Return true if the process runs successfully
  * Return false if any errors occur
  */
 bool index_insert(index_t* index, const char* word, int docID);
 
+/**************** index_insertSpan ****************/
+/* Parameters:
+ *  index, the len characters of a word at word,
+ *  which need not be null-terminated (e.g., from
+ *  webpage_getNextSpan), and a docID
+ *
+ * Normalize the word (see normalizeSpan) and
+ * insert it as index_insert does, without
+ * changing the characters at word
+ *
+ * Return true if the process runs successfully
+ * Return false if any errors occur
+ */
+bool index_insertSpan(index_t* index, const char* word, const size_t len, int docID);
+
+/**************** index_find ****************/
+/* Parameters:
+ *  index, and a (normalized) word
+ *
+ * Return the postings of the word, which belong to
+ * the index, or NULL if the word is not in the index,
+ * either parameter is NULL, or the index is mapped
+ * (see index_lookup)
+ */
+postings_t* index_find(index_t* index, const char* word);
+
+/**************** index_lookup ****************/
+/* Parameters:
+ *  index, mapped or not, and a (normalized) word
+ *
+ * Return new postings of the word, which the caller
+ * must postings_delete: a copy of them if the index
+ * is in memory, or decoded from the file if it is
+ * mapped; empty if the word is not in the index (or
+ * its entry in a mapped file is damaged); NULL if
+ * either parameter is NULL or out of memory
+ */
+postings_t* index_lookup(index_t* index, const char* word);
+
+/**************** index_count ****************/
+/* Return the number of words in the index, or 0 if
+ * index is NULL
+ */
+int index_count(index_t* index);
+
+/**************** index_size ****************/
+/* Return about how many bytes the index has allocated,
+ * its words and postings included, or 0 if index is
+ * NULL. The file of a mapped index is not counted.
+ */
+size_t index_size(index_t* index);
+
+/**************** index_iterate ****************/
+/* Call itemfunc(arg, word, postings) on every word of
+ * the index, in no particular order. The itemfunc
+ * must not add words to the index. NULL index or
+ * itemfunc, or a mapped index, is ignored.
+ */
+void index_iterate(index_t* index, void* arg, void (*itemfunc)(void* arg, const char* word, postings_t* postings));
+
 /**************** index_load() ****************/
 /* Parameter:
  *  oldIndexFilename in which an index has already
  *  been printed on
  *
- * load the index from the oldIndexFilename into 
+ * load the index from the oldIndexFilename, which
+ * index_write or index_writeBinary wrote (index_load
+ * tells which from the start of the file), into 
  * an inverted-index data structurem thus allowing
  * us to create a file newIndexFilename and write 
  * the index to that file, used in indextester.c
  *
+ * A text file is read in one pass; a big one is
+ * parsed in chunks, on as many threads as there are
+ * processors.
+ *
  * Return the index_t* that we will use to write
  * onto the new file
- * If there is an error, exits program
+ * Return NULL, printing an error to stderr, if the
+ * file cannot be opened or is not a valid index
  */
 index_t* index_load(const char* oldIndexFilename);
 
+/**************** index_map ****************/
+/* Parameters:
+ *  name of a file index_writeBinary wrote
+ *
+ * Map the file into memory, read-only, checking only
+ * its header; each index_lookup reads the file in
+ * place. A mapped index answers index_lookup and
+ * index_count; it cannot be added to, found in with
+ * index_find, iterated, written, or merged.
+ *
+ * Return the index, or NULL (printing nothing) if the
+ * file does not exist or is not a binary index, such
+ * as a text one, which index_load can read instead
+ */
+index_t* index_map(const char* indexFilename);
+
 /**************** index_write ****************/
 /* Parameters:
  *  char* newIndexFilename as our new file and 
@@ -76,21 +211,94 @@ index_t* index_load(const char* oldIndexFilename);
  *  into the file
  *
  * Check if the file is able to be opened/created
+ * (and the index is not mapped)
  * and if it is, go through the contents of
- * the index and print it into the new file
+ * the index and print it into the new file,
+ * words in strcmp order and each word's postings
+ * by increasing docID, so that an index prints
+ * the same however it was built
  *
  * Return true if the process runs successfully
  * Return false if any errors occur
  */
 bool index_write(index_t* index, char* newIndexFilename);
 
+/**************** index_writeBinary ****************/
+/* Parameters:
+ *  index, and the name of the file to write it to
+ *
+ * Write the index into the file in the binary format
+ * (see above), words in strcmp order, so that an index
+ * writes the same however it was built
+ *
+ * Return true if the process runs successfully
+ * Return false if any errors occur
+ */
+bool index_writeBinary(index_t* index, const char* newIndexFilename);
+
+/**************** index_merge ****************/
+/* Parameters:
+ *  index to merge into, another index to merge from,
+ *  and a limit on docIDs (0 for none)
+ *
+ * Add every (docID, count) of the other index, for
+ * docIDs below the limit, to the index, summing the
+ * counts of any docID both have for a word. The other
+ * index is not changed, and may then be deleted.
+ *
+ * Return true if the process runs successfully
+ * Return false if any parameter is NULL, or they are
+ * the same index
+ */
+bool index_merge(index_t* index, index_t* other, const int limit);
+
+/**************** index_mergeFiles ****************/
+/* Parameters:
+ *  names of numFiles text index files, each written by
+ *  index_write (or this function), the name of the
+ *  index file to write, and a limit on docIDs (0 for none)
+ *
+ * Write the file index_write would write of the
+ * index_merge of all their indexes, from the files a
+ * line at a time, a pair at a time: it takes a
+ * buffer per file, however big the files are.
+ *
+ * Return true if the file was written, false on bad
+ * parameters, or (printing an error to stderr) if a
+ * file cannot be opened, or on any other error
+ */
+bool index_mergeFiles(char** indexFilenames, const int numFiles, const char* newIndexFilename, const int limit);
+
+/**************** index_mergeBinary ****************/
+/* Parameters:
+ *  names of numFiles binary index files, each written by
+ *  index_writeBinary (or this function), the name of
+ *  the binary index file to write, and the docIDs to
+ *  leave out (NULL for none)
+ *
+ * Write the file index_writeBinary would write of the
+ * index_merge of all their indexes, mapping the files
+ * and going through their terms together, in order: it
+ * holds one word's postings at a time, however big the
+ * files are. The pairs of deleted docIDs are dropped,
+ * and so is a word left with none; where each part of
+ * the file goes is worked out first, and with deleted
+ * docIDs that takes reading every word's postings twice.
+ *
+ * Return true if the file was written, false on bad
+ * parameters, or (printing an error to stderr) if a
+ * file is not a binary index, or on any other error
+ */
+bool index_mergeBinary(char** indexFilenames, const int numFiles, const char* newIndexFilename,
+                       const tombstones_t* deleted);
+
 /**************** index_delete ****************/
 /* Parameters:
  *  index struct that we want to delete
  *
- * If the index is not NULL, call hashtable_delete
- * to delete the contents of the hashtable and then
- * free the index.
+ * If the index is not NULL, delete the postings of
+ * every word, the table and its words, or unmap the
+ * file of a mapped index, and then free the index.
  * If the index is NULL, simply do nothing as there
  * is no memory to free
  */
@@ -7,20 +7,70 @@
  * Used pseudocode from cs50 webpage
  */
 
+#define _GNU_SOURCE       // pread, pwritev, madvise
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 #include "pagedir.h"
 #include "webpage.h"
 #include "mem.h"
 #include "file.h"
 
 /**************** file-local global variables ****************/
-/* none */
+static const char* PACKED = "packed";         // the .crawler of a packed pageDirectory says so
+static const char* CRAWL = "crawl";           // and the second line of .crawler names its crawl
+static const off_t SEGMENT_BYTES = 64 << 20;  // a segment takes no more pages once this big
 
 /**************** local types ****************/
-/* none */
+// where a page is in a packed pageDirectory; pages.idx holds one per docID, in docID order
+typedef struct pageref {
+  uint32_t segment;           // which pages.N holds the page
+  uint32_t length;            // bytes of the page, or 0 if the docID was never saved
+  uint64_t offset;            // where the page starts in pages.N
+} pageref_t;
+
+// one segment file of a packed pageDirectory
+typedef struct segment {
+  int fd;                     // pages.N, opened as needed; -1 if not yet
+  char* map;                  // the file mapped read-only, once a page is loaded mapped, or NULL
+  size_t mapLength;           // bytes mapped: the file's size when it was mapped
+} segment_t;
+
+// a page file mapped by pagedir_loadMapped in a legacy pageDirectory
+typedef struct mapping {
+  void* addr;
+  size_t length;
+} mapping_t;
+
+// an open pageDirectory
+typedef struct pagestore {
+  char* pageDirectory;        // its name
+  bool packed;                // whether pages are packed in segments, or one file each
+  int indexFd;                // pages.idx, if packed
+  segment_t* segments;        // pages.N, opened and mapped as needed
+  int numSegments;            // room in segments
+  int lastSegment;            // the segment pages are appended to
+  off_t lastOffset;           // where the next page goes in it
+  int syncedSegment;          // the first segment written to since pagedir_sync, if packed
+  int syncedDocID;            // the first page file not yet synced by pagedir_sync, if not
+  pthread_mutex_t lock;       // protects all of the above but pageDirectory and packed
+  struct pagestore* next;     // the next open pageDirectory
+} pagestore_t;
+
+// the open pageDirectories; 'storesLock' protects the list (each store has its own lock)
+static pagestore_t* stores = NULL;
+static pthread_mutex_t storesLock = PTHREAD_MUTEX_INITIALIZER;
 
 /**************** global types ****************/
 /* none */
@@ -31,15 +81,27 @@
 
 /**************** local functions ****************/
 /* not visible outside this file */
-/* none */
+static pagestore_t* storeGet(const char* pageDirectory);
+static void storeFree(pagestore_t* store);
+static int segmentFd(pagestore_t* store, const int segment);
+static char* segmentMap(pagestore_t* store, const int segment, const size_t end);
+static char* pathname(const char* pageDirectory, const char* name);
+static bool syncDirectory(const char* pageDirectory);
+static void packedSave(pagestore_t* store, const webpage_t* page, const int docID);
+static char* packedRead(pagestore_t* store, const int docID, const size_t limit, size_t* length);
+static webpage_t* packedLoad(pagestore_t* store, const int docID);
+static webpage_t* viewPage(const char* text, const size_t length, void (*release)(void* arg), void* arg);
+static void unmapPage(void* arg);
+static uint64_t newCrawlID(void);
 
 /**************** pagedir_init() ****************/
 /* see pagedir.h for description */
-bool pagedir_init(const char* pageDirectory) {
+bool pagedir_init(const char* pageDirectory, const bool packed) {
   // make sure the directory is not empty; if it is return false as we cannot initialize anything
   if (pageDirectory == NULL) {
     return false;
   }
+  pagedir_close(pageDirectory);   // forget what we knew of any earlier crawl here
   
   // construct a pathname
   FILE* fp;
@@ -55,15 +117,41 @@ bool pagedir_init(const char* pageDirectory) {
     return false;
   }
 
+  // mark a packed directory as such (the first line is empty for one file per page), give
+  // the crawl its identity, and clear out the pages of any earlier packed crawl
+  bool ok = fprintf(fp, "%s\n%s %016" PRIx64 "\n", packed ? PACKED : "", CRAWL, newCrawlID()) > 0;
+  if (packed) {
+    char* name = pathname(pageDirectory, "pages.idx");
+    unlink(name);
+    free(name);
+    for (int segment = 0; ; segment++) {
+      char number[24];
+      sprintf(number, "pages.%d", segment);
+      name = pathname(pageDirectory, number);
+      int removed = unlink(name);
+      free(name);
+      if (removed != 0) {
+        break;
+      }
+    }
+  }
+
   // close the file and free the filename memory
-  fclose(fp);
+  ok = fclose(fp) == 0 && ok;
   free(filename);
-  return true;    // return true for a successful initilialization
+  return ok;    // return true for a successful initilialization
 }
 
 /**************** pagedir_save() ****************/
 /* see pagedir.h for description */
 void pagedir_save(const webpage_t* page, const char* pageDirectory, const int docID) {
+  pagestore_t* store = storeGet(pageDirectory);
+  if (store != NULL && store->packed) {
+    if (page != NULL && docID > 0) {
+      packedSave(store, page, docID);
+    }
+    return;
+  }
   // check that the directory and webpage are not empty
   if(pageDirectory != NULL && page != NULL) {
     FILE* fp;
@@ -86,6 +174,86 @@ void pagedir_save(const webpage_t* page, const char* pageDirectory, const int do
   }
 }
 
+/**************** pagedir_truncate() ****************/
+/* see pagedir.h for description */
+void pagedir_truncate(const char* pageDirectory, const int docID) {
+  pagestore_t* store = storeGet(pageDirectory);
+  if (store != NULL && store->packed) {
+    // forget the pages from docID on; their bytes stay in the segments, unreferenced
+    if (docID > 0) {
+      pthread_mutex_lock(&store->lock);
+      struct stat st;
+      off_t keep = (off_t) (docID - 1) * sizeof(pageref_t);
+      if (fstat(store->indexFd, &st) == 0 && st.st_size > keep && ftruncate(store->indexFd, keep) != 0) {
+        fprintf(stderr, "error when truncating %s/pages.idx\n", pageDirectory);
+      }
+      pthread_mutex_unlock(&store->lock);
+    }
+    return;
+  }
+  if (pageDirectory != NULL && docID > 0) {
+    char* filename = malloc((strlen(pageDirectory) + 12));  // allocate memory for filename
+    // remove files in docID order until one is missing
+    for (int id = docID; ; id++) {
+      sprintf(filename, "%s/%d", pageDirectory, id);
+      if (remove(filename) != 0) {
+        break;
+      }
+    }
+    free(filename);
+  }
+}
+
+/**************** pagedir_sync() ****************/
+/* see pagedir.h for description */
+bool pagedir_sync(const char* pageDirectory, const int docID) {
+  pagestore_t* store = storeGet(pageDirectory);
+  if (store == NULL) {
+    return false;
+  }
+  bool ok = true;
+  if (store->packed) {
+    // the segments written since the last sync, and the index; writes to the last segment
+    // go on meanwhile, so it is synced again next time
+    pthread_mutex_lock(&store->lock);
+    int first = store->syncedSegment;
+    int last = store->lastSegment;
+    store->syncedSegment = last;
+    pthread_mutex_unlock(&store->lock);
+    for (int segment = first; segment <= last; segment++) {
+      // a segment written to is open; one that is not has nothing new
+      pthread_mutex_lock(&store->lock);
+      int fd = segment < store->numSegments ? store->segments[segment].fd : -1;
+      pthread_mutex_unlock(&store->lock);
+      ok = (fd < 0 || fdatasync(fd) == 0) && ok;
+    }
+    ok = fdatasync(store->indexFd) == 0 && ok;
+  } else {
+    // the page files saved since the last sync; a docID whose save failed has none
+    pthread_mutex_lock(&store->lock);
+    int first = store->syncedDocID > 0 ? store->syncedDocID : 1;
+    pthread_mutex_unlock(&store->lock);
+    char* filename = malloc(strlen(pageDirectory) + 12);
+    ok = filename != NULL;
+    for (int id = first; ok && id < docID; id++) {
+      sprintf(filename, "%s/%d", pageDirectory, id);
+      int fd = open(filename, O_RDONLY);
+      if (fd >= 0) {
+        ok = fdatasync(fd) == 0;
+        close(fd);
+      }
+    }
+    free(filename);
+    if (ok) {
+      pthread_mutex_lock(&store->lock);
+      store->syncedDocID = docID > first ? docID : first;
+      pthread_mutex_unlock(&store->lock);
+    }
+  }
+  // and the names of the files made since
+  return syncDirectory(pageDirectory) && ok;
+}
+
 /**************** pagedir_validate() ****************/
 /* see pagedir.h for description */
 bool pagedir_validate(const char* pageDirectory) {
@@ -101,8 +269,7 @@ bool pagedir_validate(const char* pageDirectory) {
       free(filename); // free the filename memory
       return true;  // return true as this filename exists a crawler directory
     } else {
-      fclose(fp); // close the file
-      free(filename); // free the filename memory
+      free(filename); // free the filename memory (there is no file to close)
       return false;  // return as false as this filename does not exist as a crawler directory
     }
   }
@@ -114,6 +281,10 @@ bool pagedir_validate(const char* pageDirectory) {
 webpage_t* pagedir_load(const char* pageDirectory, int docID) {
   if (pageDirectory == NULL || docID < 0) {   //if the directory does not exist or the docID is a bad number, return NULL
     return NULL;
+  }
+  pagestore_t* store = storeGet(pageDirectory);
+  if (store != NULL && store->packed) {
+    return packedLoad(store, docID);
   } else {
     FILE* fp;
     char* filename = malloc((strlen(pageDirectory) + 10));  // alloate memory for the filename
@@ -138,4 +309,474 @@ webpage_t* pagedir_load(const char* pageDirectory, int docID) {
     }
     return NULL;
   }
-}
\ No newline at end of file
+}
+
+/**************** pagedir_loadMapped() ****************/
+/* see pagedir.h for description */
+webpage_t* pagedir_loadMapped(const char* pageDirectory, const int docID) {
+  if (pageDirectory == NULL || docID < 0) {
+    return NULL;
+  }
+  pagestore_t* store = storeGet(pageDirectory);
+  if (store != NULL && store->packed) {
+    pageref_t ref;
+    if (docID < 1 || pread(store->indexFd, &ref, sizeof(ref), (off_t) (docID - 1) * sizeof(ref)) != sizeof(ref)
+        || ref.length == 0) {
+      return NULL;
+    }
+    pthread_mutex_lock(&store->lock);
+    char* map = segmentMap(store, ref.segment, ref.offset + ref.length);
+    pthread_mutex_unlock(&store->lock);
+    if (map == NULL) {
+      // e.g., saved after the segment was mapped; a mapping is never moved, so copy this one
+      return packedLoad(store, docID);
+    }
+    // the segment stays mapped until pagedir_close
+    return viewPage(map + ref.offset, ref.length, NULL, NULL);
+  }
+
+  // one file per page: map the whole file, until the page is deleted
+  char* filename = malloc((strlen(pageDirectory) + 12));  // allocate memory for the filename
+  sprintf(filename, "%s/%d", pageDirectory, docID);
+  int fd = open(filename, O_RDONLY);
+  free(filename);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  mapping_t* mapping = malloc(sizeof(mapping_t));
+  if (mapping == NULL || fstat(fd, &st) != 0 || st.st_size == 0
+      || (mapping->addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+    free(mapping);
+    close(fd);
+    return NULL;
+  }
+  close(fd);    // the mapping keeps the file open
+  mapping->length = st.st_size;
+  webpage_t* page = viewPage(mapping->addr, mapping->length, unmapPage, mapping);
+  if (page == NULL) {
+    unmapPage(mapping);
+  }
+  return page;
+}
+
+/**************** pagedir_getURL() ****************/
+/* see pagedir.h for description */
+char* pagedir_getURL(const char* pageDirectory, const int docID) {
+  if (pageDirectory == NULL || docID < 0) {
+    return NULL;
+  }
+  pagestore_t* store = storeGet(pageDirectory);
+  if (store != NULL && store->packed) {
+    // the URL is the first line of the page; read a little, and more only if it is that long
+    char* url = NULL;
+    size_t length;
+    for (size_t limit = 256; url == NULL; limit *= 4) {
+      char* text = packedRead(store, docID, limit, &length);
+      if (text == NULL) {
+        return NULL;
+      }
+      char* newline = strchr(text, '\n');
+      if (newline != NULL || length < limit) {
+        if (newline != NULL) {
+          *newline = '\0';
+        }
+        url = text;
+      } else {
+        free(text);
+      }
+    }
+    return url;
+  }
+
+  // one file per page: the URL is its first line
+  char* filename = malloc((strlen(pageDirectory) + 12));  // allocate memory for the filename
+  sprintf(filename, "%s/%d", pageDirectory, docID);
+  FILE* fp = fopen(filename, "r");
+  free(filename);
+  if (fp == NULL) {
+    return NULL;
+  }
+  char* url = file_readLine(fp);
+  fclose(fp);
+  return url;
+}
+
+/**************** pagedir_getCrawlID() ****************/
+/* see pagedir.h for description */
+char* pagedir_getCrawlID(const char* pageDirectory) {
+  char* name = pageDirectory ? pathname(pageDirectory, ".crawler") : NULL;
+  FILE* fp = name ? fopen(name, "r") : NULL;
+  free(name);
+  if (fp == NULL) {
+    return NULL;
+  }
+  free(file_readLine(fp));    // the layout
+  char* line = file_readLine(fp);
+  fclose(fp);
+  size_t prefix = strlen(CRAWL);
+  if (line == NULL || strncmp(line, CRAWL, prefix) != 0 || line[prefix] != ' ' || line[prefix + 1] == '\0') {
+    free(line);
+    return NULL;
+  }
+  memmove(line, line + prefix + 1, strlen(line + prefix + 1) + 1);
+  return line;
+}
+
+/**************** pagedir_close() ****************/
+/* see pagedir.h for description */
+void pagedir_close(const char* pageDirectory) {
+  if (pageDirectory != NULL) {
+    pthread_mutex_lock(&storesLock);
+    for (pagestore_t** link = &stores; *link != NULL; link = &(*link)->next) {
+      if (strcmp((*link)->pageDirectory, pageDirectory) == 0) {
+        pagestore_t* store = *link;
+        *link = store->next;
+        storeFree(store);
+        break;
+      }
+    }
+    pthread_mutex_unlock(&storesLock);
+  }
+}
+
+/**************** storeGet() ****************/
+/* Return the open pagestore for the pageDirectory, opening it (and
+ * reading its mode from .crawler) on first use, or NULL on error.
+ */
+static pagestore_t* storeGet(const char* pageDirectory) {
+  if (pageDirectory == NULL) {
+    return NULL;
+  }
+  pthread_mutex_lock(&storesLock);
+  pagestore_t* store;
+  for (store = stores; store != NULL; store = store->next) {
+    if (strcmp(store->pageDirectory, pageDirectory) == 0) {
+      pthread_mutex_unlock(&storesLock);
+      return store;
+    }
+  }
+
+  store = calloc(1, sizeof(pagestore_t));
+  if (store == NULL || (store->pageDirectory = malloc(strlen(pageDirectory) + 1)) == NULL) {
+    free(store);
+    pthread_mutex_unlock(&storesLock);
+    return NULL;
+  }
+  strcpy(store->pageDirectory, pageDirectory);
+  store->indexFd = -1;
+  pthread_mutex_init(&store->lock, NULL);
+
+  // the mode is the first line of .crawler: "packed", or nothing for one file per page
+  char* name = pathname(pageDirectory, ".crawler");
+  FILE* fp = fopen(name, "r");
+  free(name);
+  char* mode = fp != NULL ? file_readLine(fp) : NULL;
+  store->packed = mode != NULL && strcmp(mode, PACKED) == 0;
+  free(mode);
+  if (fp != NULL) {
+    fclose(fp);
+  }
+
+  if (store->packed) {
+    name = pathname(pageDirectory, "pages.idx");
+    store->indexFd = open(name, O_RDWR | O_CREAT, 0644);
+    if (store->indexFd < 0) {
+      store->indexFd = open(name, O_RDONLY);    // enough to load pages
+    }
+    free(name);
+    // new pages go at the end of the last segment
+    struct stat st;
+    char number[24];
+    for (int segment = 0; ; segment++) {
+      sprintf(number, "pages.%d", segment);
+      name = pathname(pageDirectory, number);
+      int found = stat(name, &st);
+      free(name);
+      if (found != 0) {
+        break;
+      }
+      store->lastSegment = segment;
+      store->lastOffset = st.st_size;
+    }
+    if (store->indexFd < 0) {
+      storeFree(store);
+      pthread_mutex_unlock(&storesLock);
+      return NULL;
+    }
+  }
+
+  store->next = stores;
+  stores = store;
+  pthread_mutex_unlock(&storesLock);
+  return store;
+}
+
+/**************** storeFree() ****************/
+/* Close the pagestore's files and free it.
+ */
+static void storeFree(pagestore_t* store) {
+  if (store->indexFd >= 0) {
+    close(store->indexFd);
+  }
+  for (int i = 0; i < store->numSegments; i++) {
+    if (store->segments[i].map != NULL) {
+      munmap(store->segments[i].map, store->segments[i].mapLength);
+    }
+    if (store->segments[i].fd >= 0) {
+      close(store->segments[i].fd);
+    }
+  }
+  free(store->segments);
+  pthread_mutex_destroy(&store->lock);
+  free(store->pageDirectory);
+  free(store);
+}
+
+/**************** segmentFd() ****************/
+/* Return the file descriptor of pages.N, opening (or creating) it if
+ * need be, or -1 on error. The caller holds store->lock.
+ */
+static int segmentFd(pagestore_t* store, const int segment) {
+  if (segment >= store->numSegments) {
+    int numSegments = store->numSegments ? store->numSegments : 4;
+    while (numSegments <= segment) {
+      numSegments *= 2;
+    }
+    segment_t* segments = realloc(store->segments, numSegments * sizeof(segment_t));
+    if (segments == NULL) {
+      return -1;
+    }
+    for (int i = store->numSegments; i < numSegments; i++) {
+      segments[i] = (segment_t) { -1, NULL, 0 };
+    }
+    store->segments = segments;
+    store->numSegments = numSegments;
+  }
+  segment_t* seg = &store->segments[segment];
+  if (seg->fd < 0) {
+    char number[24];
+    sprintf(number, "pages.%d", segment);
+    char* name = pathname(store->pageDirectory, number);
+    seg->fd = open(name, O_RDWR | O_CREAT, 0644);
+    if (seg->fd < 0) {
+      seg->fd = open(name, O_RDONLY);
+    }
+    free(name);
+  }
+  return seg->fd;
+}
+
+/**************** segmentMap() ****************/
+/* Return the start of pages.N mapped read-only, mapping all of it on
+ * first use, or NULL on error or if the mapping ends before 'end' (the
+ * segment has grown since; pages loaded earlier still point into the
+ * mapping, so it is not replaced). The caller holds store->lock.
+ */
+static char* segmentMap(pagestore_t* store, const int segment, const size_t end) {
+  int fd = segmentFd(store, segment);
+  if (fd < 0) {
+    return NULL;
+  }
+  segment_t* seg = &store->segments[segment];
+  if (seg->map == NULL) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      return NULL;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+      return NULL;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);    // the indexer loads pages in docID order
+    seg->map = map;
+    seg->mapLength = st.st_size;
+  }
+  return end <= seg->mapLength ? seg->map : NULL;
+}
+
+/**************** pathname() ****************/
+/* Return pageDirectory/name in newly allocated memory, which the
+ * caller must free.
+ */
+static char* pathname(const char* pageDirectory, const char* name) {
+  char* path = malloc(strlen(pageDirectory) + strlen(name) + 2);
+  if (path != NULL) {
+    sprintf(path, "%s/%s", pageDirectory, name);
+  }
+  return path;
+}
+
+/**************** syncDirectory() ****************/
+/* Flush the pageDirectory itself, and so the names in it, to disk.
+ * Return false on error.
+ */
+static bool syncDirectory(const char* pageDirectory) {
+  int dirfd = open(pageDirectory, O_RDONLY | O_DIRECTORY);
+  if (dirfd < 0) {
+    return false;
+  }
+  bool ok = fsync(dirfd) == 0;
+  close(dirfd);
+  return ok;
+}
+
+/**************** packedSave() ****************/
+/* Append the page to the last segment, in the same format as a page
+ * file (URL, depth, and HTML, each followed by a newline), starting a
+ * new segment when that one is full; then point the docID's entry in
+ * pages.idx at it. Pages may be saved by several threads at once, in
+ * any docID order: only claiming the space needs the lock.
+ */
+static void packedSave(pagestore_t* store, const webpage_t* page, const int docID) {
+  char header[64];
+  const char* url = webpage_getURL(page);
+  const char* html = webpage_getHTML(page) ? webpage_getHTML(page) : "(null)";
+  size_t htmlLen = webpage_getHTML(page) ? webpage_getHTMLLength(page) : strlen(html);
+  int headerLen = snprintf(header, sizeof(header), "\n%d\n", webpage_getDepth(page));
+  struct iovec parts[4] = {
+    { (void*) url, strlen(url) },
+    { header, headerLen },
+    { (void*) html, htmlLen },
+    { "\n", 1 },
+  };
+  size_t length = parts[0].iov_len + parts[1].iov_len + parts[2].iov_len + parts[3].iov_len;
+  if (length > UINT32_MAX) {
+    fprintf(stderr, "error when saving page %d: too big for the page store\n", docID);
+    return;
+  }
+
+  // claim room for the page at the end of the last segment
+  pthread_mutex_lock(&store->lock);
+  if (store->lastOffset > 0 && store->lastOffset + (off_t) length > SEGMENT_BYTES) {
+    store->lastSegment++;
+    store->lastOffset = 0;
+  }
+  pageref_t ref = { store->lastSegment, length, store->lastOffset };
+  int fd = segmentFd(store, ref.segment);
+  store->lastOffset += length;
+  pthread_mutex_unlock(&store->lock);
+
+  // the page first, then the entry that points at it
+  if (fd < 0 || pwritev(fd, parts, 4, ref.offset) != (ssize_t) length
+      || pwrite(store->indexFd, &ref, sizeof(ref), (off_t) (docID - 1) * sizeof(ref)) != sizeof(ref)) {
+    fprintf(stderr, "error when saving page %d to %s\n", docID, store->pageDirectory);
+  }
+}
+
+/**************** packedRead() ****************/
+/* Read the first limit bytes (or all, if fewer) of the docID's page
+ * into a null-terminated string, which the caller must free, setting
+ * *length to the number of bytes read.
+ * Return NULL if there is no such page, or on error.
+ */
+static char* packedRead(pagestore_t* store, const int docID, const size_t limit, size_t* length) {
+  pageref_t ref;
+  if (docID < 1 || pread(store->indexFd, &ref, sizeof(ref), (off_t) (docID - 1) * sizeof(ref)) != sizeof(ref)
+      || ref.length == 0) {
+    return NULL;
+  }
+  pthread_mutex_lock(&store->lock);
+  int fd = segmentFd(store, ref.segment);
+  pthread_mutex_unlock(&store->lock);
+
+  size_t want = ref.length < limit ? ref.length : limit;
+  char* text = malloc(want + 1);
+  if (fd < 0 || text == NULL || pread(fd, text, want, ref.offset) != (ssize_t) want) {
+    free(text);
+    return NULL;
+  }
+  text[want] = '\0';
+  *length = want;
+  return text;
+}
+
+/**************** packedLoad() ****************/
+/* Read the docID's page back from its segment, as pagedir_load does
+ * from a page file.
+ * Return the webpage, or NULL if there is no such page, or on error.
+ */
+static webpage_t* packedLoad(pagestore_t* store, const int docID) {
+  size_t length;
+  char* text = packedRead(store, docID, UINT32_MAX, &length);
+  if (text == NULL) {
+    return NULL;
+  }
+  // the URL and the depth are the first two lines, and the rest is the HTML
+  char* depthLine = memchr(text, '\n', length);
+  char* htmlStart = depthLine ? memchr(depthLine + 1, '\n', length - (depthLine + 1 - text)) : NULL;
+  int depth;
+  if (htmlStart == NULL || sscanf(depthLine + 1, "%d", &depth) != 1) {
+    free(text);
+    return NULL;
+  }
+  *depthLine = '\0';
+  htmlStart++;
+  size_t htmlLen = length - (htmlStart - text);
+  char* html = malloc(htmlLen + 1);
+  char* url = malloc(depthLine - text + 1);
+  if (html == NULL || url == NULL) {
+    free(html);
+    free(url);
+    free(text);
+    return NULL;
+  }
+  memcpy(html, htmlStart, htmlLen + 1);
+  strcpy(url, text);
+  free(text);
+  return webpage_new(url, depth, html);
+}
+
+/**************** viewPage() ****************/
+/* Make a webpage of the length bytes of a saved page (URL, depth, and
+ * HTML, as packedSave and pagedir_save write them) whose HTML is a view
+ * of those bytes, not a copy; only the URL is copied. release(arg) is
+ * called when the page is deleted (see webpage_newView).
+ * Return the webpage, or NULL if the bytes are not a page, or on error;
+ * release is not called then.
+ */
+static webpage_t* viewPage(const char* text, const size_t length, void (*release)(void* arg), void* arg) {
+  // the URL and the depth are the first two lines, and the rest is the HTML
+  const char* depthLine = memchr(text, '\n', length);
+  const char* htmlStart = depthLine ? memchr(depthLine + 1, '\n', length - (depthLine + 1 - text)) : NULL;
+  int depth;
+  // sscanf stops at the second newline, so stays within the page
+  if (htmlStart == NULL || sscanf(depthLine + 1, "%d", &depth) != 1) {
+    return NULL;
+  }
+  htmlStart++;
+  char* url = malloc(depthLine - text + 1);
+  if (url == NULL) {
+    return NULL;
+  }
+  memcpy(url, text, depthLine - text);
+  url[depthLine - text] = '\0';
+  webpage_t* page = webpage_newView(url, depth, htmlStart, length - (htmlStart - text), release, arg);
+  if (page == NULL) {
+    free(url);
+  }
+  return page;
+}
+
+/**************** unmapPage() ****************/
+/* Unmap a page file mapped by pagedir_loadMapped, and free its mapping_t.
+ */
+static void unmapPage(void* arg) {
+  mapping_t* mapping = arg;
+  munmap(mapping->addr, mapping->length);
+  free(mapping);
+}
+
+/**************** newCrawlID() ****************/
+/* Return a new crawl's identity: the time, to the nanosecond, and the
+ * process ID, mixed (by splitmix64's finalizer) so that any two crawls
+ * differ in about half their bits.
+ */
+static uint64_t newCrawlID(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  uint64_t id = ((uint64_t) now.tv_sec * 1000000000 + now.tv_nsec) ^ ((uint64_t) getpid() << 40);
+  id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  id = (id ^ (id >> 27)) * 0x94d049bb133111ebULL;
+  return id ^ (id >> 31);
+}
@@ -8,6 +8,19 @@
  * the knowledge about how to initialize and validate a pageDirectory, and how 
  * to write and read page files, in one place
  *
+ * A pageDirectory holds its pages in one of two layouts, recorded in
+ * the first line of its .crawler file (the second names the crawl; see
+ * pagedir_getCrawlID):
+ *   - one file per page, pageDirectory/<docID> (the legacy layout, and
+ *     what an empty .crawler means), holding the URL, the depth, and
+ *     the HTML, each followed by a newline;
+ *   - packed (.crawler says "packed"): the same bytes for each page are
+ *     appended to large segment files pageDirectory/pages.0, pages.1,
+ *     ..., and pageDirectory/pages.idx holds, for each docID in order,
+ *     the segment, offset, and length of its page, so that saving a
+ *     page creates no file and loading one needs no directory lookup.
+ * The functions below work the same on either.
+ *
  * Charlie Childress, February 2022, cs50
  */
 
@@ -23,13 +36,16 @@
 /* Initialize a new page directory
  * Parameters:
  *   char* for the name of a existing directory
+ *   whether to pack its pages into segments, or save one file per page;
+ *     packing clears out any earlier packed crawl in the directory
+ * Gives the crawl a new identity (see pagedir_getCrawlID)
  * Construct a pathname and allocate it enough memory
  *    to crawl to a depth of 10 (the max depth)
  * Opens the file for writing
  * Closes the file and returns false on any error.
  * Otherwise, closes the file and returns true to show page was initialized
  */
-bool pagedir_init(const char* pageDirectory);
+bool pagedir_init(const char* pageDirectory, const bool packed);
 
 /**************** pagedir_save ****************/
 /* Parameters:
@@ -45,9 +61,34 @@ bool pagedir_init(const char* pageDirectory);
  * Only runs if the webpage and directory are not empty
  * Returns nothing
  * Prints webpage contents
+ * Safe to call from several threads at once, for different docIDs
  */
 void pagedir_save(const webpage_t* page, const char* pageDirectory, const int docID);
 
+/**************** pagedir_truncate ****************/
+/* Parameters:
+ *  pageDirectory and the first docID to remove
+ *
+ * Remove the page files numbered docID, docID+1, and so on,
+ *    up to the first one that does not exist, e.g., pages
+ *    saved after the checkpoint a crawl resumes from
+ * Returns nothing
+ */
+void pagedir_truncate(const char* pageDirectory, const int docID);
+
+/**************** pagedir_sync ****************/
+/* Parameters:
+ *  pageDirectory, and the docID after the last page to sync
+ *
+ * Flush the pages saved before docID to disk, with the directory's
+ *    names for their files, e.g., before a checkpoint that counts on
+ *    them is committed: pages.idx and the segments written since the
+ *    last sync, if packed, or the page files saved since, if not.
+ *    The pages must all have been saved; others may be saved meanwhile
+ * Return true if they are on disk, false on any error
+ */
+bool pagedir_sync(const char* pageDirectory, const int docID);
+
 /**************** pagedir_validate ****************/
 /* Parameters:
  *  pageDirectory
@@ -78,4 +119,58 @@ bool pagedir_validate(const char* pageDirectory);
  */
 webpage_t* pagedir_load(const char* pageDirectory, int docID);
 
+/**************** pagedir_loadMapped ****************/
+/* Parameters:
+ *  pageDirectory and docID, as for pagedir_load
+ *
+ * Load the page as pagedir_load does, but without copying its HTML:
+ * the page file (or, if packed, its segment) is mapped into memory
+ * with mmap, and the page's HTML is a read-only view of the mapping.
+ * That HTML is NOT null-terminated; use webpage_getHTMLLength, or the
+ * webpage functions that parse it (see webpage_newView).
+ *
+ * Returns the webpage if successful, which the caller must delete
+ *   with webpage_delete, and, if the pageDirectory is packed, before
+ *   calling pagedir_close (which unmaps the segments)
+ * Returns NULL if any errors occur
+ */
+webpage_t* pagedir_loadMapped(const char* pageDirectory, const int docID);
+
+/**************** pagedir_getURL ****************/
+/* Parameters:
+ *  pageDirectory and docID of a page in it
+ *
+ * Read just the URL of the page, e.g., to print a query result
+ *
+ * Returns the URL, which the caller must free
+ * Returns NULL if there is no such page, or on any error
+ */
+char* pagedir_getURL(const char* pageDirectory, const int docID);
+
+/**************** pagedir_getCrawlID ****************/
+/* Parameters:
+ *  pageDirectory
+ *
+ * Read the identity pagedir_init gave the crawl in the directory: a
+ * random 64-bit number, in hex, that stays the same as the crawl is
+ * carried on (--resume) or its pages fetched again (--recrawl), and
+ * changes when a new crawl starts over in the directory. The indexer
+ * checks it before adding the pages past those it has indexed.
+ *
+ * Returns the identity, which the caller must free
+ * Returns NULL if the directory has none (it was crawled before
+ *   crawls had one), or on any error
+ */
+char* pagedir_getCrawlID(const char* pageDirectory);
+
+/**************** pagedir_close ****************/
+/* Parameters:
+ *  pageDirectory that is no longer needed
+ *
+ * Close the files kept open, and unmap the segments mapped, for the
+ * pageDirectory, if any; it is opened again as needed
+ * Returns nothing
+ */
+void pagedir_close(const char* pageDirectory);
+
 #endif // __PAGEDIR_H
\ No newline at end of file
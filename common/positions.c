@@ -0,0 +1,644 @@
+/*
+ * positions.c - CS50 positions module
+ *
+ * see positions.h for more information.
+ *
+ * Charlie Childress, cs50, February 2022
+ */
+
+#define _DEFAULT_SOURCE   // madvise
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "positions.h"
+#include "postings.h"
+#include "word.h"
+
+/**************** file-local global variables ****************/
+#define SPAN_BUFFER 64        // positions_addSpan copies words shorter than this on the stack
+static const size_t MIN_SLOTS = 256;    // smallest term table, a power of two
+static const char MAGIC[8] = { 'T', 'S', 'E', 'P', 'O', 'S', 'N', '1' };
+
+/**************** local types ****************/
+// the header of a positions file
+typedef struct fileheader {
+  char magic[8];              // MAGIC
+  uint64_t numTerms;          // fileterm_t that follow the header
+  uint64_t wordsOffset;       // where the words start in the file
+  uint64_t docsOffset;        // where the documents start, a multiple of 8
+  uint64_t positionsOffset;   // where the positions start
+  uint64_t length;            // of the whole file
+} fileheader_t;
+
+// a term of a positions file; they are in strcmp order of their words
+typedef struct fileterm {
+  uint64_t word;              // where its word starts in the words
+  uint64_t docs;              // the index of its first document in the documents
+  uint64_t positions;         // where its documents' positions start in the positions
+  uint32_t numDocs;
+  uint32_t length;            // bytes of its documents' positions
+} fileterm_t;
+
+// a (word, docID) of a positions file; each term's are in docID order
+typedef struct filedoc {
+  uint32_t docID;
+  uint32_t offset;            // where its positions start in the term's
+} filedoc_t;
+
+// a (word, docID) being built: where its positions are in the term's bytes
+typedef struct doc {
+  int docID;
+  int count;                  // positions so far
+  int last;                   // the last of them
+  size_t offset;              // where they start in the term's bytes
+  size_t length;              // and their bytes
+} doc_t;
+
+// a word being built, and its documents' positions
+typedef struct term {
+  uint64_t hash;              // of the word; 0 marks an empty slot
+  char* word;
+  doc_t* docs;                // in the order their pages were added
+  int numDocs;
+  int docsRoom;
+  uint8_t* bytes;             // the documents' positions, as varints
+  size_t length;
+  size_t room;
+} term_t;
+
+// where one word of a phrase is read from, in one document
+typedef struct reader {
+  const uint8_t* at;          // the next varint
+  const uint8_t* end;         // of the term's positions, which it must not read past
+  uint32_t left;              // positions not yet read
+  int64_t position;           // the last one read, or -1 before the first
+} reader_t;
+
+/**************** global types ****************/
+typedef struct positions {
+  term_t* terms;              // while building: open-addressed by hash, with linear probing
+  size_t numSlots;            // a power of two, at least 4/3 of numWords
+  size_t numWords;
+  void* map;                  // once mapped: the file, and its parts
+  size_t mapLength;
+  const fileterm_t* fileTerms;
+  uint64_t numTerms;
+  const char* words;          // ends with a '\0', so every word in it does
+  uint64_t wordsLength;
+  const filedoc_t* docs;
+  uint64_t numDocs;
+  const uint8_t* bytes;
+  uint64_t bytesLength;
+} positions_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static uint64_t hashWord(const char* word);
+static term_t* findOrAdd(positions_t* positions, const char* word);
+static bool grow(positions_t* positions);
+static bool addDoc(term_t* term, const int docID, const size_t offset);
+static bool reserve(term_t* term, const size_t bytes);
+static int termCompare(const void* a, const void* b);
+static int docCompare(const void* a, const void* b);
+static const fileterm_t* findTerm(positions_t* positions, const char* word);
+static const filedoc_t* seekDoc(positions_t* positions, const fileterm_t* term, uint64_t* cursor, const int docID);
+static bool readerStart(positions_t* positions, const fileterm_t* term, const filedoc_t* doc, reader_t* reader);
+static bool readerNext(reader_t* reader);
+static size_t putVarint(uint8_t* buffer, uint32_t value);
+static bool getVarint(const uint8_t** at, const uint8_t* end, uint32_t* value);
+
+/**************** positions_new() ****************/
+/* see positions.h for description */
+positions_t* positions_new(void) {
+  positions_t* positions = calloc(1, sizeof(positions_t));
+  if (positions != NULL) {
+    positions->numSlots = MIN_SLOTS;
+    if ((positions->terms = calloc(positions->numSlots, sizeof(term_t))) == NULL) {
+      free(positions);
+      return NULL;
+    }
+  }
+  return positions;
+}
+
+/**************** positions_addSpan() ****************/
+/* see positions.h for description */
+bool positions_addSpan(positions_t* positions, const char* word, const size_t len, const int docID, const int position) {
+  if (positions == NULL || positions->map != NULL || word == NULL || docID < 0 || position < 0) {
+    return false;
+  }
+  char small[SPAN_BUFFER];
+  char* key = len < SPAN_BUFFER ? small : malloc(len + 1);
+  term_t* term = key ? findOrAdd(positions, normalizeSpan(word, len, key)) : NULL;
+  if (key != small) {
+    free(key);
+  }
+  if (term == NULL) {
+    return false;
+  }
+
+  // a word's positions in a page go together, so a new docID starts a new document
+  if (term->numDocs == 0 || term->docs[term->numDocs - 1].docID != docID) {
+    if (!addDoc(term, docID, term->length)) {
+      return false;
+    }
+  }
+  doc_t* doc = &term->docs[term->numDocs - 1];
+  if (doc->count > 0 && position <= doc->last) {
+    return false;   // out of order
+  }
+  if (!reserve(term, 5)) {
+    return false;
+  }
+  size_t bytes = putVarint(term->bytes + term->length, position - doc->last);
+  term->length += bytes;
+  doc->length += bytes;
+  doc->last = position;
+  doc->count++;
+  return true;
+}
+
+/**************** positions_merge() ****************/
+/* see positions.h for description */
+bool positions_merge(positions_t* positions, positions_t* other) {
+  if (positions == NULL || other == NULL || positions == other || positions->map != NULL || other->map != NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < other->numSlots; i++) {
+    term_t* from = &other->terms[i];
+    if (from->hash == 0) {
+      continue;
+    }
+    // the other's bytes go after the term's own, and its documents' offsets with them
+    term_t* term = findOrAdd(positions, from->word);
+    if (term == NULL || !reserve(term, from->length)) {
+      return false;
+    }
+    size_t base = term->length;
+    memcpy(term->bytes + base, from->bytes, from->length);
+    term->length += from->length;
+    for (int d = 0; d < from->numDocs; d++) {
+      if (!addDoc(term, from->docs[d].docID, base + from->docs[d].offset)) {
+        return false;
+      }
+      doc_t* doc = &term->docs[term->numDocs - 1];
+      doc->count = from->docs[d].count;
+      doc->last = from->docs[d].last;
+      doc->length = from->docs[d].length;
+    }
+  }
+  return true;
+}
+
+/**************** positions_write() ****************/
+/* see positions.h for description */
+bool positions_write(positions_t* positions, const char* filename, const int limit) {
+  if (positions == NULL || positions->map != NULL || filename == NULL) {
+    return false;
+  }
+  FILE* fp = fopen(filename, "w");
+  if (fp == NULL) {
+    return false;
+  }
+
+  // the words with a document below the limit, in strcmp order, each with its documents in docID order
+  term_t** sorted = malloc((positions->numWords + 1) * sizeof(term_t*));
+  fileterm_t* fileTerms = malloc((positions->numWords + 1) * sizeof(fileterm_t));
+  bool ok = sorted != NULL && fileTerms != NULL;
+  size_t numTerms = 0;
+  for (size_t i = 0; ok && i < positions->numSlots; i++) {
+    term_t* term = &positions->terms[i];
+    if (term->hash != 0) {
+      qsort(term->docs, term->numDocs, sizeof(doc_t), docCompare);
+      if (term->numDocs > 0 && (limit <= 0 || term->docs[0].docID < limit)) {
+        sorted[numTerms++] = term;
+      }
+    }
+  }
+  if (ok) {
+    qsort(sorted, numTerms, sizeof(term_t*), termCompare);
+  }
+
+  // lay the words and documents out first, so that the terms, which say where they are, go ahead of them
+  uint8_t count[5];
+  uint64_t wordsLength = 0;
+  uint64_t numDocs = 0;
+  uint64_t bytesLength = 0;
+  for (size_t i = 0; ok && i < numTerms; i++) {
+    int kept = 0;
+    uint64_t length = 0;    // each document's positions follow their count
+    for (; kept < sorted[i]->numDocs && (limit <= 0 || sorted[i]->docs[kept].docID < limit); kept++) {
+      length += putVarint(count, sorted[i]->docs[kept].count) + sorted[i]->docs[kept].length;
+    }
+    fileTerms[i] = (fileterm_t) { wordsLength, numDocs, bytesLength, kept, length };
+    ok = length <= UINT32_MAX;
+    wordsLength += strlen(sorted[i]->word) + 1;
+    numDocs += kept;
+    bytesLength += length;
+  }
+  fileheader_t header = { { 0 }, numTerms };
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.wordsOffset = sizeof(fileheader_t) + numTerms * sizeof(fileterm_t);
+  header.docsOffset = (header.wordsOffset + wordsLength + 7) & ~(uint64_t) 7;
+  header.positionsOffset = header.docsOffset + numDocs * sizeof(filedoc_t);
+  header.length = header.positionsOffset + bytesLength;
+
+  ok = ok && fwrite(&header, sizeof(header), 1, fp) == 1
+          && fwrite(fileTerms, sizeof(fileterm_t), numTerms, fp) == numTerms;
+  for (size_t i = 0; ok && i < numTerms; i++) {
+    ok = fputs(sorted[i]->word, fp) != EOF && fputc('\0', fp) != EOF;
+  }
+  for (uint64_t pad = header.wordsOffset + wordsLength; ok && pad < header.docsOffset; pad++) {
+    ok = fputc('\0', fp) != EOF;
+  }
+  for (size_t i = 0; ok && i < numTerms; i++) {
+    uint32_t offset = 0;
+    for (uint32_t d = 0; ok && d < fileTerms[i].numDocs; d++) {
+      const doc_t* doc = &sorted[i]->docs[d];
+      filedoc_t fileDoc = { doc->docID, offset };
+      ok = fwrite(&fileDoc, sizeof(fileDoc), 1, fp) == 1;
+      offset += putVarint(count, doc->count) + doc->length;
+    }
+  }
+  for (size_t i = 0; ok && i < numTerms; i++) {
+    for (uint32_t d = 0; ok && d < fileTerms[i].numDocs; d++) {
+      const doc_t* doc = &sorted[i]->docs[d];
+      size_t bytes = putVarint(count, doc->count);
+      ok = fwrite(count, 1, bytes, fp) == bytes
+        && fwrite(sorted[i]->bytes + doc->offset, 1, doc->length, fp) == doc->length;
+    }
+  }
+  free(sorted);
+  free(fileTerms);
+  return fclose(fp) == 0 && ok;
+}
+
+/**************** positions_map() ****************/
+/* see positions.h for description */
+positions_t* positions_map(const char* filename) {
+  int fd = filename ? open(filename, O_RDONLY) : -1;
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  void* map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(fileheader_t)) {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);    // the mapping keeps the file open
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+
+  // check the header only; the terms and positions are checked as phrases read them
+  const fileheader_t* header = map;
+  const uint8_t* file = map;
+  size_t size = st.st_size;
+  positions_t* positions = NULL;
+  if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0
+      && header->length == size
+      && header->numTerms <= (size - sizeof(fileheader_t)) / sizeof(fileterm_t)
+      && header->wordsOffset == sizeof(fileheader_t) + header->numTerms * sizeof(fileterm_t)
+      && header->docsOffset >= header->wordsOffset && header->docsOffset % 8 == 0
+      && header->positionsOffset >= header->docsOffset && header->positionsOffset <= size
+      && (header->positionsOffset - header->docsOffset) % sizeof(filedoc_t) == 0
+      && (header->docsOffset == header->wordsOffset || file[header->docsOffset - 1] == '\0')
+      && (positions = calloc(1, sizeof(positions_t))) != NULL) {
+    madvise(map, size, MADV_RANDOM);    // each phrase reads a few scattered pages
+    positions->map = map;
+    positions->mapLength = size;
+    positions->fileTerms = (const fileterm_t*) (file + sizeof(fileheader_t));
+    positions->numTerms = header->numTerms;
+    positions->words = (const char*) file + header->wordsOffset;
+    positions->wordsLength = header->docsOffset - header->wordsOffset;
+    positions->docs = (const filedoc_t*) (file + header->docsOffset);
+    positions->numDocs = (header->positionsOffset - header->docsOffset) / sizeof(filedoc_t);
+    positions->bytes = file + header->positionsOffset;
+    positions->bytesLength = size - header->positionsOffset;
+    return positions;
+  }
+  munmap(map, size);
+  return NULL;
+}
+
+/**************** positions_phrase() ****************/
+/* see positions.h for description */
+postings_t* positions_phrase(positions_t* positions, const char** words, const int* offsets, const int numWords,
+                             const postings_t* candidates) {
+  if (positions == NULL || positions->map == NULL || words == NULL || offsets == NULL || numWords < 1) {
+    return NULL;
+  }
+  postings_t* result = postings_new();
+  const fileterm_t** terms = malloc(numWords * sizeof(fileterm_t*));
+  uint64_t* cursors = calloc(numWords, sizeof(uint64_t));
+  const filedoc_t** docs = malloc(numWords * sizeof(filedoc_t*));
+  reader_t* readers = malloc(numWords * sizeof(reader_t));
+  bool ok = result != NULL && terms != NULL && cursors != NULL && docs != NULL && readers != NULL;
+  bool all = true;     // whether every word is in the positions at all
+  for (int w = 0; ok && all && w < numWords; w++) {
+    all = (terms[w] = findTerm(positions, words[w])) != NULL;
+  }
+
+  // the candidates, like each term's documents, are in docID order, so each term is searched
+  // from where it was left, and only the candidates' positions are read
+  const int* docIDs = postings_docIDs(candidates);
+  for (int c = 0; ok && all && c < postings_length(candidates); c++) {
+    int anchor = 0;     // the word with the fewest positions here, whose positions are tried
+    bool found = true;
+    for (int w = 0; found && w < numWords; w++) {
+      docs[w] = seekDoc(positions, terms[w], &cursors[w], docIDs[c]);
+      found = docs[w] != NULL && readerStart(positions, terms[w], docs[w], &readers[w]);
+      anchor = found && readers[w].left < readers[anchor].left ? w : anchor;
+    }
+    int count = 0;
+    while (found && readerNext(&readers[anchor])) {
+      // where each other word would be if the phrase were here; they only move forward
+      int64_t start = readers[anchor].position - offsets[anchor];
+      bool match = start >= 0;
+      for (int w = 0; match && w < numWords; w++) {
+        int64_t target = start + offsets[w];
+        while (w != anchor && readers[w].position < target && readerNext(&readers[w])) {
+          ;
+        }
+        match = readers[w].position == target;
+      }
+      count += match ? 1 : 0;
+    }
+    if (count > 0) {
+      ok = postings_add(result, docIDs[c], count);
+    }
+  }
+  free(terms);
+  free(cursors);
+  free(docs);
+  free(readers);
+  if (!ok) {
+    postings_delete(result);
+    return NULL;
+  }
+  return result;
+}
+
+/**************** positions_delete() ****************/
+/* see positions.h for description */
+void positions_delete(positions_t* positions) {
+  if (positions != NULL) {
+    if (positions->map != NULL) {
+      munmap(positions->map, positions->mapLength);
+    }
+    for (size_t i = 0; positions->terms != NULL && i < positions->numSlots; i++) {
+      free(positions->terms[i].word);
+      free(positions->terms[i].docs);
+      free(positions->terms[i].bytes);
+    }
+    free(positions->terms);
+    free(positions);
+  }
+}
+
+/**************** hashWord() ****************/
+/* Return the FNV-1a hash of the word, mixed, and never 0.
+ */
+static uint64_t hashWord(const char* word) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const unsigned char* c = (const unsigned char*) word; *c != '\0'; c++) {
+    hash = (hash ^ *c) * 0x100000001b3ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash != 0 ? hash : 1;    // 0 marks an empty slot
+}
+
+/**************** findOrAdd() ****************/
+/* Return the term of the word, adding it (with a copy of the word) if
+ * it is new; NULL if out of memory.
+ */
+static term_t* findOrAdd(positions_t* positions, const char* word) {
+  uint64_t hash = hashWord(word);
+  size_t slot = hash & (positions->numSlots - 1);
+  while (positions->terms[slot].hash != 0) {
+    if (positions->terms[slot].hash == hash && strcmp(positions->terms[slot].word, word) == 0) {
+      return &positions->terms[slot];
+    }
+    slot = (slot + 1) & (positions->numSlots - 1);
+  }
+  if ((positions->numWords + 1) * 4 > positions->numSlots * 3) {
+    if (!grow(positions)) {
+      return NULL;
+    }
+    return findOrAdd(positions, word);    // its slot has moved
+  }
+  char* copy = malloc(strlen(word) + 1);
+  if (copy == NULL) {
+    return NULL;
+  }
+  strcpy(copy, word);
+  positions->terms[slot] = (term_t) { hash, copy };
+  positions->numWords++;
+  return &positions->terms[slot];
+}
+
+/**************** grow() ****************/
+/* Double the term table, moving every term to its new slot.
+ * Return false (leaving the table as it was) if out of memory.
+ */
+static bool grow(positions_t* positions) {
+  size_t numSlots = positions->numSlots * 2;
+  term_t* terms = calloc(numSlots, sizeof(term_t));
+  if (terms == NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < positions->numSlots; i++) {
+    if (positions->terms[i].hash != 0) {
+      size_t slot = positions->terms[i].hash & (numSlots - 1);
+      while (terms[slot].hash != 0) {
+        slot = (slot + 1) & (numSlots - 1);
+      }
+      terms[slot] = positions->terms[i];
+    }
+  }
+  free(positions->terms);
+  positions->terms = terms;
+  positions->numSlots = numSlots;
+  return true;
+}
+
+/**************** addDoc() ****************/
+/* Append a document of the docID, with no positions yet, whose
+ * positions start at offset in the term's bytes.
+ * Return false if out of memory.
+ */
+static bool addDoc(term_t* term, const int docID, const size_t offset) {
+  if (term->numDocs == term->docsRoom) {
+    int room = term->docsRoom ? term->docsRoom * 2 : 4;
+    doc_t* docs = realloc(term->docs, room * sizeof(doc_t));
+    if (docs == NULL) {
+      return false;
+    }
+    term->docs = docs;
+    term->docsRoom = room;
+  }
+  term->docs[term->numDocs++] = (doc_t) { docID, 0, 0, offset, 0 };
+  return true;
+}
+
+/**************** reserve() ****************/
+/* Make room for that many more bytes in the term's bytes.
+ * Return false if out of memory.
+ */
+static bool reserve(term_t* term, const size_t bytes) {
+  if (term->length + bytes > term->room) {
+    size_t room = term->room ? term->room : 16;
+    while (room < term->length + bytes) {
+      room *= 2;
+    }
+    uint8_t* grown = realloc(term->bytes, room);
+    if (grown == NULL) {
+      return false;
+    }
+    term->bytes = grown;
+    term->room = room;
+  }
+  return true;
+}
+
+/**************** termCompare() ****************/
+/* qsort comparator for positions_write: term_t* by strcmp of their words
+ */
+static int termCompare(const void* a, const void* b) {
+  return strcmp((*(term_t* const*) a)->word, (*(term_t* const*) b)->word);
+}
+
+/**************** docCompare() ****************/
+/* qsort comparator for positions_write: doc_t by docID
+ */
+static int docCompare(const void* a, const void* b) {
+  const doc_t* docA = a;
+  const doc_t* docB = b;
+  return (docA->docID > docB->docID) - (docA->docID < docB->docID);
+}
+
+/**************** findTerm() ****************/
+/* Binary-search the terms of mapped positions for the word.
+ * Return its term, or NULL if it is not there, or its documents lie
+ * outside the file's.
+ */
+static const fileterm_t* findTerm(positions_t* positions, const char* word) {
+  uint64_t low = 0;
+  uint64_t high = positions->numTerms;
+  while (low < high) {
+    uint64_t mid = low + (high - low) / 2;
+    const fileterm_t* term = &positions->fileTerms[mid];
+    if (term->word >= positions->wordsLength) {
+      return NULL;    // a damaged file; the word counts as absent
+    }
+    int compare = strcmp(word, positions->words + term->word);
+    if (compare == 0) {
+      bool fits = term->docs <= positions->numDocs && term->numDocs <= positions->numDocs - term->docs
+               && term->positions <= positions->bytesLength && term->length <= positions->bytesLength - term->positions;
+      return fits ? term : NULL;
+    } else if (compare < 0) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return NULL;
+}
+
+/**************** seekDoc() ****************/
+/* Find the docID among the term's documents, from the one at *cursor
+ * on: galloping ahead, doubling the step, then binary-searching the
+ * last step, so that a term of many documents costs the log of the
+ * distance moved. Leaves *cursor at the first document not before the
+ * docID.
+ * Return the document, or NULL if the term is not in the docID.
+ */
+static const filedoc_t* seekDoc(positions_t* positions, const fileterm_t* term, uint64_t* cursor, const int docID) {
+  const filedoc_t* docs = positions->docs + term->docs;
+  uint64_t low = *cursor;
+  uint64_t high = low;
+  for (uint64_t step = 1; high < term->numDocs && docs[high].docID < (uint32_t) docID; step *= 2) {
+    low = high + 1;
+    high = high + step < term->numDocs ? high + step : term->numDocs;
+  }
+  while (low < high) {
+    uint64_t mid = low + (high - low) / 2;
+    if (docs[mid].docID < (uint32_t) docID) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  *cursor = low;
+  return low < term->numDocs && docs[low].docID == (uint32_t) docID ? &docs[low] : NULL;
+}
+
+/**************** readerStart() ****************/
+/* Set the reader to read the positions of the term's document, past
+ * their count, which it reads.
+ * Return false if they are outside the term's, or damaged.
+ */
+static bool readerStart(positions_t* positions, const fileterm_t* term, const filedoc_t* doc, reader_t* reader) {
+  const uint8_t* start = positions->bytes + term->positions;
+  *reader = (reader_t) { start + doc->offset, start + term->length, 0, -1 };
+  return doc->offset < term->length && getVarint(&reader->at, reader->end, &reader->left);
+}
+
+/**************** readerNext() ****************/
+/* Read the reader's next position.
+ * Return false if there is none, or it is damaged.
+ */
+static bool readerNext(reader_t* reader) {
+  uint32_t delta;
+  if (reader->left == 0 || !getVarint(&reader->at, reader->end, &delta)) {
+    return false;
+  }
+  reader->position = (reader->position < 0 ? 0 : reader->position) + delta;
+  reader->left--;
+  return true;
+}
+
+/**************** putVarint() ****************/
+/* Write the value into buffer as a varint (see index.h).
+ * Return the number of bytes written.
+ */
+static size_t putVarint(uint8_t* buffer, uint32_t value) {
+  size_t bytes = 0;
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    buffer[bytes++] = byte | (value != 0 ? 0x80 : 0);
+  } while (value != 0);
+  return bytes;
+}
+
+/**************** getVarint() ****************/
+/* Read a varint that putVarint wrote, from *at but not past end, into
+ * value, moving *at past it.
+ * Return false if it runs past end or does not fit 32 bits.
+ */
+static bool getVarint(const uint8_t** at, const uint8_t* end, uint32_t* value) {
+  uint32_t result = 0;
+  for (int shift = 0; shift < 35 && *at < end; shift += 7) {
+    uint8_t byte = *(*at)++;
+    if (shift == 28 && (byte & 0x70) != 0) {
+      return false;
+    }
+    result |= (uint32_t) (byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,131 @@
+/*
+ * positions.h - header file for CS50 positions module
+ *
+ * A positions is the positional index of a set of pages: for each
+ * word, and each document it is in, where in the page the word is, as
+ * the number of words before it (every word, however short, counts).
+ * The index (see index.h) says which documents hold all the words of
+ * a phrase; the positions then say, for just those documents, whether
+ * the words are next to each other, in order.
+ *
+ * The indexer builds a positions as it reads the pages, and writes it
+ * next to the index, as indexFilename.pos; the querier maps the file,
+ * read-only, and reads it in place. The file is, in the machine's byte
+ * order:
+ *   a header: the 8 bytes "TSEPOSN1", then the number of terms, the
+ *     file offsets of the words, the documents, and the positions,
+ *     and the file length, as 64-bit integers;
+ *   one 32-byte term per word, in strcmp order of the words: the
+ *     offset of its word in the words, the index of its first
+ *     document in the documents, and the offset of its positions in
+ *     the positions, as 64-bit integers, then the number of its
+ *     documents and the length of its positions in bytes, as 32-bit
+ *     integers;
+ *   the words, each followed by a '\0', then '\0's up to a multiple
+ *     of 8 bytes;
+ *   one 8-byte document per (word, docID), each word's in increasing
+ *     docID order: the docID and the offset of its positions in its
+ *     word's, as 32-bit integers;
+ *   the positions of each word, document by document: their number,
+ *     then the first, then each one's difference from the one before,
+ *     in increasing order, as varints, as in a binary index file.
+ * Since a word's documents are all the same size, finding a docID
+ * among them is a search, and reading a phrase's positions in one
+ * document reads those of that document only, however many documents
+ * the words are in.
+ *
+ * Charlie Childress, February 2022, cs50
+ */
+
+#ifndef __POSITIONS_H
+#define __POSITIONS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "postings.h"
+
+/**************** global types ****************/
+typedef struct positions positions_t;
+
+/**************** positions_new ****************/
+/* Return a new, empty positions to build, or NULL if out of memory
+ */
+positions_t* positions_new(void);
+
+/**************** positions_addSpan ****************/
+/* Parameters:
+ *  positions being built, the len characters of a word at word,
+ *  which need not be null-terminated (e.g., from webpage_getNextSpan),
+ *  a docID, and the word's position in the page
+ *
+ * Normalize the word (see normalizeSpan) and add the position to its
+ * positions in the docID. Each page's words are to be added in order,
+ * and all of one page before the next; the pages themselves may come
+ * in any order.
+ *
+ * Return true if it was added, false on bad parameters or out of memory
+ */
+bool positions_addSpan(positions_t* positions, const char* word, const size_t len, const int docID, const int position);
+
+/**************** positions_merge ****************/
+/* Parameters:
+ *  positions to merge into, and other positions, of other pages, to
+ *  merge from
+ *
+ * Add every page's positions in other to the positions. Other is not
+ * changed, and may then be deleted.
+ *
+ * Return true if the process runs successfully, false on bad
+ * parameters or out of memory
+ */
+bool positions_merge(positions_t* positions, positions_t* other);
+
+/**************** positions_write ****************/
+/* Parameters:
+ *  positions being built, the name of the file to write, and a limit
+ *  on docIDs (0 for none)
+ *
+ * Write the positions of docIDs below the limit into the file, in the
+ * format above, words in strcmp order, so that positions write the
+ * same however they were built
+ *
+ * Return true if the file was written, false on any error
+ */
+bool positions_write(positions_t* positions, const char* filename, const int limit);
+
+/**************** positions_map ****************/
+/* Parameters:
+ *  name of a file positions_write wrote
+ *
+ * Map the file into memory, read-only, checking only its header; a
+ * mapped positions answers positions_phrase, and cannot be added to
+ *
+ * Return the positions, or NULL if the file does not exist or is not
+ * a positions file
+ */
+positions_t* positions_map(const char* filename);
+
+/**************** positions_phrase ****************/
+/* Parameters:
+ *  mapped positions, the numWords (normalized) words of a phrase,
+ *  the position of each in the phrase, in increasing order, and the
+ *  postings of the documents that have every word (from the index)
+ *
+ * Find where the words are at those positions from one another in
+ * each document of the candidates, reading the positions of the
+ * candidates only
+ *
+ * Return new postings of the candidates the phrase is in, each with
+ * the number of times it is, which the caller must postings_delete;
+ * NULL on bad parameters or out of memory
+ */
+postings_t* positions_phrase(positions_t* positions, const char** words, const int* offsets, const int numWords,
+                             const postings_t* candidates);
+
+/**************** positions_delete ****************/
+/* Free the positions, or unmap a mapped one. NULL is ignored.
+ */
+void positions_delete(positions_t* positions);
+
+#endif // __POSITIONS_H
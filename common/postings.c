@@ -0,0 +1,295 @@
+/*
+ * postings.c - CS50 postings module
+ *
+ * see postings.h for more information.
+ *
+ * Charlie Childress, cs50, February 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "postings.h"
+
+/**************** file-local global variables ****************/
+static const int MIN_ROOM = 4;    // pairs allocated at first; most words are in few documents
+
+/**************** global types ****************/
+typedef struct postings {
+  int* docIDs;                // increasing
+  int* counts;                // counts[i] is the count of docIDs[i]
+  int length;                 // pairs in use
+  int room;                   // and allocated
+} postings_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool reserve(postings_t* postings, const int room);
+static int search(const postings_t* postings, const int docID);
+static postings_t* combine(const postings_t* a, const postings_t* b, const bool intersect, const int limit);
+
+/**************** postings_new() ****************/
+/* see postings.h for description */
+postings_t* postings_new(void) {
+  return calloc(1, sizeof(postings_t));
+}
+
+/**************** postings_add() ****************/
+/* see postings.h for description */
+bool postings_add(postings_t* postings, const int docID, const int count) {
+  if (postings == NULL || docID < 0 || count <= 0) {
+    return false;
+  }
+  int n = postings->length;
+  // the common cases: the document being indexed, or the next one
+  if (n > 0 && postings->docIDs[n - 1] == docID) {
+    postings->counts[n - 1] += count;
+    return true;
+  }
+  if (n == 0 || postings->docIDs[n - 1] < docID) {
+    return postings_append(postings, &docID, &count, 1);
+  }
+
+  // otherwise, find where the docID is or goes
+  int i = search(postings, docID);
+  if (postings->docIDs[i] == docID) {
+    postings->counts[i] += count;
+    return true;
+  }
+  if (!reserve(postings, n + 1)) {
+    return false;
+  }
+  memmove(&postings->docIDs[i + 1], &postings->docIDs[i], (n - i) * sizeof(int));
+  memmove(&postings->counts[i + 1], &postings->counts[i], (n - i) * sizeof(int));
+  postings->docIDs[i] = docID;
+  postings->counts[i] = count;
+  postings->length++;
+  return true;
+}
+
+/**************** postings_append() ****************/
+/* see postings.h for description */
+bool postings_append(postings_t* postings, const int* docIDs, const int* counts, const int n) {
+  if (postings == NULL || n < 0 || (n > 0 && (docIDs == NULL || counts == NULL))) {
+    return false;
+  }
+  int last = postings->length > 0 ? postings->docIDs[postings->length - 1] : -1;
+  for (int i = 0; i < n; i++) {
+    if (docIDs[i] <= last || counts[i] <= 0) {
+      return false;
+    }
+    last = docIDs[i];
+  }
+  if (!reserve(postings, postings->length + n)) {
+    return false;
+  }
+  if (n > 0) {
+    memcpy(&postings->docIDs[postings->length], docIDs, n * sizeof(int));
+    memcpy(&postings->counts[postings->length], counts, n * sizeof(int));
+    postings->length += n;
+  }
+  return true;
+}
+
+/**************** postings_merge() ****************/
+/* see postings.h for description */
+bool postings_merge(postings_t* postings, const postings_t* other, const int limit) {
+  if (postings == NULL || other == NULL || postings == other) {
+    return false;
+  }
+  postings_t* merged = combine(postings, other, false, limit);
+  if (merged == NULL) {
+    return false;
+  }
+  // take over the merged arrays
+  free(postings->docIDs);
+  free(postings->counts);
+  *postings = *merged;
+  free(merged);
+  return true;
+}
+
+/**************** postings_union() ****************/
+/* see postings.h for description */
+postings_t* postings_union(const postings_t* a, const postings_t* b) {
+  return combine(a, b, false, 0);
+}
+
+/**************** postings_intersect() ****************/
+/* see postings.h for description */
+postings_t* postings_intersect(const postings_t* a, const postings_t* b) {
+  return combine(a, b, true, 0);
+}
+
+/**************** postings_get() ****************/
+/* see postings.h for description */
+int postings_get(const postings_t* postings, const int docID) {
+  if (postings == NULL || postings->length == 0) {
+    return 0;
+  }
+  int i = search(postings, docID);
+  return i < postings->length && postings->docIDs[i] == docID ? postings->counts[i] : 0;
+}
+
+/**************** postings_length() ****************/
+/* see postings.h for description */
+int postings_length(const postings_t* postings) {
+  return postings ? postings->length : 0;
+}
+
+/**************** postings_size() ****************/
+/* see postings.h for description */
+size_t postings_size(const postings_t* postings) {
+  return postings ? sizeof(postings_t) + 2 * (size_t) postings->room * sizeof(int) : 0;
+}
+
+/**************** postings_docIDs() ****************/
+/* see postings.h for description */
+const int* postings_docIDs(const postings_t* postings) {
+  return postings && postings->length > 0 ? postings->docIDs : NULL;
+}
+
+/**************** postings_counts() ****************/
+/* see postings.h for description */
+const int* postings_counts(const postings_t* postings) {
+  return postings && postings->length > 0 ? postings->counts : NULL;
+}
+
+/**************** postings_iterate() ****************/
+/* see postings.h for description */
+void postings_iterate(const postings_t* postings, void* arg, void (*itemfunc)(void* arg, const int docID, const int count)) {
+  if (postings != NULL && itemfunc != NULL) {
+    for (int i = 0; i < postings->length; i++) {
+      (*itemfunc)(arg, postings->docIDs[i], postings->counts[i]);
+    }
+  }
+}
+
+/**************** postings_retain() ****************/
+/* see postings.h for description */
+void postings_retain(postings_t* postings, void* arg, bool (*keepfunc)(void* arg, const int docID)) {
+  if (postings != NULL && keepfunc != NULL) {
+    int n = 0;
+    for (int i = 0; i < postings->length; i++) {
+      if ((*keepfunc)(arg, postings->docIDs[i])) {
+        postings->docIDs[n] = postings->docIDs[i];
+        postings->counts[n++] = postings->counts[i];
+      }
+    }
+    postings->length = n;
+  }
+}
+
+/**************** postings_delete() ****************/
+/* see postings.h for description */
+void postings_delete(postings_t* postings) {
+  if (postings != NULL) {
+    free(postings->docIDs);
+    free(postings->counts);
+    free(postings);
+  }
+}
+
+/**************** reserve() ****************/
+/* Make room for at least the given number of pairs, at least doubling
+ * the room so that appending is constant time, amortized.
+ * Return false if out of memory, leaving the postings as it was.
+ */
+static bool reserve(postings_t* postings, const int room) {
+  if (room <= postings->room) {
+    return true;
+  }
+  int newRoom = postings->room ? postings->room * 2 : MIN_ROOM;
+  while (newRoom < room) {
+    newRoom *= 2;
+  }
+  int* docIDs = realloc(postings->docIDs, newRoom * sizeof(int));
+  if (docIDs == NULL) {
+    return false;
+  }
+  postings->docIDs = docIDs;
+  int* counts = realloc(postings->counts, newRoom * sizeof(int));
+  if (counts == NULL) {
+    return false;   // docIDs has grown, but room still says how much of both there is
+  }
+  postings->counts = counts;
+  postings->room = newRoom;
+  return true;
+}
+
+/**************** search() ****************/
+/* Return the index of the first docID not less than the given one,
+ * which is length if there is none.
+ */
+static int search(const postings_t* postings, const int docID) {
+  int low = 0;
+  int high = postings->length;
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (postings->docIDs[mid] < docID) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/**************** combine() ****************/
+/* Walk a and b (either may be NULL) together in docID order, and
+ * return new postings of their union, summing counts, or if intersect,
+ * of their intersection, taking the lesser count; b's docIDs from
+ * limit on are left out, if limit > 0.
+ * Return NULL if out of memory.
+ */
+static postings_t* combine(const postings_t* a, const postings_t* b, const bool intersect, const int limit) {
+  int lengthA = postings_length(a);
+  int lengthB = postings_length(b);
+  if (limit > 0 && lengthB > 0) {
+    lengthB = search(b, limit);
+  }
+  postings_t* out = postings_new();
+  int room = intersect ? (lengthA < lengthB ? lengthA : lengthB) : lengthA + lengthB;
+  if (out == NULL || !reserve(out, room)) {
+    postings_delete(out);
+    return NULL;
+  }
+
+  int i = 0, j = 0, n = 0;
+  while (i < lengthA && j < lengthB) {
+    int docA = a->docIDs[i];
+    int docB = b->docIDs[j];
+    if (docA == docB) {
+      int countA = a->counts[i++];
+      int countB = b->counts[j++];
+      out->docIDs[n] = docA;
+      out->counts[n++] = intersect ? (countA < countB ? countA : countB) : countA + countB;
+    } else if (docA < docB) {
+      if (!intersect) {
+        out->docIDs[n] = docA;
+        out->counts[n++] = a->counts[i];
+      }
+      i++;
+    } else {
+      if (!intersect) {
+        out->docIDs[n] = docB;
+        out->counts[n++] = b->counts[j];
+      }
+      j++;
+    }
+  }
+  // whatever is left of either is in the union only
+  if (!intersect && i < lengthA) {
+    memcpy(&out->docIDs[n], &a->docIDs[i], (lengthA - i) * sizeof(int));
+    memcpy(&out->counts[n], &a->counts[i], (lengthA - i) * sizeof(int));
+    n += lengthA - i;
+  }
+  if (!intersect && j < lengthB) {
+    memcpy(&out->docIDs[n], &b->docIDs[j], (lengthB - j) * sizeof(int));
+    memcpy(&out->counts[n], &b->counts[j], (lengthB - j) * sizeof(int));
+    n += lengthB - j;
+  }
+  out->length = n;
+  return out;
+}
@@ -0,0 +1,126 @@
+/*
+ * postings.h - header file for CS50 postings module
+ *
+ * A postings is the list of (docID, count) pairs of one word: the
+ * documents the word occurs in, and how often. The pairs are kept in
+ * two parallel arrays, sorted by docID, so that
+ *   adding the pairs of documents in docID order, as the indexer reads
+ *     them, is an append;
+ *   looking a docID up is a binary search;
+ *   the union and intersection of two postings, which the querier
+ *     computes for 'or' and 'and', are one merge pass over both.
+ *
+ * The postings does no locking of its own.
+ *
+ * Charlie Childress, February 2022, cs50
+ */
+
+#ifndef __POSTINGS_H
+#define __POSTINGS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct postings postings_t;
+
+/**************** postings_new ****************/
+/* Return a new, empty postings, or NULL if there are any errors
+ */
+postings_t* postings_new(void);
+
+/**************** postings_add ****************/
+/* Parameters:
+ *  postings, a docID >= 0, and a count > 0
+ *
+ * Add count to the docID's count, adding the docID if it is not there.
+ * Takes constant (amortized) time if docID is the last docID or past it.
+ *
+ * Return true if the count was added, false on bad parameters or out
+ * of memory
+ */
+bool postings_add(postings_t* postings, const int docID, const int count);
+
+/**************** postings_append ****************/
+/* Parameters:
+ *  postings, and n docIDs with their counts, where the docIDs increase
+ *  and the first is past the postings' last docID, and the counts are > 0
+ *
+ * Append the n pairs at once.
+ *
+ * Return true if they were appended, false (appending none) on bad
+ * parameters, docIDs out of order, or out of memory
+ */
+bool postings_append(postings_t* postings, const int* docIDs, const int* counts, const int n);
+
+/**************** postings_merge ****************/
+/* Parameters:
+ *  postings to merge into, other postings to merge from, and a limit
+ *  on docIDs (0 for none)
+ *
+ * Add every (docID, count) of other, for docIDs below the limit, to
+ * the postings. Other is not changed.
+ *
+ * Return true if the process runs successfully, false on bad
+ * parameters or out of memory (leaving the postings as it was)
+ */
+bool postings_merge(postings_t* postings, const postings_t* other, const int limit);
+
+/**************** postings_union ****************/
+/* Return new postings of every docID in a or b, each with the sum of
+ * its counts in a and b; or NULL if out of memory.
+ * NULL a or b counts as empty.
+ */
+postings_t* postings_union(const postings_t* a, const postings_t* b);
+
+/**************** postings_intersect ****************/
+/* Return new postings of every docID in both a and b, each with the
+ * lesser of its counts in a and b; or NULL if out of memory.
+ * NULL a or b counts as empty.
+ */
+postings_t* postings_intersect(const postings_t* a, const postings_t* b);
+
+/**************** postings_get ****************/
+/* Return the count of the docID, or 0 if it is not there or postings
+ * is NULL
+ */
+int postings_get(const postings_t* postings, const int docID);
+
+/**************** postings_length ****************/
+/* Return the number of docIDs, or 0 if postings is NULL
+ */
+int postings_length(const postings_t* postings);
+
+/**************** postings_size ****************/
+/* Return the bytes the postings has allocated, its arrays' room
+ * included, or 0 if postings is NULL
+ */
+size_t postings_size(const postings_t* postings);
+
+/**************** postings_docIDs ****************/
+/* Return the array of postings_length docIDs, in increasing order,
+ * and its parallel array of counts; both belong to the postings and
+ * last until it next changes. NULL if postings is NULL or empty.
+ */
+const int* postings_docIDs(const postings_t* postings);
+const int* postings_counts(const postings_t* postings);
+
+/**************** postings_iterate ****************/
+/* Call itemfunc(arg, docID, count) on every pair, in increasing docID
+ * order. NULL postings or itemfunc is ignored.
+ */
+void postings_iterate(const postings_t* postings, void* arg, void (*itemfunc)(void* arg, const int docID, const int count));
+
+/**************** postings_retain ****************/
+/* Keep only the pairs whose docIDs keepfunc(arg, docID) returns true
+ * for, in order, in one pass. NULL postings or keepfunc is ignored.
+ */
+void postings_retain(postings_t* postings, void* arg, bool (*keepfunc)(void* arg, const int docID));
+
+/**************** postings_delete ****************/
+/* Free the postings. NULL is ignored.
+ */
+void postings_delete(postings_t* postings);
+
+#endif // __POSTINGS_H
@@ -0,0 +1,257 @@
+/*
+ * scheduler.c - CS50 per-host politeness scheduler
+ *
+ * see scheduler.h for more information.
+ *
+ * Charlie Childress, cs50, February 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "scheduler.h"
+#include "webpage.h"
+#include "hashtable.h"
+#include "urlqueue.h"
+
+/**************** file-local global variables ****************/
+static const long TICK_MS = 10;       // resolution of the timer wheel
+#define WHEEL_SLOTS 512               // slots in the timer wheel, i.e., 5.12 seconds of ticks
+
+/**************** local types ****************/
+// one host and the pages queued for it
+typedef struct host {
+  urlqueue_t* pages;          // pages waiting to be fetched from this host, in priority order
+  long readyAt;               // earliest time the next fetch may start
+  bool scheduled;             // in the ready queue or in the timer wheel
+  struct host* nextReady;     // link in the ready queue
+  struct host* nextTimer;     // link in a timer-wheel slot
+  struct host* nextHost;      // link in the list of all hosts
+} host_t;
+
+/**************** global types ****************/
+typedef struct scheduler {
+  long delayMs;               // least time between fetch starts on one host
+  int (*scorefunc)(const webpage_t* page);  // scores pages within a depth, or NULL
+  int count;                  // pages queued, over all hosts
+  hashtable_t* hosts;         // host name -> host_t
+  host_t* allHosts;           // every host, to free them
+  host_t* readyHead;          // hosts whose delay has passed, oldest first
+  host_t* readyTail;
+  host_t* wheel[WHEEL_SLOTS]; // hosts waiting out their delay, by due tick
+  long wheelTick;             // last tick the wheel was advanced to
+} scheduler_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static host_t* findHost(scheduler_t* scheduler, const char* url);
+static void schedule(scheduler_t* scheduler, host_t* host);
+static void advance(scheduler_t* scheduler, const long nowTick);
+static long dueTick(const long readyAt);
+
+/**************** scheduler_new() ****************/
+/* see scheduler.h for description */
+scheduler_t* scheduler_new(const long delayMs, int (*scorefunc)(const webpage_t* page)) {
+  if (delayMs < 0) {
+    return NULL;
+  }
+  scheduler_t* scheduler = calloc(1, sizeof(scheduler_t));
+  if (scheduler == NULL) {
+    return NULL;
+  }
+  // few hosts are expected; the crawler is limited to internal URLs
+  scheduler->hosts = hashtable_new(50);
+  if (scheduler->hosts == NULL) {
+    free(scheduler);
+    return NULL;
+  }
+  scheduler->delayMs = delayMs;
+  scheduler->scorefunc = scorefunc;
+  return scheduler;
+}
+
+/**************** scheduler_add() ****************/
+/* see scheduler.h for description */
+bool scheduler_add(scheduler_t* scheduler, webpage_t* page) {
+  if (scheduler == NULL || page == NULL || webpage_getURL(page) == NULL) {
+    return false;
+  }
+  host_t* host = findHost(scheduler, webpage_getURL(page));
+  if (host == NULL) {
+    return false;
+  }
+  if (!urlqueue_push(host->pages, page)) {
+    return false;
+  }
+  scheduler->count++;
+  if (!host->scheduled) {
+    schedule(scheduler, host);
+  }
+  return true;
+}
+
+/**************** scheduler_next() ****************/
+/* see scheduler.h for description */
+webpage_t* scheduler_next(scheduler_t* scheduler, const long nowMs, long* waitMs) {
+  if (scheduler == NULL || waitMs == NULL) {
+    return NULL;
+  }
+  advance(scheduler, nowMs / TICK_MS);
+
+  host_t* host = scheduler->readyHead;
+  if (host == NULL) {   // nobody is ready; how long until the first slot with hosts in it?
+    *waitMs = -1;
+    if (scheduler->count > 0) {
+      for (long tick = scheduler->wheelTick + 1; tick <= scheduler->wheelTick + WHEEL_SLOTS; tick++) {
+        if (scheduler->wheel[tick % WHEEL_SLOTS] != NULL) {
+          *waitMs = tick * TICK_MS - nowMs;
+          break;
+        }
+      }
+    }
+    return NULL;
+  }
+
+  // take the longest-ready host off the ready queue, and a page from it
+  scheduler->readyHead = host->nextReady;
+  if (scheduler->readyHead == NULL) {
+    scheduler->readyTail = NULL;
+  }
+  host->scheduled = false;
+  webpage_t* page = urlqueue_pop(host->pages);
+  scheduler->count--;
+
+  // its next fetch must wait out the delay
+  host->readyAt = nowMs + scheduler->delayMs;
+  if (urlqueue_count(host->pages) > 0) {
+    schedule(scheduler, host);
+  }
+  return page;
+}
+
+/**************** scheduler_count() ****************/
+/* see scheduler.h for description */
+int scheduler_count(scheduler_t* scheduler) {
+  return scheduler ? scheduler->count : 0;
+}
+
+/**************** scheduler_iterate() ****************/
+/* see scheduler.h for description */
+void scheduler_iterate(scheduler_t* scheduler, void* arg, void (*itemfunc)(void* arg, webpage_t* page)) {
+  if (scheduler != NULL && itemfunc != NULL) {
+    for (host_t* host = scheduler->allHosts; host != NULL; host = host->nextHost) {
+      urlqueue_iterate(host->pages, arg, itemfunc);
+    }
+  }
+}
+
+/**************** scheduler_delete() ****************/
+/* see scheduler.h for description */
+void scheduler_delete(scheduler_t* scheduler, void (*itemdelete)(void* item)) {
+  if (scheduler != NULL) {
+    host_t* host = scheduler->allHosts;
+    while (host != NULL) {
+      host_t* next = host->nextHost;
+      urlqueue_delete(host->pages, itemdelete);
+      free(host);
+      host = next;
+    }
+    hashtable_delete(scheduler->hosts, NULL);   // the hosts themselves are gone already
+    free(scheduler);
+  }
+}
+
+/**************** findHost() ****************/
+/* Parameters:
+ *  scheduler, and a url of form scheme://host[:port][/pathname]
+ *
+ * Find the host_t for the url's host and port, creating it if this
+ * is the first page for it.
+ *
+ * Return the host, or NULL if the url has no host or on error
+ */
+static host_t* findHost(scheduler_t* scheduler, const char* url) {
+  const char* start = strstr(url, "://");
+  if (start == NULL) {
+    return NULL;
+  }
+  start += 3;
+  size_t len = strcspn(start, "/?#");
+  char* name = malloc(len + 1);
+  if (name == NULL) {
+    return NULL;
+  }
+  memcpy(name, start, len);
+  name[len] = '\0';
+
+  host_t* host = hashtable_find(scheduler->hosts, name);
+  if (host == NULL) {   // a host we have not seen before
+    host = calloc(1, sizeof(host_t));
+    if (host == NULL || (host->pages = urlqueue_new(scheduler->scorefunc)) == NULL) {
+      free(host);
+      free(name);
+      return NULL;
+    }
+    hashtable_insert(scheduler->hosts, name, host);
+    host->nextHost = scheduler->allHosts;
+    scheduler->allHosts = host;
+  }
+  free(name);
+  return host;
+}
+
+/**************** schedule() ****************/
+/* Put a host that has pages, and is in neither queue, into the ready
+ * queue if its delay has passed, or else into the timer wheel.
+ */
+static void schedule(scheduler_t* scheduler, host_t* host) {
+  host->scheduled = true;
+  long tick = dueTick(host->readyAt);
+  if (tick <= scheduler->wheelTick) {   // due already
+    host->nextReady = NULL;
+    if (scheduler->readyTail == NULL) {
+      scheduler->readyHead = host;
+    } else {
+      scheduler->readyTail->nextReady = host;
+    }
+    scheduler->readyTail = host;
+  } else {
+    host_t** slot = &scheduler->wheel[tick % WHEEL_SLOTS];
+    host->nextTimer = *slot;
+    *slot = host;
+  }
+}
+
+/**************** advance() ****************/
+/* Turn the timer wheel forward to nowTick, moving every host that
+ * has come due into the ready queue. Hosts due more than one turn of
+ * the wheel from now stay in their slot until a later turn.
+ */
+static void advance(scheduler_t* scheduler, const long nowTick) {
+  long from = scheduler->wheelTick + 1;
+  if (nowTick - from >= WHEEL_SLOTS) {  // a long idle spell: one turn visits every slot
+    from = nowTick - WHEEL_SLOTS + 1;
+  }
+  scheduler->wheelTick = nowTick;   // so that schedule() sees due hosts as ready
+  for (long tick = from; tick <= nowTick; tick++) {
+    host_t** link = &scheduler->wheel[tick % WHEEL_SLOTS];
+    while (*link != NULL) {
+      host_t* host = *link;
+      if (dueTick(host->readyAt) <= nowTick) {
+        *link = host->nextTimer;      // unlink from the slot...
+        schedule(scheduler, host);    // ...and queue as ready
+      } else {
+        link = &host->nextTimer;
+      }
+    }
+  }
+}
+
+/**************** dueTick() ****************/
+/* Return the first tick at or after readyAt, so that a host is never
+ * seen as due early.
+ */
+static long dueTick(const long readyAt) {
+  return (readyAt + TICK_MS - 1) / TICK_MS;
+}
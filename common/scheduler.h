@@ -0,0 +1,83 @@
+/*
+ * scheduler.h - header file for CS50 scheduler module
+ *
+ * A scheduler holds the pages waiting to be fetched, queued by host,
+ * and decides which page may be fetched next so that no host sees
+ * fetches start closer together than a minimum delay. Hosts whose
+ * delay has passed wait in a ready queue, served in turn; hosts still
+ * waiting out their delay sit in a timer wheel until they come due.
+ * Throughput thus grows with the number of distinct hosts, while each
+ * host sees at most one fetch start per delay. Each host's pages are
+ * kept in a urlqueue, so a host's pages are fetched shallowest first,
+ * then best score first.
+ *
+ * The scheduler does no locking of its own.
+ *
+ * Charlie Childress, February 2022, cs50
+ */
+
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "webpage.h"
+
+/**************** global types ****************/
+typedef struct scheduler scheduler_t;
+
+/**************** scheduler_new ****************/
+/* Parameters:
+ *  delayMs, the least time in milliseconds between the starts of two
+ *  fetches from the same host (0 for no delay), and scorefunc to rank
+ *  pages of the same depth, as for urlqueue_new (NULL for none)
+ *
+ * Return the new, empty scheduler, or NULL if there are any errors
+ */
+scheduler_t* scheduler_new(const long delayMs, int (*scorefunc)(const webpage_t* page));
+
+/**************** scheduler_add ****************/
+/* Parameters:
+ *  scheduler, and a webpage_t* to fetch later
+ *
+ * Queue the page under its URL's host. The scheduler owns the page
+ * until scheduler_next returns it.
+ *
+ * Return true if the page was queued, false on bad parameters
+ */
+bool scheduler_add(scheduler_t* scheduler, webpage_t* page);
+
+/**************** scheduler_next ****************/
+/* Parameters:
+ *  scheduler, nowMs for the current time in milliseconds (from a
+ *  clock that never jumps), and a long* for the time to wait
+ *
+ * Pick the page to fetch now: the first, in priority order, of the
+ * host that has been ready the longest; and start that host's delay
+ * over.
+ *
+ * Return the page, which the caller owns again
+ * Return NULL if no page may be fetched yet; then *waitMs is how long
+ * until one might be, or -1 if no page is queued at all
+ */
+webpage_t* scheduler_next(scheduler_t* scheduler, const long nowMs, long* waitMs);
+
+/**************** scheduler_count ****************/
+/* Return the number of pages queued, or 0 if scheduler is NULL
+ */
+int scheduler_count(scheduler_t* scheduler);
+
+/**************** scheduler_iterate ****************/
+/* Call itemfunc(arg, page) on every page queued, host by host. NULL
+ * scheduler or itemfunc is ignored.
+ */
+void scheduler_iterate(scheduler_t* scheduler, void* arg, void (*itemfunc)(void* arg, webpage_t* page));
+
+/**************** scheduler_delete ****************/
+/* Free the scheduler, calling itemdelete (if not NULL) on every page
+ * still queued. NULL is ignored.
+ */
+void scheduler_delete(scheduler_t* scheduler, void (*itemdelete)(void* item));
+
+#endif // __SCHEDULER_H
@@ -0,0 +1,873 @@
+/*
+ * segments.c - CS50 index segments module
+ *
+ * see segments.h for more information.
+ *
+ * Charlie Childress, cs50, February 2022
+ */
+
+#define _GNU_SOURCE       // flock, fsync, fileno, strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "segments.h"
+#include "index.h"
+#include "docmeta.h"
+#include "postings.h"
+#include "tombstones.h"
+#include "hashtable.h"
+
+/**************** file-local global variables ****************/
+static const char MANIFEST_MAGIC[] = "TSESEGMENTS";
+static const int MANIFEST_VERSION = 3;    // version 1 had no tombstones, and 2 no crawl
+static const char NO_TOMBSTONES[] = "-";  // the manifest's tombstones name when there are none
+static const char NO_CRAWL[] = "-";       // and its crawl when none is known
+static const int MERGE_FACTOR = 4;      // segments of a tier merged at once
+static const uint64_t TIER_BYTES = 1 << 20;   // segments smaller than this are all of tier 0
+static const int OPEN_TRIES = 3;        // times segments_open rereads a manifest whose segments vanish
+
+/**************** local types ****************/
+// one segment of the index
+typedef struct segment {
+  char* name;                 // of its index file, in the manifest's directory; NULL if not a manifest's
+  int first;                  // its docIDs, from first up to end
+  int end;
+  uint64_t bytes;             // of its index file
+  index_t* index;             // once opened for reading
+  docmeta_t* meta;            // its document table, if it has one
+} segment_t;
+
+/**************** global types ****************/
+typedef struct segments {
+  char* manifest;
+  char* directory;            // of the manifest, with a trailing '/', or "" for the current one
+  segment_t* list;            // in docID order
+  int count;
+  int room;
+  int nextNumber;             // of the next segment file
+  tombstones_t* deleted;      // the deleted docIDs; a writer's always, a reader's if any
+  char* deletedName;          // its file is <name>.deleted in the manifest's directory; NULL if none
+  bool deletedChanged;        // since it was last written; under 'lock'
+  char* crawl;                // the identity of the crawl the pages are of, or NULL if not known
+  hashtable_t* urls;          // a writer's map of each live URL to its docID (in urlDocIDs), once built
+  int* urlDocIDs;
+  // a writer's, from segments_lock; the list, nextNumber, deleted, done, and ok are under 'lock'
+  int lockFd;                 // of the lock file, or -1 if not a writer
+  pthread_t merger;
+  bool merging;               // whether the merger thread is running
+  bool done;                  // once the writer has no more segments to add
+  bool ok;                    // false once a merge or manifest could not be written
+  pthread_mutex_t lock;
+  pthread_cond_t changed;     // signalled when a segment is added, or done is set
+} segments_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static segments_t* segmentsNew(const char* manifest);
+static bool isManifest(const char* filename);
+static bool readManifest(segments_t* segs, FILE* fp);
+static bool writeManifest(segments_t* segs);
+static bool loadTombstones(segments_t* segs);
+static bool mapURLs(segments_t* segs);
+static bool append(segments_t* segs, segment_t segment);
+static bool openSegment(segments_t* segs, segment_t* segment);
+static char* pathOf(segments_t* segs, const char* name, const char* suffix);
+static char* newName(segments_t* segs, const int number);
+static bool syncFile(const char* filename, uint64_t* bytes);
+static void* mergerMain(void* arg);
+static bool pickMerge(segments_t* segs, int* from, int* to);
+static int tierOf(const uint64_t bytes);
+static void forgetDeleted(segments_t* segs, const tombstones_t* merged, const int first, const int end,
+                          const bool undo);
+static bool mergeSegments(segments_t* segs, segment_t* inputs, const int numInputs, const char* name,
+                          const tombstones_t* deleted);
+static docmeta_t* mergeMeta(segments_t* segs, segment_t* inputs, const int numInputs, const tombstones_t* deleted);
+static void removeFiles(segments_t* segs, const char* name);
+
+/**************** segments_open() ****************/
+/* see segments.h for description */
+segments_t* segments_open(const char* indexFilename) {
+  if (indexFilename == NULL) {
+    return NULL;
+  }
+  if (!isManifest(indexFilename)) {
+    // an index built all at once: its one segment holds every docID
+    segments_t* segs = segmentsNew(indexFilename);
+    segment_t segment = { NULL, 1, INT_MAX, 0, NULL, NULL };
+    if (segs == NULL || !append(segs, segment) || !openSegment(segs, &segs->list[0])) {
+      segments_close(segs);
+      return NULL;
+    }
+    return segs;
+  }
+
+  // a merge may remove a segment between reading the manifest and opening it;
+  // the manifest that replaced it lists what it was merged into
+  for (int try = 0; try < OPEN_TRIES; try++) {
+    segments_t* segs = segmentsNew(indexFilename);
+    FILE* fp = fopen(indexFilename, "r");
+    bool ok = segs != NULL && fp != NULL && readManifest(segs, fp);
+    if (fp != NULL) {
+      fclose(fp);
+    }
+    ok = ok && loadTombstones(segs);
+    for (int i = 0; ok && i < segs->count; i++) {
+      ok = openSegment(segs, &segs->list[i]);
+    }
+    if (ok) {
+      return segs;
+    }
+    segments_close(segs);
+  }
+  return NULL;
+}
+
+/**************** segments_lookup() ****************/
+/* see segments.h for description */
+postings_t* segments_lookup(segments_t* segs, const char* word) {
+  if (segs == NULL || word == NULL) {
+    return NULL;
+  }
+  postings_t* postings = postings_new();
+  for (int i = 0; postings != NULL && i < segs->count; i++) {
+    // the segments' docIDs do not overlap, so each merge just appends
+    postings_t* part = index_lookup(segs->list[i].index, word);
+    if (part == NULL || !postings_merge(postings, part, 0)) {
+      postings_delete(postings);
+      postings = NULL;
+    }
+    postings_delete(part);
+  }
+  tombstones_filter(segs->deleted, postings);    // deleted documents never reach the query
+  return postings;
+}
+
+/**************** segments_meta() ****************/
+/* see segments.h for description */
+docmeta_t* segments_meta(segments_t* segs, const int docID) {
+  if (segs == NULL) {
+    return NULL;
+  }
+  // the segment with the last first docID at or before the docID
+  int low = 0;
+  int high = segs->count;
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (segs->list[mid].first <= docID) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low > 0 && docID < segs->list[low - 1].end ? segs->list[low - 1].meta : NULL;
+}
+
+/**************** segments_count() ****************/
+/* see segments.h for description */
+int segments_count(segments_t* segs) {
+  return segs ? segs->count : 0;
+}
+
+/**************** segments_close() ****************/
+/* see segments.h for description */
+void segments_close(segments_t* segs) {
+  if (segs != NULL) {
+    for (int i = 0; i < segs->count; i++) {
+      free(segs->list[i].name);
+      index_delete(segs->list[i].index);
+      docmeta_delete(segs->list[i].meta);
+    }
+    free(segs->list);
+    tombstones_delete(segs->deleted);
+    free(segs->deletedName);
+    free(segs->crawl);
+    hashtable_delete(segs->urls, NULL);   // the docIDs are in urlDocIDs
+    free(segs->urlDocIDs);
+    free(segs->manifest);
+    free(segs->directory);
+    pthread_mutex_destroy(&segs->lock);
+    pthread_cond_destroy(&segs->changed);
+    free(segs);
+  }
+}
+
+/**************** segments_lock() ****************/
+/* see segments.h for description */
+segments_t* segments_lock(const char* manifest) {
+  segments_t* segs = manifest ? segmentsNew(manifest) : NULL;
+  char* lockFilename = segs ? pathOf(segs, NULL, ".lock") : NULL;
+  if (lockFilename == NULL) {
+    segments_close(segs);
+    return NULL;
+  }
+  segs->lockFd = open(lockFilename, O_RDWR | O_CREAT, 0644);
+  bool ok = segs->lockFd >= 0 && flock(segs->lockFd, LOCK_EX) == 0;
+  if (!ok) {
+    fprintf(stderr, "%s: cannot take the index's lock\n", lockFilename);
+  }
+  free(lockFilename);
+
+  // only now, with the lock, is the manifest sure not to change under us
+  FILE* fp = ok ? fopen(manifest, "r") : NULL;
+  struct stat st;
+  if (ok && (fp == NULL ? errno == ENOENT : fstat(fileno(fp), &st) == 0 && st.st_size == 0)) {
+    ok = writeManifest(segs);   // a new index, of no segments yet
+  } else if (ok && fp == NULL) {
+    fprintf(stderr, "%s: cannot read the index\n", manifest);
+    ok = false;
+  } else if (ok && !isManifest(manifest)) {
+    fprintf(stderr, "%s: not an index built with --append; cannot add to it\n", manifest);
+    ok = false;
+  } else if (ok && (!readManifest(segs, fp) || !loadTombstones(segs))) {
+    fprintf(stderr, "%s: damaged index manifest\n", manifest);
+    ok = false;
+  }
+  if (fp != NULL) {
+    fclose(fp);
+  }
+  if (ok && segs->deleted == NULL && (segs->deleted = tombstones_new()) == NULL) {
+    ok = false;
+  }
+  if (!ok) {
+    close(segs->lockFd);
+    segments_close(segs);
+    return NULL;
+  }
+
+  segs->ok = true;
+  segs->merging = pthread_create(&segs->merger, NULL, mergerMain, segs) == 0;
+  return segs;
+}
+
+/**************** segments_next() ****************/
+/* see segments.h for description */
+int segments_next(segments_t* segs) {
+  if (segs == NULL) {
+    return 1;
+  }
+  pthread_mutex_lock(&segs->lock);
+  int next = segs->count > 0 ? segs->list[segs->count - 1].end : 1;
+  pthread_mutex_unlock(&segs->lock);
+  return next;
+}
+
+/**************** segments_add() ****************/
+/* see segments.h for description */
+bool segments_add(segments_t* segs, index_t* index, docmeta_t* meta, const int first, const int end) {
+  if (segs == NULL || segs->lockFd < 0 || index == NULL || meta == NULL
+      || first != segments_next(segs) || end <= first) {
+    return false;
+  }
+  pthread_mutex_lock(&segs->lock);
+  char* name = newName(segs, segs->nextNumber++);
+  pthread_mutex_unlock(&segs->lock);
+  char* filename = pathOf(segs, name, "");
+  char* metaFilename = pathOf(segs, name, ".meta");
+  segment_t segment = { name, first, end, 0, NULL, NULL };
+
+  // the files go to disk before the manifest names them
+  bool ok = filename != NULL && metaFilename != NULL
+         && index_writeBinary(index, filename) && docmeta_write(meta, metaFilename)
+         && syncFile(filename, &segment.bytes) && syncFile(metaFilename, NULL);
+  free(filename);
+  free(metaFilename);
+
+  pthread_mutex_lock(&segs->lock);
+  hashtable_delete(segs->urls, NULL);   // the map is of the segments before this one
+  segs->urls = NULL;
+  free(segs->urlDocIDs);
+  segs->urlDocIDs = NULL;
+  ok = ok && append(segs, segment);
+  if (ok && !writeManifest(segs)) {
+    segs->count--;    // as it was on disk
+    ok = false;
+  }
+  pthread_cond_signal(&segs->changed);
+  pthread_mutex_unlock(&segs->lock);
+  if (!ok && name != NULL) {
+    removeFiles(segs, name);
+    free(name);
+  }
+  return ok;
+}
+
+/**************** segments_crawl() ****************/
+/* see segments.h for description */
+const char* segments_crawl(segments_t* segs) {
+  return segs ? segs->crawl : NULL;
+}
+
+/**************** segments_setCrawl() ****************/
+/* see segments.h for description */
+bool segments_setCrawl(segments_t* segs, const char* crawl) {
+  if (segs == NULL || segs->lockFd < 0 || crawl == NULL || crawl[0] == '\0' || strpbrk(crawl, " \t\n") != NULL) {
+    return false;
+  }
+  char* copy = strdup(crawl);
+  if (copy == NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&segs->lock);
+  free(segs->crawl);
+  segs->crawl = copy;
+  pthread_mutex_unlock(&segs->lock);
+  return true;
+}
+
+/**************** segments_remove() ****************/
+/* see segments.h for description */
+bool segments_remove(segments_t* segs, const int docID) {
+  if (segs == NULL || segs->lockFd < 0 || docID < 1) {
+    return false;
+  }
+  pthread_mutex_lock(&segs->lock);
+  bool ok = docID < (segs->count > 0 ? segs->list[segs->count - 1].end : 1);
+  if (ok && !tombstones_has(segs->deleted, docID)) {
+    ok = tombstones_add(segs->deleted, docID);
+    segs->deletedChanged = segs->deletedChanged || ok;
+  }
+  pthread_mutex_unlock(&segs->lock);
+  return ok;
+}
+
+/**************** segments_findURL() ****************/
+/* see segments.h for description */
+int segments_findURL(segments_t* segs, const char* url) {
+  if (segs == NULL || segs->lockFd < 0 || url == NULL) {
+    return 0;
+  }
+  pthread_mutex_lock(&segs->lock);
+  int* docID = segs->urls != NULL || mapURLs(segs) ? hashtable_find(segs->urls, url) : NULL;
+  int found = docID != NULL && !tombstones_has(segs->deleted, *docID) ? *docID : 0;
+  pthread_mutex_unlock(&segs->lock);
+  return found;
+}
+
+/**************** segments_unlock() ****************/
+/* see segments.h for description */
+bool segments_unlock(segments_t* segs) {
+  if (segs == NULL || segs->lockFd < 0) {
+    return false;
+  }
+  pthread_mutex_lock(&segs->lock);
+  segs->done = true;
+  pthread_cond_signal(&segs->changed);
+  pthread_mutex_unlock(&segs->lock);
+  if (segs->merging) {
+    pthread_join(segs->merger, NULL);
+  }
+  // the deletions are written even after a failed merge, which left every segment they mark listed
+  bool ok = !segs->deletedChanged || writeManifest(segs);
+  ok = segs->ok && ok;
+  close(segs->lockFd);    // which releases the lock
+  segments_close(segs);
+  return ok;
+}
+
+/**************** segmentsNew() ****************/
+/* Return new, empty segments of the manifest, or NULL if out of memory.
+ */
+static segments_t* segmentsNew(const char* manifest) {
+  segments_t* segs = calloc(1, sizeof(segments_t));
+  if (segs == NULL) {
+    return NULL;
+  }
+  segs->lockFd = -1;
+  pthread_mutex_init(&segs->lock, NULL);
+  pthread_cond_init(&segs->changed, NULL);
+  const char* slash = strrchr(manifest, '/');
+  size_t length = slash ? slash - manifest + 1 : 0;
+  segs->manifest = malloc(strlen(manifest) + 1);
+  segs->directory = malloc(length + 1);
+  if (segs->manifest == NULL || segs->directory == NULL) {
+    segments_close(segs);
+    return NULL;
+  }
+  strcpy(segs->manifest, manifest);
+  memcpy(segs->directory, manifest, length);
+  segs->directory[length] = '\0';
+  return segs;
+}
+
+/**************** isManifest() ****************/
+/* Return true if the file starts as a manifest does.
+ */
+static bool isManifest(const char* filename) {
+  char start[sizeof(MANIFEST_MAGIC)];
+  FILE* fp = fopen(filename, "r");
+  bool manifest = fp != NULL && fread(start, 1, sizeof(start), fp) == sizeof(start)
+               && memcmp(start, MANIFEST_MAGIC, sizeof(start) - 1) == 0 && start[sizeof(start) - 1] == ' ';
+  if (fp != NULL) {
+    fclose(fp);
+  }
+  return manifest;
+}
+
+/**************** readManifest() ****************/
+/* Read the manifest from fp into the (empty) segments, checking that
+ * its segments' docIDs are in order and do not overlap.
+ * Return false if it is not a whole manifest, or out of memory.
+ */
+static bool readManifest(segments_t* segs, FILE* fp) {
+  char magic[sizeof(MANIFEST_MAGIC)];
+  char name[NAME_MAX + 1];
+  int version;
+  if (fscanf(fp, "%11s %d %d", magic, &version, &segs->nextNumber) != 3
+      || strcmp(magic, MANIFEST_MAGIC) != 0 || version < 1 || version > MANIFEST_VERSION || segs->nextNumber < 0) {
+    return false;
+  }
+  if (version >= 2) {
+    if (fscanf(fp, "%255s", name) != 1 || strchr(name, '/') != NULL) {
+      return false;
+    }
+    if (strcmp(name, NO_TOMBSTONES) != 0 && (segs->deletedName = strdup(name)) == NULL) {
+      return false;
+    }
+  }
+  if (version >= 3) {
+    if (fscanf(fp, "%255s", name) != 1) {
+      return false;
+    }
+    if (strcmp(name, NO_CRAWL) != 0 && (segs->crawl = strdup(name)) == NULL) {
+      return false;
+    }
+  }
+  segment_t segment = { NULL, 0, 0, 0, NULL, NULL };
+  int fields;
+  while ((fields = fscanf(fp, "%255s %d %d %" SCNu64, name, &segment.first, &segment.end, &segment.bytes)) == 4) {
+    int previous = segs->count > 0 ? segs->list[segs->count - 1].end : 1;
+    if (strchr(name, '/') != NULL || segment.first < previous || segment.end <= segment.first
+        || (segment.name = strdup(name)) == NULL || !append(segs, segment)) {
+      free(segment.name);
+      return false;
+    }
+  }
+  return fields == EOF && !ferror(fp);
+}
+
+/**************** writeManifest() ****************/
+/* Write the manifest of the segments to a temporary file, flush it to
+ * disk, and rename it over the manifest, as checkpoint.c does; if the
+ * tombstones have changed, write them first, to a new file (none, if no
+ * docID is marked any more), which the manifest names, so that a reader
+ * finds the segments and tombstones of one moment.
+ * Return false on any error, leaving the manifest as it was.
+ */
+static bool writeManifest(segments_t* segs) {
+  char* oldDeleted = segs->deletedName;
+  char* newDeleted = NULL;
+  const bool changed = segs->deletedChanged;
+  if (changed && tombstones_count(segs->deleted) > 0) {
+    newDeleted = newName(segs, segs->nextNumber++);
+    char* filename = newDeleted ? pathOf(segs, newDeleted, ".deleted") : NULL;
+    bool written = filename != NULL && tombstones_write(segs->deleted, filename) && syncFile(filename, NULL);
+    free(filename);
+    if (!written) {
+      if (newDeleted != NULL) {
+        removeFiles(segs, newDeleted);
+      }
+      free(newDeleted);
+      return false;
+    }
+  }
+  if (changed) {
+    segs->deletedName = newDeleted;   // none, once a merge has left out every docID marked
+  }
+
+  char* tmpname = pathOf(segs, NULL, ".tmp");
+  FILE* fp = tmpname ? fopen(tmpname, "w") : NULL;
+  bool ok = fp != NULL && fprintf(fp, "%s %d %d %s %s\n", MANIFEST_MAGIC, MANIFEST_VERSION, segs->nextNumber,
+                                  segs->deletedName ? segs->deletedName : NO_TOMBSTONES,
+                                  segs->crawl ? segs->crawl : NO_CRAWL) > 0;
+  for (int i = 0; ok && i < segs->count; i++) {
+    const segment_t* segment = &segs->list[i];
+    ok = fprintf(fp, "%s %d %d %" PRIu64 "\n", segment->name, segment->first, segment->end, segment->bytes) > 0;
+  }
+  ok = ok && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+  ok = fp != NULL && fclose(fp) == 0 && ok;
+  ok = ok && rename(tmpname, segs->manifest) == 0;
+  if (ok) {
+    // the rename itself must be on disk before the old segments can go
+    int dirfd = open(segs->directory[0] ? segs->directory : ".", O_RDONLY | O_DIRECTORY);
+    if (dirfd >= 0) {
+      fsync(dirfd);
+      close(dirfd);
+    }
+  } else if (tmpname != NULL) {
+    unlink(tmpname);
+  }
+  free(tmpname);
+
+  // the tombstones file the manifest does not name is not needed
+  if (changed) {
+    char* unused = ok ? oldDeleted : newDeleted;
+    if (unused != NULL) {
+      removeFiles(segs, unused);
+      free(unused);
+    }
+    segs->deletedName = ok ? newDeleted : oldDeleted;
+    segs->deletedChanged = !ok;
+  }
+  return ok;
+}
+
+/**************** loadTombstones() ****************/
+/* Load the tombstones file the manifest names, if any.
+ * Return false if it cannot be read.
+ */
+static bool loadTombstones(segments_t* segs) {
+  if (segs->deletedName == NULL) {
+    return true;
+  }
+  char* filename = pathOf(segs, segs->deletedName, ".deleted");
+  segs->deleted = filename ? tombstones_load(filename) : NULL;
+  free(filename);
+  return segs->deleted != NULL;
+}
+
+/**************** mapURLs() ****************/
+/* Build the writer's map of URLs to docIDs from the segments' document
+ * tables, leaving out deleted docIDs; where a URL has more than one
+ * live docID, the map keeps the latest. Called with the lock held.
+ * Return false if out of memory.
+ */
+static bool mapURLs(segments_t* segs) {
+  int end = segs->count > 0 ? segs->list[segs->count - 1].end : 1;
+  segs->urlDocIDs = malloc(end * sizeof(int));
+  segs->urls = hashtable_new(end);
+  if (segs->urlDocIDs == NULL || segs->urls == NULL) {
+    hashtable_delete(segs->urls, NULL);
+    segs->urls = NULL;
+    free(segs->urlDocIDs);
+    segs->urlDocIDs = NULL;
+    return false;
+  }
+  // latest first, since hashtable_insert keeps the first item of a key
+  for (int i = segs->count - 1; i >= 0; i--) {
+    const segment_t* segment = &segs->list[i];
+    char* metaFilename = pathOf(segs, segment->name, ".meta");
+    docmeta_t* meta = metaFilename ? docmeta_load(metaFilename) : NULL;   // none: its URLs cannot be found
+    free(metaFilename);
+    int last = docmeta_count(meta) < segment->end - 1 ? docmeta_count(meta) : segment->end - 1;
+    for (int docID = last; docID >= segment->first; docID--) {
+      const char* url = docmeta_getURL(meta, docID);
+      if (url != NULL && !tombstones_has(segs->deleted, docID)) {
+        segs->urlDocIDs[docID] = docID;
+        hashtable_insert(segs->urls, url, &segs->urlDocIDs[docID]);
+      }
+    }
+    docmeta_delete(meta);
+  }
+  return true;
+}
+
+/**************** append() ****************/
+/* Add the segment to the end of the list, which takes over its name.
+ * Return false if out of memory.
+ */
+static bool append(segments_t* segs, segment_t segment) {
+  if (segs->count == segs->room) {
+    int room = segs->room ? segs->room * 2 : 8;
+    segment_t* list = realloc(segs->list, room * sizeof(segment_t));
+    if (list == NULL) {
+      return false;
+    }
+    segs->list = list;
+    segs->room = room;
+  }
+  segs->list[segs->count++] = segment;
+  return true;
+}
+
+/**************** openSegment() ****************/
+/* Map the segment's index - or, for the one segment of an index that
+ * is not a manifest, load it if it is not binary - and its document
+ * table, if it has one.
+ * Return false if the index cannot be read.
+ */
+static bool openSegment(segments_t* segs, segment_t* segment) {
+  char* filename = segment->name ? pathOf(segs, segment->name, "") : pathOf(segs, NULL, "");
+  char* metaFilename = segment->name ? pathOf(segs, segment->name, ".meta") : pathOf(segs, NULL, ".meta");
+  if (filename != NULL && metaFilename != NULL) {
+    segment->index = index_map(filename);
+    if (segment->index == NULL && segment->name == NULL) {
+      segment->index = index_load(filename);
+    }
+    segment->meta = docmeta_load(metaFilename);
+  }
+  free(filename);
+  free(metaFilename);
+  return segment->index != NULL;
+}
+
+/**************** pathOf() ****************/
+/* Return the pathname of the named file in the manifest's directory,
+ * or, if name is NULL, of the manifest, with the suffix appended; the
+ * caller must free it. NULL if out of memory.
+ */
+static char* pathOf(segments_t* segs, const char* name, const char* suffix) {
+  const char* base = name ? name : segs->manifest;
+  const char* directory = name ? segs->directory : "";
+  char* path = malloc(strlen(directory) + strlen(base) + strlen(suffix) + 1);
+  if (path != NULL) {
+    sprintf(path, "%s%s%s", directory, base, suffix);
+  }
+  return path;
+}
+
+/**************** newName() ****************/
+/* Return the name of segment file number n - the manifest's own name
+ * without its directory, then '.' and the number - which the caller
+ * must free; NULL if out of memory.
+ */
+static char* newName(segments_t* segs, const int number) {
+  const char* base = segs->manifest + strlen(segs->directory);
+  char* name = malloc(strlen(base) + 13);
+  if (name != NULL) {
+    sprintf(name, "%s.%d", base, number);
+  }
+  return name;
+}
+
+/**************** syncFile() ****************/
+/* Flush the file to disk, and get its length into bytes, unless NULL.
+ * Return false on any error.
+ */
+static bool syncFile(const char* filename, uint64_t* bytes) {
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  bool ok = fd >= 0 && fsync(fd) == 0 && fstat(fd, &st) == 0;
+  if (ok && bytes != NULL) {
+    *bytes = st.st_size;
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  return ok;
+}
+
+/**************** mergerMain() ****************/
+/* The writer's merger thread: whenever the segments need a merge, do
+ * it, without the lock, so that segments go on being added meanwhile;
+ * then list its segment in place of those it merged, write the
+ * manifest, and remove their files. Once the writer is done, finish
+ * the merges there are, and return; or return at the first that fails.
+ */
+static void* mergerMain(void* arg) {
+  segments_t* segs = arg;
+  pthread_mutex_lock(&segs->lock);
+  for (;;) {
+    int from, to;
+    bool found;
+    while (!(found = pickMerge(segs, &from, &to)) && !segs->done) {
+      pthread_cond_wait(&segs->changed, &segs->lock);
+    }
+    if (!found) {
+      break;
+    }
+    // what to merge: only new segments are appended meanwhile, so list[from..to) stays put,
+    // but the list itself may move
+    int numInputs = to - from;
+    segment_t* inputs = malloc(numInputs * sizeof(segment_t));
+    char* name = newName(segs, segs->nextNumber++);
+    tombstones_t* deleted = tombstones_copy(segs->deleted);    // as of now; more may come meanwhile
+    if (inputs == NULL || name == NULL || deleted == NULL) {
+      free(inputs);
+      free(name);
+      tombstones_delete(deleted);
+      segs->ok = false;
+      break;
+    }
+    memcpy(inputs, &segs->list[from], numInputs * sizeof(segment_t));
+    pthread_mutex_unlock(&segs->lock);
+
+    segment_t merged = { name, inputs[0].first, inputs[numInputs - 1].end, 0, NULL, NULL };
+    bool ok = mergeSegments(segs, inputs, numInputs, name, deleted);
+    char* filename = pathOf(segs, name, "");
+    ok = ok && filename != NULL && syncFile(filename, &merged.bytes);
+    free(filename);
+
+    pthread_mutex_lock(&segs->lock);
+    if (ok) {
+      segs->list[from] = merged;
+      memmove(&segs->list[from + 1], &segs->list[to], (segs->count - to) * sizeof(segment_t));
+      segs->count -= numInputs - 1;
+      // no listed segment holds the docIDs the merge left out any more, so the same
+      // manifest drops their tombstones (but not those marked since the copy)
+      forgetDeleted(segs, deleted, merged.first, merged.end, false);
+      if (writeManifest(segs)) {
+        for (int i = 0; i < numInputs; i++) {
+          removeFiles(segs, inputs[i].name);
+          free(inputs[i].name);
+        }
+      } else {
+        // put the list, and the tombstones, back as the manifest on disk has them
+        memmove(&segs->list[to], &segs->list[from + 1], (segs->count - from - 1) * sizeof(segment_t));
+        memcpy(&segs->list[from], inputs, numInputs * sizeof(segment_t));
+        segs->count += numInputs - 1;
+        forgetDeleted(segs, deleted, merged.first, merged.end, true);
+        ok = false;
+      }
+    }
+    tombstones_delete(deleted);
+    free(inputs);
+    if (!ok) {
+      removeFiles(segs, name);
+      free(name);
+      segs->ok = false;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&segs->lock);
+  return NULL;
+}
+
+/**************** pickMerge() ****************/
+/* Find the merge the segments need, if any: for the lowest tier t
+ * with MERGE_FACTOR segments side by side - with none of a higher
+ * tier between them - the segments from the first of them to the
+ * last, which may include some of lower tiers.
+ * Return true, with the segments from list[from] up to list[to], if
+ * there is one.
+ */
+static bool pickMerge(segments_t* segs, int* from, int* to) {
+  int maxTier = 0;
+  for (int i = 0; i < segs->count; i++) {
+    int tier = tierOf(segs->list[i].bytes);
+    maxTier = tier > maxTier ? tier : maxTier;
+  }
+  for (int t = 0; t <= maxTier; t++) {
+    int found = 0;
+    for (int i = 0; i < segs->count; i++) {
+      int tier = tierOf(segs->list[i].bytes);
+      if (tier > t) {
+        found = 0;    // a merge cannot reach across it
+      } else if (tier == t) {
+        if (found++ == 0) {
+          *from = i;
+        }
+        if (found == MERGE_FACTOR) {
+          *to = i + 1;
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/**************** tierOf() ****************/
+/* Return the tier of a segment of the given bytes: 0 under TIER_BYTES,
+ * and one more for each MERGE_FACTOR times that.
+ */
+static int tierOf(const uint64_t bytes) {
+  int tier = 0;
+  for (uint64_t limit = TIER_BYTES; bytes >= limit && limit <= UINT64_MAX / MERGE_FACTOR; limit *= MERGE_FACTOR) {
+    tier++;
+  }
+  return tier;
+}
+
+/**************** forgetDeleted() ****************/
+/* Unmark, in the segments' tombstones, the docIDs from first up to end
+ * that a merge left out (those in merged) - or, to undo that, mark
+ * them again. Called with the lock held.
+ */
+static void forgetDeleted(segments_t* segs, const tombstones_t* merged, const int first, const int end,
+                          const bool undo) {
+  for (int docID = first; docID < end && tombstones_count(merged) > 0; docID++) {
+    if (tombstones_has(merged, docID)) {
+      if (undo) {
+        tombstones_add(segs->deleted, docID);
+      } else {
+        tombstones_remove(segs->deleted, docID);
+      }
+      segs->deletedChanged = true;
+    }
+  }
+}
+
+/**************** mergeSegments() ****************/
+/* Merge the segments' index files into the named one, and their
+ * document tables into its table (without a table, if any of them has
+ * none), leaving the deleted docIDs out of both. Safe to call without
+ * the lock, since the files never change.
+ * Return false on any error.
+ */
+static bool mergeSegments(segments_t* segs, segment_t* inputs, const int numInputs, const char* name,
+                          const tombstones_t* deleted) {
+  char** filenames = calloc(numInputs, sizeof(char*));
+  char* filename = pathOf(segs, name, "");
+  char* metaFilename = pathOf(segs, name, ".meta");
+  bool ok = filenames != NULL && filename != NULL && metaFilename != NULL;
+  for (int i = 0; ok && i < numInputs; i++) {
+    ok = (filenames[i] = pathOf(segs, inputs[i].name, "")) != NULL;
+  }
+  ok = ok && index_mergeBinary(filenames, numInputs, filename, deleted);
+  if (ok) {
+    docmeta_t* meta = mergeMeta(segs, inputs, numInputs, deleted);
+    if (meta != NULL) {
+      ok = docmeta_write(meta, metaFilename) && syncFile(metaFilename, NULL);
+      docmeta_delete(meta);
+    }
+  }
+  for (int i = 0; filenames != NULL && i < numInputs; i++) {
+    free(filenames[i]);
+  }
+  free(filenames);
+  free(filename);
+  free(metaFilename);
+  return ok;
+}
+
+/**************** mergeMeta() ****************/
+/* Return a new document table of every document in the segments'
+ * tables but the deleted, or NULL if one of them has none, or out of
+ * memory.
+ */
+static docmeta_t* mergeMeta(segments_t* segs, segment_t* inputs, const int numInputs, const tombstones_t* deleted) {
+  docmeta_t* merged = docmeta_new();
+  for (int i = 0; merged != NULL && i < numInputs; i++) {
+    char* metaFilename = pathOf(segs, inputs[i].name, ".meta");
+    docmeta_t* meta = metaFilename ? docmeta_load(metaFilename) : NULL;
+    free(metaFilename);
+    bool ok = meta != NULL;
+    for (int docID = inputs[i].first; ok && docID < inputs[i].end && docID <= docmeta_count(meta); docID++) {
+      const char* url = docmeta_getURL(meta, docID);
+      ok = url == NULL || tombstones_has(deleted, docID)
+        || docmeta_add(merged, docID, url, docmeta_getDepth(meta, docID), docmeta_getLength(meta, docID));
+    }
+    docmeta_delete(meta);
+    if (!ok) {
+      docmeta_delete(merged);
+      merged = NULL;
+    }
+  }
+  return merged;
+}
+
+/**************** removeFiles() ****************/
+/* Remove the files of the name - a segment's index file and document
+ * table, or a tombstones file - that are there.
+ */
+static void removeFiles(segments_t* segs, const char* name) {
+  const char* suffixes[] = { "", ".meta", ".deleted" };
+  for (int i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+    char* filename = pathOf(segs, name, suffixes[i]);
+    if (filename != NULL) {
+      unlink(filename);
+    }
+    free(filename);
+  }
+}
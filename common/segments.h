@@ -0,0 +1,187 @@
+/*
+ * segments.h - header file for CS50 index segments module
+ *
+ * An index can be built up in increments, each run of the indexer
+ * indexing only the pages crawled since the last, as a list of
+ * segments: binary index files (see index.h), each holding the
+ * documents of one range of docIDs, with its document table (see
+ * docmeta.h) next to it. A manifest, at the indexFilename, lists the
+ * live segments in docID order, one per line after its header:
+ *   TSESEGMENTS 3 nextNumber deleted crawl
+ *   name first end bytes
+ *   ...
+ * where the segment file name, in the manifest's directory, holds the
+ * docIDs from first up to (not including) end and is bytes long;
+ * nextNumber numbers the next file: <indexFilename>.<number>, with its
+ * table in <indexFilename>.<number>.meta; and the index's deleted
+ * docIDs (see tombstones.h) are in the file <deleted>.deleted, or there
+ * are none if deleted is "-"; and crawl is the identity of the crawl
+ * (see pagedir.h) whose pages the segments hold, or "-" if not known.
+ * (A version 1 manifest has no deleted, and versions 1 and 2 no crawl.)
+ *
+ * Segment files never change once written. Adding documents writes a
+ * new segment, then a new manifest, to a temporary file that is renamed
+ * over the old one, so that a reader opening the manifest at any time
+ * finds a whole list of whole segments, and pays only for the new
+ * documents, not for those already indexed. Deleting a document marks
+ * its docID in the tombstones, which are written to a new file that the
+ * next manifest names, so that a reader finds the segments and the
+ * deletions of one moment; lookups leave the deleted docIDs out. A
+ * changed page is indexed anew under a new docID, and its old docID
+ * deleted.
+ *
+ * So that there are never many segments to search, a writer merges
+ * them on a thread of its own, in tiers: a segment's tier is 0 if it is
+ * under 1 MB, and one more for each fourfold of that, and four
+ * neighbouring segments of the lowest tier that has four are merged
+ * into one, of the next tier up, more or less, leaving out the postings
+ * and table entries of deleted documents, and the words left with no
+ * postings; their tombstones then go too. Each document is so
+ * rewritten about once per tier, and the manifest lists a few segments
+ * per tier, however many increments built the index. A merged
+ * segment's files are removed once the manifest no longer lists them;
+ * a reader that opened the manifest before, and then finds a file gone,
+ * opens the new manifest instead.
+ *
+ * There is one writer at a time, which holds <indexFilename>.lock.
+ *
+ * Charlie Childress, February 2022, cs50
+ */
+
+#ifndef __SEGMENTS_H
+#define __SEGMENTS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "index.h"
+#include "docmeta.h"
+#include "postings.h"
+#include "tombstones.h"
+
+/**************** global types ****************/
+typedef struct segments segments_t;   // an open index, in one or more segments
+
+/**************** segments_open ****************/
+/* Parameters:
+ *  name of a manifest, or of an index file written by the indexer
+ *
+ * Open the index for reading: map every segment the manifest lists,
+ * and its document table. An index file that is not a manifest is
+ * opened as the one segment of all docIDs - mapped if binary, or else
+ * loaded - with indexFilename.meta as its table, if there is one.
+ *
+ * Return the index, or NULL if a segment (or the index file) could
+ * not be read
+ */
+segments_t* segments_open(const char* indexFilename);
+
+/**************** segments_lookup ****************/
+/* Return new postings of the word over every segment, but for deleted
+ * docIDs, which the caller must postings_delete; NULL if either
+ * parameter is NULL or out of memory
+ */
+postings_t* segments_lookup(segments_t* segs, const char* word);
+
+/**************** segments_meta ****************/
+/* Return the document table of the segment holding the docID, which
+ * belongs to the segments (do not delete it), or NULL if no segment
+ * holds the docID or its segment has no table
+ */
+docmeta_t* segments_meta(segments_t* segs, const int docID);
+
+/**************** segments_count ****************/
+/* Return the number of segments, or 0 if segs is NULL
+ */
+int segments_count(segments_t* segs);
+
+/**************** segments_close ****************/
+/* Unmap and free an index opened with segments_open. NULL is ignored.
+ */
+void segments_close(segments_t* segs);
+
+/**************** segments_lock ****************/
+/* Parameters:
+ *  name of a manifest, which need not exist yet, to add to
+ *
+ * Take the writer's lock, waiting for any other writer to finish, and
+ * read the manifest; a missing or empty file is written as a manifest
+ * of no segments. Starts merging segments in the background.
+ *
+ * Return the segments to add to, or NULL (printing an error to
+ * stderr) if the file is something other than a manifest, or on any
+ * other error
+ */
+segments_t* segments_lock(const char* manifest);
+
+/**************** segments_next ****************/
+/* Return the first docID past every segment: where the next segment
+ * starts. 1 for no segments.
+ */
+int segments_next(segments_t* segs);
+
+/**************** segments_add ****************/
+/* Parameters:
+ *  segments from segments_lock, an index and document table of the
+ *  docIDs from first up to end, where first is segments_next
+ *
+ * Write them as a new segment, and a manifest that lists it
+ *
+ * Return true if they were written, false on bad parameters or if
+ * anything could not be written (leaving the manifest as it was)
+ */
+bool segments_add(segments_t* segs, index_t* index, docmeta_t* meta, const int first, const int end);
+
+/**************** segments_crawl ****************/
+/* Return the identity of the crawl whose pages the segments hold, as
+ * the manifest records it, or NULL if it records none
+ */
+const char* segments_crawl(segments_t* segs);
+
+/**************** segments_setCrawl ****************/
+/* Parameters:
+ *  segments from segments_lock, and the identity of the crawl of the
+ *  pages being added (see pagedir_getCrawlID)
+ *
+ * Record the identity in the next manifest written
+ *
+ * Return true if it is recorded, false on bad parameters (an identity
+ * must be one word) or out of memory
+ */
+bool segments_setCrawl(segments_t* segs, const char* crawl);
+
+/**************** segments_remove ****************/
+/* Parameters:
+ *  segments from segments_lock, and a docID of one of its segments
+ *
+ * Mark the docID deleted; the next manifest written, by segments_add,
+ * a merge, or at the latest segments_unlock, records it
+ *
+ * Return true if it is marked, false on bad parameters or out of memory
+ */
+bool segments_remove(segments_t* segs, const int docID);
+
+/**************** segments_findURL ****************/
+/* Parameters:
+ *  segments from segments_lock, and a URL
+ *
+ * Look the URL up in the document tables of the segments: the first
+ * call (after segments_lock, or after segments_add) reads them all,
+ * and the rest are a hash lookup
+ *
+ * Return the latest docID of the URL that is not deleted, or 0 if
+ * there is none, or on bad parameters or out of memory
+ */
+int segments_findURL(segments_t* segs, const char* url);
+
+/**************** segments_unlock ****************/
+/* Finish any merges the segments need, write the manifest if there
+ * are deletions it does not have yet (even if a merge failed), release
+ * the writer's lock, and free the segments. NULL is ignored.
+ *
+ * Return true unless a merge or manifest could not be written; the
+ * manifest on disk lists whole segments either way
+ */
+bool segments_unlock(segments_t* segs);
+
+#endif // __SEGMENTS_H
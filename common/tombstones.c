@@ -0,0 +1,187 @@
+/*
+ * tombstones.c - CS50 tombstones module
+ *
+ * see tombstones.h for more information.
+ *
+ * Charlie Childress, cs50, February 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "tombstones.h"
+#include "postings.h"
+
+/**************** file-local global variables ****************/
+static const char MAGIC[8] = { 'T', 'S', 'E', 'D', 'E', 'A', 'D', '1' };
+
+/**************** local types ****************/
+typedef struct header {
+  char magic[8];              // MAGIC
+  uint64_t numBytes;          // of the bitmap that follows
+} header_t;
+
+/**************** global types ****************/
+typedef struct tombstones {
+  uint8_t* bits;              // docID d is bit d % 8 of bits[d / 8]
+  size_t numBytes;
+  int count;                  // of the bits set
+} tombstones_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool isLive(void* arg, const int docID);
+
+/**************** tombstones_new() ****************/
+/* see tombstones.h for description */
+tombstones_t* tombstones_new(void) {
+  return calloc(1, sizeof(tombstones_t));
+}
+
+/**************** tombstones_copy() ****************/
+/* see tombstones.h for description */
+tombstones_t* tombstones_copy(const tombstones_t* tombstones) {
+  tombstones_t* copy = tombstones ? tombstones_new() : NULL;
+  if (copy != NULL && tombstones->numBytes > 0) {
+    if ((copy->bits = malloc(tombstones->numBytes)) == NULL) {
+      free(copy);
+      return NULL;
+    }
+    memcpy(copy->bits, tombstones->bits, tombstones->numBytes);
+    copy->numBytes = tombstones->numBytes;
+    copy->count = tombstones->count;
+  }
+  return copy;
+}
+
+/**************** tombstones_add() ****************/
+/* see tombstones.h for description */
+bool tombstones_add(tombstones_t* tombstones, const int docID) {
+  if (tombstones == NULL || docID < 1) {
+    return false;
+  }
+  size_t byte = docID / 8;
+  if (byte >= tombstones->numBytes) {
+    size_t numBytes = tombstones->numBytes ? tombstones->numBytes * 2 : 64;
+    while (numBytes <= byte) {
+      numBytes *= 2;
+    }
+    uint8_t* bits = realloc(tombstones->bits, numBytes);
+    if (bits == NULL) {
+      return false;
+    }
+    memset(bits + tombstones->numBytes, 0, numBytes - tombstones->numBytes);
+    tombstones->bits = bits;
+    tombstones->numBytes = numBytes;
+  }
+  uint8_t bit = 1 << (docID % 8);
+  if ((tombstones->bits[byte] & bit) == 0) {
+    tombstones->bits[byte] |= bit;
+    tombstones->count++;
+  }
+  return true;
+}
+
+/**************** tombstones_remove() ****************/
+/* see tombstones.h for description */
+void tombstones_remove(tombstones_t* tombstones, const int docID) {
+  if (tombstones_has(tombstones, docID)) {
+    tombstones->bits[docID / 8] &= ~(1 << (docID % 8));
+    tombstones->count--;
+  }
+}
+
+/**************** tombstones_has() ****************/
+/* see tombstones.h for description */
+bool tombstones_has(const tombstones_t* tombstones, const int docID) {
+  return tombstones != NULL && docID >= 0 && (size_t) docID / 8 < tombstones->numBytes
+      && (tombstones->bits[docID / 8] & (1 << (docID % 8))) != 0;
+}
+
+/**************** tombstones_count() ****************/
+/* see tombstones.h for description */
+int tombstones_count(const tombstones_t* tombstones) {
+  return tombstones ? tombstones->count : 0;
+}
+
+/**************** tombstones_filter() ****************/
+/* see tombstones.h for description */
+void tombstones_filter(const tombstones_t* tombstones, postings_t* postings) {
+  if (tombstones_count(tombstones) > 0) {
+    postings_retain(postings, (void*) tombstones, isLive);
+  }
+}
+
+/**************** tombstones_write() ****************/
+/* see tombstones.h for description */
+bool tombstones_write(const tombstones_t* tombstones, const char* filename) {
+  if (tombstones == NULL || filename == NULL) {
+    return false;
+  }
+  FILE* fp = fopen(filename, "w");
+  if (fp == NULL) {
+    return false;
+  }
+  // the bytes past the last marked docID are all 0, and need not be kept
+  size_t numBytes = tombstones->numBytes;
+  while (numBytes > 0 && tombstones->bits[numBytes - 1] == 0) {
+    numBytes--;
+  }
+  header_t header;
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.numBytes = numBytes;
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+         && fwrite(tombstones->bits, 1, numBytes, fp) == numBytes;
+  return fclose(fp) == 0 && ok;
+}
+
+/**************** tombstones_load() ****************/
+/* see tombstones.h for description */
+tombstones_t* tombstones_load(const char* filename) {
+  FILE* fp = filename ? fopen(filename, "r") : NULL;
+  if (fp == NULL) {
+    return NULL;
+  }
+  header_t header;
+  tombstones_t* tombstones = NULL;
+  if (fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+      && header.numBytes <= (uint64_t) INT32_MAX / 8 + 1
+      && (tombstones = tombstones_new()) != NULL
+      && (header.numBytes == 0 || (tombstones->bits = malloc(header.numBytes)) != NULL)) {
+    tombstones->numBytes = header.numBytes;
+    if (fread(tombstones->bits, 1, header.numBytes, fp) != header.numBytes || getc(fp) != EOF) {
+      tombstones_delete(tombstones);
+      tombstones = NULL;
+    }
+  } else {
+    tombstones_delete(tombstones);
+    tombstones = NULL;
+  }
+  fclose(fp);
+
+  for (size_t i = 0; tombstones != NULL && i < tombstones->numBytes; i++) {
+    for (uint8_t bits = tombstones->bits[i]; bits != 0; bits &= bits - 1) {
+      tombstones->count++;
+    }
+  }
+  return tombstones;
+}
+
+/**************** tombstones_delete() ****************/
+/* see tombstones.h for description */
+void tombstones_delete(tombstones_t* tombstones) {
+  if (tombstones != NULL) {
+    free(tombstones->bits);
+    free(tombstones);
+  }
+}
+
+/**************** isLive() ****************/
+/* postings_retain's keepfunc: true if the docID is not in the
+ * tombstones, which arg is.
+ */
+static bool isLive(void* arg, const int docID) {
+  return !tombstones_has(arg, docID);
+}
@@ -0,0 +1,96 @@
+/*
+ * tombstones.h - header file for CS50 tombstones module
+ *
+ * A tombstones is the set of deleted docIDs of an index, as a bitmap
+ * with one bit per docID: a document that was removed, or replaced by
+ * a newer version of its page under a new docID, stays in the index's
+ * files (which never change once written, see segments.h) until they
+ * are merged, and its tombstone keeps it out of query results until
+ * then. Marking and testing a docID are a bit operation each.
+ *
+ * The file is, in the machine's byte order: the 8 bytes "TSEDEAD1",
+ * the number of bytes of the bitmap, as a 64-bit integer, then the
+ * bitmap, in which docID d is bit d % 8 of byte d / 8.
+ *
+ * Charlie Childress, February 2022, cs50
+ */
+
+#ifndef __TOMBSTONES_H
+#define __TOMBSTONES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "postings.h"
+
+/**************** global types ****************/
+typedef struct tombstones tombstones_t;
+
+/**************** tombstones_new ****************/
+/* Return a new, empty tombstones, or NULL if out of memory
+ */
+tombstones_t* tombstones_new(void);
+
+/**************** tombstones_copy ****************/
+/* Return a new tombstones of the same docIDs, or NULL if tombstones
+ * is NULL or out of memory
+ */
+tombstones_t* tombstones_copy(const tombstones_t* tombstones);
+
+/**************** tombstones_add ****************/
+/* Mark the docID (>= 1) deleted.
+ *
+ * Return true if it is marked, false on bad parameters or out of
+ * memory
+ */
+bool tombstones_add(tombstones_t* tombstones, const int docID);
+
+/**************** tombstones_remove ****************/
+/* Unmark the docID, e.g., once no file of the index holds it any
+ * more. A NULL tombstones, or a docID not marked, is ignored.
+ */
+void tombstones_remove(tombstones_t* tombstones, const int docID);
+
+/**************** tombstones_has ****************/
+/* Return true if the docID is marked deleted; false if not, or if
+ * tombstones is NULL
+ */
+bool tombstones_has(const tombstones_t* tombstones, const int docID);
+
+/**************** tombstones_count ****************/
+/* Return the number of docIDs marked deleted, or 0 if tombstones is
+ * NULL
+ */
+int tombstones_count(const tombstones_t* tombstones);
+
+/**************** tombstones_filter ****************/
+/* Drop the pairs of deleted docIDs from the postings. A NULL
+ * tombstones or postings is ignored.
+ */
+void tombstones_filter(const tombstones_t* tombstones, postings_t* postings);
+
+/**************** tombstones_write ****************/
+/* Parameters:
+ *  tombstones, and the name of the file to write it to
+ *
+ * Write the bitmap only up to its last marked docID.
+ *
+ * Return true if the file was written, false on any error
+ */
+bool tombstones_write(const tombstones_t* tombstones, const char* filename);
+
+/**************** tombstones_load ****************/
+/* Parameters:
+ *  name of a file written by tombstones_write
+ *
+ * Return the tombstones it holds, or NULL if the file does not exist,
+ * is not a tombstones file, or out of memory
+ */
+tombstones_t* tombstones_load(const char* filename);
+
+/**************** tombstones_delete ****************/
+/* Free the tombstones. NULL is ignored.
+ */
+void tombstones_delete(tombstones_t* tombstones);
+
+#endif // __TOMBSTONES_H
@@ -0,0 +1,180 @@
+/*
+ * urlqueue.c - CS50 urlqueue module
+ *
+ * see urlqueue.h for more information.
+ *
+ * Charlie Childress, cs50, February 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "urlqueue.h"
+#include "webpage.h"
+
+/**************** local types ****************/
+typedef struct urlnode {
+  webpage_t* page;            // the queued page
+  struct urlnode* next;       // next page in the same bucket
+} urlnode_t;
+
+// the pages of one depth and score, oldest first
+typedef struct bucket {
+  urlnode_t* head;
+  urlnode_t* tail;
+} bucket_t;
+
+/**************** global types ****************/
+typedef struct urlqueue {
+  int (*scorefunc)(const webpage_t* page);  // scores pages, or NULL
+  bucket_t* buckets;          // URLQUEUE_SCORES buckets per depth, best score first
+  int numDepths;              // depths the buckets cover so far
+  int first;                  // no bucket before this one has any pages
+  int count;                  // pages queued
+  urlnode_t* spare;           // nodes freed by pop, for push to reuse
+} urlqueue_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool growDepths(urlqueue_t* queue, const int depth);
+
+/**************** urlqueue_new() ****************/
+/* see urlqueue.h for description */
+urlqueue_t* urlqueue_new(int (*scorefunc)(const webpage_t* page)) {
+  urlqueue_t* queue = calloc(1, sizeof(urlqueue_t));
+  if (queue == NULL) {
+    return NULL;
+  }
+  queue->scorefunc = scorefunc;
+  return queue;
+}
+
+/**************** urlqueue_push() ****************/
+/* see urlqueue.h for description */
+bool urlqueue_push(urlqueue_t* queue, webpage_t* page) {
+  if (queue == NULL || page == NULL) {
+    return false;
+  }
+  int depth = webpage_getDepth(page);
+  if (depth >= queue->numDepths && !growDepths(queue, depth)) {
+    return false;
+  }
+  int score = queue->scorefunc ? (*queue->scorefunc)(page) : 0;
+  if (score < 0) {
+    score = 0;
+  } else if (score >= URLQUEUE_SCORES) {
+    score = URLQUEUE_SCORES - 1;
+  }
+
+  urlnode_t* node = queue->spare;
+  if (node != NULL) {
+    queue->spare = node->next;
+  } else if ((node = malloc(sizeof(urlnode_t))) == NULL) {
+    return false;
+  }
+  node->page = page;
+  node->next = NULL;
+
+  // append to the bucket for its depth and score
+  int index = depth * URLQUEUE_SCORES + (URLQUEUE_SCORES - 1 - score);
+  bucket_t* bucket = &queue->buckets[index];
+  if (bucket->tail == NULL) {
+    bucket->head = node;
+  } else {
+    bucket->tail->next = node;
+  }
+  bucket->tail = node;
+  if (index < queue->first) {
+    queue->first = index;
+  }
+  queue->count++;
+  return true;
+}
+
+/**************** urlqueue_pop() ****************/
+/* see urlqueue.h for description */
+webpage_t* urlqueue_pop(urlqueue_t* queue) {
+  if (queue == NULL || queue->count == 0) {
+    return NULL;
+  }
+  // skip the empty buckets; 'first' only moves back when a page is pushed before it
+  while (queue->buckets[queue->first].head == NULL) {
+    queue->first++;
+  }
+  bucket_t* bucket = &queue->buckets[queue->first];
+  urlnode_t* node = bucket->head;
+  bucket->head = node->next;
+  if (bucket->head == NULL) {
+    bucket->tail = NULL;
+  }
+  webpage_t* page = node->page;
+  node->next = queue->spare;
+  queue->spare = node;
+  queue->count--;
+  return page;
+}
+
+/**************** urlqueue_count() ****************/
+/* see urlqueue.h for description */
+int urlqueue_count(urlqueue_t* queue) {
+  return queue ? queue->count : 0;
+}
+
+/**************** urlqueue_iterate() ****************/
+/* see urlqueue.h for description */
+void urlqueue_iterate(urlqueue_t* queue, void* arg, void (*itemfunc)(void* arg, webpage_t* page)) {
+  if (queue != NULL && itemfunc != NULL) {
+    for (int i = queue->first; i < queue->numDepths * URLQUEUE_SCORES; i++) {
+      for (urlnode_t* node = queue->buckets[i].head; node != NULL; node = node->next) {
+        (*itemfunc)(arg, node->page);
+      }
+    }
+  }
+}
+
+/**************** urlqueue_delete() ****************/
+/* see urlqueue.h for description */
+void urlqueue_delete(urlqueue_t* queue, void (*itemdelete)(void* item)) {
+  if (queue != NULL) {
+    for (int i = 0; i < queue->numDepths * URLQUEUE_SCORES; i++) {
+      urlnode_t* node = queue->buckets[i].head;
+      while (node != NULL) {
+        urlnode_t* next = node->next;
+        if (itemdelete != NULL) {
+          (*itemdelete)(node->page);
+        }
+        free(node);
+        node = next;
+      }
+    }
+    while (queue->spare != NULL) {
+      urlnode_t* next = queue->spare->next;
+      free(queue->spare);
+      queue->spare = next;
+    }
+    free(queue->buckets);
+    free(queue);
+  }
+}
+
+/**************** growDepths() ****************/
+/* Make room for buckets down to the given depth, at least doubling
+ * the depths covered so that growing is rare.
+ * Return false if out of memory.
+ */
+static bool growDepths(urlqueue_t* queue, const int depth) {
+  int numDepths = queue->numDepths ? queue->numDepths * 2 : 4;
+  while (numDepths <= depth) {
+    numDepths *= 2;
+  }
+  bucket_t* buckets = realloc(queue->buckets, numDepths * URLQUEUE_SCORES * sizeof(bucket_t));
+  if (buckets == NULL) {
+    return false;
+  }
+  memset(buckets + queue->numDepths * URLQUEUE_SCORES, 0,
+         (numDepths - queue->numDepths) * URLQUEUE_SCORES * sizeof(bucket_t));
+  queue->buckets = buckets;
+  queue->numDepths = numDepths;
+  return true;
+}
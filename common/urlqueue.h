@@ -0,0 +1,78 @@
+/*
+ * urlqueue.h - header file for CS50 urlqueue module
+ *
+ * A urlqueue holds pages waiting to be crawled and gives them back in
+ * priority order: shallowest depth first, and among pages of the same
+ * depth, highest score first, where the score comes from a function
+ * the caller plugs in; pages that tie come back in the order they went
+ * in. The crawl is thus breadth-first, reaching the shallow pages, and
+ * the most valuable of them, before it spends anything deeper.
+ *
+ * Pages sit in one FIFO bucket per (depth, score) pair, so both push
+ * and pop take constant (amortized) time, whatever the number of pages.
+ *
+ * The urlqueue does no locking of its own.
+ *
+ * Charlie Childress, February 2022, cs50
+ */
+
+#ifndef __URLQUEUE_H
+#define __URLQUEUE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "webpage.h"
+
+/**************** global constants ****************/
+#define URLQUEUE_SCORES 8     // scores run from 0 (least valuable) to URLQUEUE_SCORES-1
+
+/**************** global types ****************/
+typedef struct urlqueue urlqueue_t;
+
+/**************** urlqueue_new ****************/
+/* Parameters:
+ *  scorefunc, which scores a page from 0 to URLQUEUE_SCORES-1 (scores
+ *  out of range are clamped), or NULL to order pages by depth alone
+ *
+ * Return the new, empty urlqueue, or NULL if there are any errors
+ */
+urlqueue_t* urlqueue_new(int (*scorefunc)(const webpage_t* page));
+
+/**************** urlqueue_push ****************/
+/* Parameters:
+ *  urlqueue, and a webpage_t* to crawl later
+ *
+ * Queue the page by its depth and score. The urlqueue owns the page
+ * until urlqueue_pop returns it.
+ *
+ * Return true if the page was queued, false on bad parameters or
+ * out of memory
+ */
+bool urlqueue_push(urlqueue_t* queue, webpage_t* page);
+
+/**************** urlqueue_pop ****************/
+/* Return the page of least depth and then highest score that has been
+ * queued longest, which the caller owns again, or NULL if the urlqueue
+ * is empty or NULL
+ */
+webpage_t* urlqueue_pop(urlqueue_t* queue);
+
+/**************** urlqueue_count ****************/
+/* Return the number of pages queued, or 0 if queue is NULL
+ */
+int urlqueue_count(urlqueue_t* queue);
+
+/**************** urlqueue_iterate ****************/
+/* Call itemfunc(arg, page) on every page queued, in no particular
+ * order. NULL queue or itemfunc is ignored.
+ */
+void urlqueue_iterate(urlqueue_t* queue, void* arg, void (*itemfunc)(void* arg, webpage_t* page));
+
+/**************** urlqueue_delete ****************/
+/* Free the urlqueue, calling itemdelete (if not NULL) on every page
+ * still queued. NULL is ignored.
+ */
+void urlqueue_delete(urlqueue_t* queue, void (*itemdelete)(void* item));
+
+#endif // __URLQUEUE_H
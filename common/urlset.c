@@ -0,0 +1,225 @@
+/*
+ * urlset.c - CS50 urlset module
+ *
+ * see urlset.h for more information.
+ *
+ * Charlie Childress, cs50, February 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "urlset.h"
+
+/**************** file-local global variables ****************/
+static const size_t MIN_SLOTS = 16;     // smallest table, a power of two
+static const int SLOTS_PER_WORD = 4;    // table slots per 64-bit Bloom filter word
+
+/**************** global types ****************/
+typedef struct urlset {
+  uint64_t* slots;            // fingerprints, 0 in an empty slot; linear probing
+  size_t numSlots;            // a power of two, at least 4/3 of count
+  size_t count;               // fingerprints in the table
+  uint64_t* bloom;            // numSlots/SLOTS_PER_WORD words, or NULL for no filter
+} urlset_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool resize(urlset_t* set, const size_t numSlots);
+static bool lookup(urlset_t* set, const uint64_t fingerprint, size_t* slot);
+static uint64_t bloomBits(const uint64_t fingerprint);
+static size_t bloomWord(urlset_t* set, const uint64_t fingerprint);
+
+/**************** urlset_new() ****************/
+/* see urlset.h for description */
+urlset_t* urlset_new(const int expected, const bool bloom) {
+  urlset_t* set = calloc(1, sizeof(urlset_t));
+  if (set == NULL) {
+    return NULL;
+  }
+  size_t numSlots = MIN_SLOTS;
+  while (expected > 0 && numSlots * 3 < (size_t) expected * 4) {
+    numSlots *= 2;
+  }
+  if (bloom) {
+    set->bloom = malloc(sizeof(uint64_t));    // a placeholder for resize to replace
+  }
+  if ((bloom && set->bloom == NULL) || !resize(set, numSlots)) {
+    urlset_delete(set);
+    return NULL;
+  }
+  return set;
+}
+
+/**************** urlset_fingerprint() ****************/
+/* see urlset.h for description */
+uint64_t urlset_fingerprint(const char* url) {
+  if (url == NULL) {
+    return 0;
+  }
+  // FNV-1a over the bytes...
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const unsigned char* c = (const unsigned char*) url; *c != '\0'; c++) {
+    hash = (hash ^ *c) * 0x100000001b3ULL;
+  }
+  // ...then a finalizer, so that every bit of the result depends on every bit of the hash
+  hash ^= hash >> 30;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94d049bb133111ebULL;
+  hash ^= hash >> 31;
+  return hash != 0 ? hash : 1;    // 0 marks an empty slot
+}
+
+/**************** urlset_insert() ****************/
+/* see urlset.h for description */
+bool urlset_insert(urlset_t* set, const char* url) {
+  return url != NULL && urlset_insertFingerprint(set, urlset_fingerprint(url));
+}
+
+/**************** urlset_insertFingerprint() ****************/
+/* see urlset.h for description */
+bool urlset_insertFingerprint(urlset_t* set, const uint64_t fingerprint) {
+  if (set == NULL || fingerprint == 0) {
+    return false;
+  }
+  size_t slot;
+  if (lookup(set, fingerprint, &slot)) {
+    return false;
+  }
+  // keep the table at most three-quarters full, so probes stay short
+  if ((set->count + 1) * 4 > set->numSlots * 3) {
+    if (!resize(set, set->numSlots * 2)) {
+      return false;
+    }
+    lookup(set, fingerprint, &slot);
+  }
+  set->slots[slot] = fingerprint;
+  set->count++;
+  if (set->bloom != NULL) {
+    set->bloom[bloomWord(set, fingerprint)] |= bloomBits(fingerprint);
+  }
+  return true;
+}
+
+/**************** urlset_contains() ****************/
+/* see urlset.h for description */
+bool urlset_contains(urlset_t* set, const char* url) {
+  return set != NULL && url != NULL && lookup(set, urlset_fingerprint(url), NULL);
+}
+
+/**************** urlset_count() ****************/
+/* see urlset.h for description */
+int urlset_count(urlset_t* set) {
+  return set ? (int) set->count : 0;
+}
+
+/**************** urlset_iterate() ****************/
+/* see urlset.h for description */
+void urlset_iterate(urlset_t* set, void* arg, void (*itemfunc)(void* arg, const uint64_t fingerprint)) {
+  if (set != NULL && itemfunc != NULL) {
+    for (size_t i = 0; i < set->numSlots; i++) {
+      if (set->slots[i] != 0) {
+        (*itemfunc)(arg, set->slots[i]);
+      }
+    }
+  }
+}
+
+/**************** urlset_delete() ****************/
+/* see urlset.h for description */
+void urlset_delete(urlset_t* set) {
+  if (set != NULL) {
+    free(set->slots);
+    free(set->bloom);
+    free(set);
+  }
+}
+
+/**************** resize() ****************/
+/* Move every fingerprint into a new table of numSlots (a power of
+ * two), rebuilding the Bloom filter, if any, to match.
+ * Return false if out of memory, leaving the set as it was.
+ */
+static bool resize(urlset_t* set, const size_t numSlots) {
+  uint64_t* slots = calloc(numSlots, sizeof(uint64_t));
+  uint64_t* bloom = set->bloom ? calloc(numSlots / SLOTS_PER_WORD, sizeof(uint64_t)) : NULL;
+  if (slots == NULL || (set->bloom != NULL && bloom == NULL)) {
+    free(slots);
+    free(bloom);
+    return false;
+  }
+  uint64_t* oldSlots = set->slots;
+  size_t oldNumSlots = set->numSlots;
+  set->slots = slots;
+  set->numSlots = numSlots;
+  if (bloom != NULL) {
+    free(set->bloom);
+    set->bloom = bloom;
+  }
+  for (size_t i = 0; i < oldNumSlots; i++) {
+    uint64_t fingerprint = oldSlots[i];
+    if (fingerprint != 0) {
+      size_t slot;
+      lookup(set, fingerprint, &slot);
+      slots[slot] = fingerprint;
+      if (bloom != NULL) {
+        bloom[bloomWord(set, fingerprint)] |= bloomBits(fingerprint);
+      }
+    }
+  }
+  free(oldSlots);
+  return true;
+}
+
+/**************** lookup() ****************/
+/* Probe for the fingerprint, from the slot its low bits pick.
+ * Return true if it is in the set; else false, with *slot (if slot is
+ * not NULL) set to the empty slot where it would go.
+ */
+static bool lookup(urlset_t* set, const uint64_t fingerprint, size_t* slot) {
+  // the filter has the bits of every fingerprint in the set, so one that lacks a bit is new
+  bool maybe = true;
+  if (set->bloom != NULL) {
+    uint64_t bits = bloomBits(fingerprint);
+    maybe = (set->bloom[bloomWord(set, fingerprint)] & bits) == bits;
+    if (!maybe && slot == NULL) {
+      return false;
+    }
+  }
+  size_t mask = set->numSlots - 1;
+  size_t i = fingerprint & mask;
+  while (set->slots[i] != 0) {
+    if (maybe && set->slots[i] == fingerprint) {
+      if (slot != NULL) {
+        *slot = i;
+      }
+      return true;
+    }
+    i = (i + 1) & mask;
+  }
+  if (slot != NULL) {
+    *slot = i;
+  }
+  return false;
+}
+
+/**************** bloomBits() ****************/
+/* Return the three bits, within one filter word, that stand for the
+ * fingerprint; they come from its high bits, which the table does
+ * not use to pick a slot.
+ */
+static uint64_t bloomBits(const uint64_t fingerprint) {
+  return (1ULL << ((fingerprint >> 46) & 63))
+       | (1ULL << ((fingerprint >> 52) & 63))
+       | (1ULL << ((fingerprint >> 58) & 63));
+}
+
+/**************** bloomWord() ****************/
+/* Return the index of the filter word that holds the fingerprint's bits.
+ */
+static size_t bloomWord(urlset_t* set, const uint64_t fingerprint) {
+  return (fingerprint >> 20) & (set->numSlots / SLOTS_PER_WORD - 1);
+}
@@ -0,0 +1,82 @@
+/*
+ * urlset.h - header file for CS50 urlset module
+ *
+ * A urlset is the set of URLs a crawl has seen. It keeps no URL
+ * strings, only a 64-bit fingerprint (hash) of each, in one
+ * open-addressed table that doubles as it fills, so that a URL costs
+ * a few bytes and finding or adding one takes constant time however
+ * many there are. Two URLs with the same fingerprint are taken to be
+ * the same; over millions of URLs the odds of that are negligible.
+ *
+ * Optionally, a Bloom filter of one bit-word per four slots sits in
+ * front of the table, answering most lookups of new URLs without
+ * touching the table.
+ *
+ * The urlset does no locking of its own.
+ *
+ * Charlie Childress, February 2022, cs50
+ */
+
+#ifndef __URLSET_H
+#define __URLSET_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************** global types ****************/
+typedef struct urlset urlset_t;
+
+/**************** urlset_new ****************/
+/* Parameters:
+ *  expected number of URLs, to size the table (it grows past that as
+ *  needed), and whether to put a Bloom filter in front of the table
+ *
+ * Return the new, empty urlset, or NULL if there are any errors
+ */
+urlset_t* urlset_new(const int expected, const bool bloom);
+
+/**************** urlset_fingerprint ****************/
+/* Return the 64-bit fingerprint of the url, never 0; NULL gives 0
+ */
+uint64_t urlset_fingerprint(const char* url);
+
+/**************** urlset_insert ****************/
+/* Parameters:
+ *  urlset, and a url to add to it
+ *
+ * Return true if the url was not in the set, and now is
+ * Return false if it was already there, on bad parameters, or out
+ * of memory
+ */
+bool urlset_insert(urlset_t* set, const char* url);
+
+/**************** urlset_insertFingerprint ****************/
+/* As urlset_insert, for a fingerprint from urlset_fingerprint or
+ * urlset_iterate, e.g., one read back from a checkpoint.
+ */
+bool urlset_insertFingerprint(urlset_t* set, const uint64_t fingerprint);
+
+/**************** urlset_contains ****************/
+/* Return true if the url is in the set, false if not or set is NULL
+ */
+bool urlset_contains(urlset_t* set, const char* url);
+
+/**************** urlset_count ****************/
+/* Return the number of URLs in the set, or 0 if set is NULL
+ */
+int urlset_count(urlset_t* set);
+
+/**************** urlset_iterate ****************/
+/* Call itemfunc(arg, fingerprint) on the fingerprint of every URL in
+ * the set, in no particular order. NULL set or itemfunc is ignored.
+ */
+void urlset_iterate(urlset_t* set, void* arg, void (*itemfunc)(void* arg, const uint64_t fingerprint));
+
+/**************** urlset_delete ****************/
+/* Free the urlset. NULL is ignored.
+ */
+void urlset_delete(urlset_t* set);
+
+#endif // __URLSET_H
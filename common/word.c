@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include "word.h"
 
 /**************** normalizeWord ****************/
 /* see word.h for documentation */
@@ -19,10 +20,24 @@ char* normalizeWord(char* word) {
     return NULL;    // if it is, cannot normalize it, return NULL
   }
 
-  // go through each index of the char* and change it to lowercase
-  for(int i = 0; i < strlen(word); i++) {
-    word[i] = tolower(word[i]);   // call the tolower() method to covert each letter
+  // go through each index of the char* and change it to lowercase, up to the '\0'
+  for (char* c = word; *c != '\0'; c++) {
+    *c = tolower((unsigned char) *c);   // call the tolower() method to covert each letter
   }
 
   return word;  // return the normalized word
+}
+
+/**************** normalizeSpan ****************/
+/* see word.h for documentation */
+char* normalizeSpan(const char* word, const size_t len, char* buffer) {
+  if (word == NULL || buffer == NULL) {
+    return NULL;
+  }
+  // copy and lowercase in the one pass
+  for (size_t i = 0; i < len; i++) {
+    buffer[i] = tolower((unsigned char) word[i]);
+  }
+  buffer[len] = '\0';
+  return buffer;
 }
\ No newline at end of file
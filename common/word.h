@@ -22,4 +22,14 @@
  */
 char* normalizeWord(char* word);
 
+/**************** normalizeSpan ****************/
+/* 
+ * Normalizes the len characters at word, which need
+ * not be null-terminated (e.g., a span found by
+ * webpage_getNextSpan), into buffer, which must have
+ * room for len+1 characters, null-terminating it.
+ * Returns buffer, or NULL if word or buffer is NULL
+ */
+char* normalizeSpan(const char* word, const size_t len, char* buffer);
+
 #endif // __WORD_H
\ No newline at end of file
@@ -5,6 +5,17 @@
  * recursively, limiting its exploration to a given "depth".
  * usage:
  *   3 command-line arguments for the seedURL, pageDirectory, and maxDepth
+ *   optionally followed by
+ *     -j N  to save and scan pages with a pool of N worker threads
+ *     -c N  to keep up to N fetches in flight (default: as many as workers)
+ *     -d MS to start fetches from any one host at least MS milliseconds apart (default: 1000)
+ *     --resume  to continue from the pageDirectory's last checkpoint
+ *     --max-pages N    to stop, with a checkpoint, once N pages are saved
+ *     --max-seconds S  to stop, with a checkpoint, once S seconds have passed
+ *     --legacy  to save each page to a file of its own, rather than packed into segments
+ *     --recrawl  to fetch every page already in the pageDirectory again, adding the new 
+ *       versions (and any new pages they lead to) to it under new docIDs, for indexer --append
+ *     --recrawl-list FILE  likewise, but to fetch again only the pages whose URLs FILE lists
  *
  * output:
  *   directory with webpage content from all webpages that are a given depth from the seedURL
@@ -14,21 +25,98 @@
  * Used pseudocode from cs50 webpage
  */
 
+#define _GNU_SOURCE       // pthread_rwlockattr_setkind_np
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
 #include "bag.h"
-#include "hashtable.h"
 #include "mem.h"
+#include "file.h"
 #include "webpage.h"
+#include "dnscache.h"
 #include "pagedir.h"
+#include "fetcher.h"
+#include "scheduler.h"
+#include "checkpoint.h"
+#include "urlqueue.h"
+#include "urlset.h"
 
 /**************** file-local global variables ****************/
-/* none */
+static const int MAX_THREADS = 64;    // upper bound on the -j argument
+static const int MAX_CONNS = 1024;    // upper bound on the -c argument
+static const int MAX_DELAY_MS = 60000;   // upper bound on the -d argument
+static const int CHECKPOINT_SECONDS = 10; // time between checkpoints
+static const int MAX_BUDGET = 1000000000; // upper bound on the --max-pages and --max-seconds arguments
 
 /**************** local types ****************/
-/* none */
+// the command-line options that follow the three required arguments
+typedef struct options {
+  int numThreads;             // -j: workers that save and scan pages
+  int numConns;               // -c: fetches kept in flight
+  long delayMs;               // -d: least time between fetch starts on one host
+  bool resume;                // --resume: continue from the last checkpoint
+  int maxPages;               // --max-pages: pages to save in this run, or 0 for no limit
+  int maxSeconds;             // --max-seconds: time to crawl in this run, or 0 for no limit
+  bool legacy;                // --legacy: one file per page, rather than packed segments
+  bool recrawl;               // --recrawl: fetch the pageDirectory's pages again, as new pages
+  char* recrawlList;          // --recrawl-list: the file of the URLs to fetch again, or NULL for all
+} options_t;
+
+// the pages still to be crawled, shared by the fetching thread and the workers;
+// the fetching thread takes pages from 'scheduler' as their hosts allow and,
+// once fetched, puts them in 'fetched' for a worker to save and scan; the crawl
+// is over when both are empty, nothing is in flight, and no worker is busy
+typedef struct frontier {
+  scheduler_t* scheduler;     // pages waiting to be fetched, queued by host
+  bag_t* fetched;             // fetched pages waiting to be saved and scanned
+  int numFetched;             // pages in fetched
+  webpage_t** claimed;        // pages taken from scheduler and not yet finished, for checkpoints
+  int numClaimed;             // pages in claimed
+  int maxClaimed;             // room in claimed
+  int busy;                   // workers currently saving and scanning a page
+  bool over;                  // set once the crawl is finished
+  pthread_mutex_t lock;       // protects all of the above
+  pthread_cond_t changed;     // signalled when fetched pages arrive or the crawl ends
+} frontier_t;
+
+// the set of URLs seen so far, safe to share between workers
+typedef struct seenset {
+  urlset_t* urls;             // fingerprints of the normalized URLs
+  pthread_mutex_t lock;       // protects urls
+} seenset_t;
+
+// everything the crawl needs
+typedef struct crawlstate {
+  frontier_t frontier;        // pages to crawl
+  seenset_t seen;             // pages seen
+  fetcher_t* fetcher;         // fetches pages, on the main thread only
+  char* seedURL;              // where the crawl started
+  char* pageDirectory;        // where to save pages
+  int maxDepth;               // how deep to crawl
+  int nextDocID;              // next unused docID, protected by docLock
+  pthread_mutex_t docLock;    // protects nextDocID
+  pthread_rwlock_t commitLock;  // shared while a page is finished, exclusive while checkpointing
+  bool stopping;              // set once the crawl is over, to stop the checkpoint writer
+  pthread_mutex_t stopLock;   // protects stopping
+  pthread_cond_t stop;        // signalled when stopping is set
+} crawlstate_t;
+
+// a page being scanned for URLs
+typedef struct scan {
+  crawlstate_t* state;        // the crawl to add URLs to
+  int depth;                  // depth of the page
+} scan_t;
+
+// what loading a checkpoint fills in
+typedef struct resumestate {
+  urlset_t* urls;             // the seen set
+  scheduler_t* scheduler;     // the pages still to be crawled
+} resumestate_t;
 
 /**************** global types ****************/
 /* none */
@@ -36,9 +124,35 @@
 /**************** function prototypes ****************/
 static void logr(const char *word, const int depth, const char *url);
 int main(const int argc, char* argv[]);
-static void parseArgs(const int argc, char* argv[], char** seedURL, char** pageDirectory, int* maxDepth);
-static void crawl(char* seedURL, char* pageDirectory, const int maxDepth);
-static void pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen);
+static void parseArgs(const int argc, char* argv[], char** seedURL, char** pageDirectory, int* maxDepth,
+                      const options_t* options);
+static void parseOptions(const int argc, char* argv[], options_t* options);
+static void crawl(char* seedURL, char* pageDirectory, const int maxDepth, const options_t* options);
+static bool fetchLoop(crawlstate_t* state, const options_t* options);
+static bool outOfBudget(const options_t* options, const int claimed, const long deadline);
+static int scorePage(const webpage_t* page);
+static void* crawlWorker(void* arg);
+static void processPage(crawlstate_t* state, webpage_t* page);
+static void pageScan(webpage_t* page, crawlstate_t* state);
+static void scanURL(void* arg, char* url);
+static void frontier_add(crawlstate_t* state, webpage_t* page);
+static webpage_t* frontier_takeUnfetched(frontier_t* frontier, long* waitMs);
+static void frontier_addFetched(frontier_t* frontier, webpage_t* page);
+static webpage_t* frontier_takeFetched(frontier_t* frontier);
+static void frontier_done(crawlstate_t* state);
+static bool frontier_isOver(frontier_t* frontier);
+static bool frontier_isIdle(frontier_t* frontier);
+static void frontier_release(frontier_t* frontier, webpage_t* page);
+static bool seenset_insert(seenset_t* seen, const char* url);
+static void* checkpointWriter(void* arg);
+static void writeCheckpoint(crawlstate_t* state);
+static void checkpointURL(void* arg, webpage_t* page);
+static void checkpointSeen(void* arg, const uint64_t fingerprint);
+static void resumeURL(void* arg, const char* url, const int depth);
+static void resumeSeen(void* arg, const uint64_t fingerprint);
+static bool recrawlLoad(char* pageDirectory, char* listFilename, urlset_t* urls, scheduler_t* scheduler,
+                        int* nextDocID);
+static long nowMs(void);
 
 /* *************************************************************************************************
  * code taken from Dartmouth cs50 webpage 
@@ -65,18 +179,21 @@ static void logr(const char *word, const int depth, const char *url) {
  * show error in the program
  */ 
 int main(const int argc, char* argv[]) {
-  // check argc to make sure the only arguments are seedURL, pageDirectory, and maxDepth
+  // check argc to make sure the only arguments are seedURL, pageDirectory, and maxDepth,
+  // optionally followed by options (parseOptions complains about anything else)
   if (argc < 4) {
     // too few arguments, print error message to stderr
     fprintf(stderr, "usage: %s [crawler]: too few arguments\n", argv[0]);
     exit(1);  // non-zero exit to represent unsuccessful exit status
-  } else if (argc == 4) {   // correct number of arguments
+  } else {
     char** seedURLPointer = &argv[1];
     char** pageDirectoryPointer = &argv[2];
     int* maxDepthPointer = (int*) argv[3];
 
     // parse the arguments to make sure they are correct
-    parseArgs(argc, argv, seedURLPointer, pageDirectoryPointer, maxDepthPointer);
+    options_t options;
+    parseOptions(argc, argv, &options);
+    parseArgs(argc, argv, seedURLPointer, pageDirectoryPointer, maxDepthPointer, &options);
 
     // if the arguments are correct, assign variables to their value and run them through crawler
     char* seedURL = argv[1];
@@ -84,25 +201,23 @@ int main(const int argc, char* argv[]) {
     int maxDepth;
     sscanf(argv[3], "%d", &maxDepth);
 
-    crawl(seedURL, pageDirectory, maxDepth);
-  } else {
-    // too many arguments
-    fprintf(stderr, "usage: %s [crawler]; too many arguments\n", argv[0]);
-    exit(2); // we continue to increase the exit number to better know where the error occurs
+    crawl(seedURL, pageDirectory, maxDepth, &options);
   }
   exit(0); //successful exit status
 }
 
 /* *************************************************************************************************
  * Takes int argc for the number of command-line arguments, char* argv[] as a list of the 
- * command-line arguments, a pointer to the seedURL, a pointer to the pageDirectory, and a pointer
- * to the maxDepth
+ * command-line arguments, a pointer to the seedURL, a pointer to the pageDirectory, a pointer
+ * to the maxDepth, and the options already parsed
  * 
- * Goes through each command-line argument to make sure they are of valid format
+ * Goes through each command-line argument to make sure they are of valid format, and initializes 
+ * the pageDirectory (in the layout it already has, when resuming)
  *
  * If an error occurs, free any memory, send an error message to stderr, and exit the program
  */ 
-static void parseArgs(const int argc, char* argv[], char** seedURL, char** pageDirectory, int* maxDepth) {
+static void parseArgs(const int argc, char* argv[], char** seedURL, char** pageDirectory, int* maxDepth,
+                      const options_t* options) {
   // first check the seedURL
   char* normalURL = normalizeURL(*seedURL); // normalize the seedURL
   // validate that it is an internal URL
@@ -118,7 +233,8 @@ static void parseArgs(const int argc, char* argv[], char** seedURL, char** pageD
     fprintf(stderr, "usage: %s [pageDirectory]; directory does not exist\n", argv[2]);
     exit(4);
   }
-  if (!pagedir_init(*pageDirectory)) {  // if unable to initialize, there is a problem with the pageDirectory, exit program
+  if (options->resume || options->recrawl ? !pagedir_validate(*pageDirectory)
+                                          : !pagedir_init(*pageDirectory, !options->legacy)) {  // if unable to initialize, there is a problem with the pageDirectory, exit program
     fprintf(stderr, "usage: %s [pageDirectory]; error in initializing directory\n", argv[2]);
     exit(5);
   }
@@ -141,92 +257,438 @@ static void parseArgs(const int argc, char* argv[], char** seedURL, char** pageD
 
 
 /* *************************************************************************************************
- * Takes the seedURL that we want to explore, pageDirectory that we want to insert to, and maxDepth
- * that is our max depth we can crawl
+ * Takes int argc for the number of command-line arguments, char* argv[] as a list of the 
+ * command-line arguments, and the options_t* to fill in
+ *
+ * Parses the options that follow the three required arguments: "-j N" for the number of worker 
+ * threads, "-c N" for the number of fetches in flight, "-d MS" for the least time between 
+ * fetch starts on any one host, "--resume" to continue from the last checkpoint, 
+ * "--max-pages N" and "--max-seconds S" to limit this run, "--legacy" to save pages one per file, 
+ * and "--recrawl" or "--recrawl-list FILE" to fetch the pages already saved again
+ *
+ * Prints an error message to stderr and exits if an option is unknown or malformed, or if there 
+ * is an argument that is not an option (too many arguments)
+ */ 
+static void parseOptions(const int argc, char* argv[], options_t* options) {
+  options->numThreads = 1;  // by default, crawl on a single thread
+  options->numConns = 0;    // by default, as many fetches as workers
+  options->delayMs = 1000;  // by default, one fetch per second per host, as webpage_fetch's sleep did
+  options->resume = false;  // by default, start a new crawl
+  options->maxPages = 0;    // by default, crawl until there is nothing left
+  options->maxSeconds = 0;
+  options->legacy = false;  // by default, pack pages into segments
+  options->recrawl = false; // by default, crawl from the seedURL
+  options->recrawlList = NULL;
+  for (int i = 4; i < argc; i += 2) {
+    int value;
+    char ignore;
+    if (argv[i][0] != '-') {
+      // too many arguments
+      fprintf(stderr, "usage: %s [crawler]; too many arguments\n", argv[0]);
+      exit(2); // we continue to increase the exit number to better know where the error occurs
+    } else if (strcmp(argv[i], "--resume") == 0) {
+      options->resume = true;
+      i--;    // an option without a value
+    } else if (strcmp(argv[i], "--legacy") == 0) {
+      options->legacy = true;
+      i--;    // an option without a value
+    } else if (strcmp(argv[i], "--recrawl") == 0) {
+      options->recrawl = true;
+      i--;    // an option without a value
+    } else if (i + 1 == argc) {
+      fprintf(stderr, "usage: %s [option]; option is missing its value\n", argv[i]);
+      exit(14);
+    } else if (strcmp(argv[i], "-j") == 0) {
+      if (sscanf(argv[i + 1], "%d%c", &value, &ignore) != 1 || value < 1 || value > MAX_THREADS) {
+        fprintf(stderr, "usage: %s [-j bounds [1, %d]]; improper number of threads\n", argv[i + 1], MAX_THREADS);
+        exit(15);
+      }
+      options->numThreads = value;
+    } else if (strcmp(argv[i], "-c") == 0) {
+      if (sscanf(argv[i + 1], "%d%c", &value, &ignore) != 1 || value < 1 || value > MAX_CONNS) {
+        fprintf(stderr, "usage: %s [-c bounds [1, %d]]; improper number of connections\n", argv[i + 1], MAX_CONNS);
+        exit(17);
+      }
+      options->numConns = value;
+    } else if (strcmp(argv[i], "-d") == 0) {
+      if (sscanf(argv[i + 1], "%d%c", &value, &ignore) != 1 || value < 0 || value > MAX_DELAY_MS) {
+        fprintf(stderr, "usage: %s [-d bounds [0, %d]]; improper delay\n", argv[i + 1], MAX_DELAY_MS);
+        exit(19);
+      }
+      options->delayMs = value;
+    } else if (strcmp(argv[i], "--max-pages") == 0) {
+      if (sscanf(argv[i + 1], "%d%c", &value, &ignore) != 1 || value < 1 || value > MAX_BUDGET) {
+        fprintf(stderr, "usage: %s [--max-pages bounds [1, %d]]; improper page budget\n", argv[i + 1], MAX_BUDGET);
+        exit(22);
+      }
+      options->maxPages = value;
+    } else if (strcmp(argv[i], "--max-seconds") == 0) {
+      if (sscanf(argv[i + 1], "%d%c", &value, &ignore) != 1 || value < 1 || value > MAX_BUDGET) {
+        fprintf(stderr, "usage: %s [--max-seconds bounds [1, %d]]; improper time budget\n", argv[i + 1], MAX_BUDGET);
+        exit(23);
+      }
+      options->maxSeconds = value;
+    } else if (strcmp(argv[i], "--recrawl-list") == 0) {
+      options->recrawl = true;
+      options->recrawlList = argv[i + 1];
+    } else {
+      fprintf(stderr, "usage: %s [option]; unknown option, expected -j N, -c N, -d MS, --resume, --max-pages N, --max-seconds S, --legacy, --recrawl, or --recrawl-list FILE\n", argv[i]);
+      exit(14);
+    }
+  }
+  if (options->recrawl && options->resume) {
+    fprintf(stderr, "usage: %s [--recrawl]; a recrawl starts anew, and cannot be resumed into\n", argv[2]);
+    exit(24);
+  }
+  if (options->numConns == 0) {
+    options->numConns = options->numThreads;
+  }
+}
+
+/* *************************************************************************************************
+ * Takes the seedURL that we want to explore, pageDirectory that we want to insert to, maxDepth
+ * that is our max depth we can crawl, and the options_t* for how many threads and connections, 
+ * how long to wait between fetches from one host, whether to resume from a checkpoint, and the 
+ * budget for this run
  *
- * Loops over pages to explore, until the list is exhausted
+ * Starts the checkpoint writer and the workers, if more than one was asked for, then fetches 
+ * pages on the calling thread until the list of pages to explore is exhausted, or the budget is; 
+ * in that case a last checkpoint lets a later run resume the crawl
  *
  * exits and frees memory if error occurs, otherwise return nothing
  */ 
-static void crawl(char* seedURL, char* pageDirectory, const int maxDepth) {
+static void crawl(char* seedURL, char* pageDirectory, const int maxDepth, const options_t* options) {
   webpage_t* webpage;
-  // allocate memory for the seedURL so that you can put it in the bag and hashtable
-  char* url = mem_malloc(strlen(seedURL)*sizeof(char) + 1);
-  strcpy(url, seedURL);
-  // the size of the slots is impossible to determine in advance, so we use 200
-  hashtable_t* ht = hashtable_new(200);
-  // check if hashtable is null, if it is: send an error message, free the memory, and exit
-  if (ht == NULL) {
-    fprintf(stderr, "error when creating hashtable\n");
-    mem_free(url);
-    hashtable_delete(ht, NULL);
+  crawlstate_t state;
+  // the seen set grows as needed; most URLs found are already in it, so a Bloom filter in front 
+  // of the table would seldom save a probe
+  urlset_t* urls = urlset_new(0, false);
+  // check if the seen set is null, if it is: send an error message, and exit
+  if (urls == NULL) {
+    fprintf(stderr, "error when creating seen set\n");
     exit(9);
-  } else {  // if it's not empty, try to insert the the seedURL into the hashtable
-      if (!hashtable_insert(ht, seedURL, "item")) { // check if there is an error in inserting
-      fprintf(stderr, "error when inserting seedURL into hashtable\n");
-      mem_free(url);
-      hashtable_delete(ht, NULL);
-      exit(10);
-    }
   }
 
-  bag_t* bag = bag_new();   // initialize new bag
-  if (bag == NULL) {
-    // check if hashtable is null, if it is: send an error message, free the memory, and exit
-    fprintf(stderr, "error when creating bag\n");
-    hashtable_delete(ht, NULL); // delete the hashtable
-    bag_delete(bag, NULL);    // delete the bag
+  scheduler_t* scheduler = scheduler_new(options->delayMs, scorePage);   // initialize new scheduler
+  bag_t* fetched = bag_new();
+  if (scheduler == NULL || fetched == NULL) {
+    // check if either is null, if it is: send an error message, free the memory, and exit
+    fprintf(stderr, "error when creating scheduler\n");
+    urlset_delete(urls);        // delete the seen set
+    scheduler_delete(scheduler, NULL);    // delete the scheduler
+    bag_delete(fetched, NULL);
     exit(11);
-  } else {  // if bag is not empty
+  }
+
+  state.nextDocID = 1;  // counter to produce unique id code
+  if (options->resume) {
+    // pick up the seen set, the pages still to crawl, and the docID counter where the checkpoint left them
+    resumestate_t resume = { urls, scheduler };
+    char* checkpointSeed;
+    int checkpointDepth;
+    if (!checkpoint_load(pageDirectory, &checkpointSeed, &checkpointDepth, &state.nextDocID, &resume, resumeURL, resumeSeen)) {
+      fprintf(stderr, "usage: %s [pageDirectory]; no checkpoint to resume from\n", pageDirectory);
+      urlset_delete(urls);
+      scheduler_delete(scheduler, webpage_delete);
+      bag_delete(fetched, NULL);
+      exit(20);
+    }
+    bool sameCrawl = strcmp(checkpointSeed, seedURL) == 0 && checkpointDepth == maxDepth;
+    free(checkpointSeed);
+    if (!sameCrawl) {
+      fprintf(stderr, "usage: %s [pageDirectory]; checkpoint is of a different seedURL or maxDepth\n", pageDirectory);
+      urlset_delete(urls);
+      scheduler_delete(scheduler, webpage_delete);
+      bag_delete(fetched, NULL);
+      exit(21);
+    }
+    // pages saved after the checkpoint will be crawled again, under new docIDs
+    pagedir_truncate(pageDirectory, state.nextDocID);
+  } else if (options->recrawl) {
+    // the pages fetched again, and the pages new to the crawl they lead to, go after those 
+    // already saved, whose URLs are all seen, so that no page is saved twice in one recrawl
+    if (!recrawlLoad(pageDirectory, options->recrawlList, urls, scheduler, &state.nextDocID)) {
+      fprintf(stderr, "usage: %s [pageDirectory]; no pages to recrawl, or the list of them cannot be read\n", pageDirectory);
+      urlset_delete(urls);
+      scheduler_delete(scheduler, webpage_delete);
+      bag_delete(fetched, NULL);
+      exit(25);
+    }
+  } else {
+    // allocate memory for the seedURL so that you can put it in the scheduler and seen set
+    char* url = mem_malloc(strlen(seedURL)*sizeof(char) + 1);
+    strcpy(url, seedURL);
+    if (!urlset_insert(urls, seedURL)) { // check if there is an error in inserting
+      fprintf(stderr, "error when inserting seedURL into seen set\n");
+      mem_free(url);
+      urlset_delete(urls);
+      scheduler_delete(scheduler, NULL);
+      bag_delete(fetched, NULL);
+      exit(10);
+    }
     webpage = webpage_new(url, 0, NULL);  // create a new webpage from the url
     if (webpage == NULL) {  // make sure the webpage is not null
       fprintf(stderr, "error when creating webpage\n");
       webpage_delete(webpage); // delete the webpage
-      hashtable_delete(ht, NULL); // delete the hashtable
-      bag_delete(bag, NULL);    // delete the bag
+      urlset_delete(urls);        // delete the seen set
+      scheduler_delete(scheduler, NULL);    // delete the scheduler
+      bag_delete(fetched, NULL);
       exit(12);
     } else {
-      bag_insert(bag, webpage); // then insert the webpage representing the seedURL into the bag
-      if (bag == NULL) { // check for errors in inserting the webpage into the bag
-        fprintf(stderr, "error when inserting webpage into bag\n");
+      // then queue the webpage representing the seedURL in the scheduler, checking for errors
+      if (!scheduler_add(scheduler, webpage)) {
+        fprintf(stderr, "error when inserting webpage into scheduler\n");
         webpage_delete(webpage);  // delete the webpage
-        hashtable_delete(ht, NULL); // delete the hashtable
-        bag_delete(bag, NULL);    // delete the bag
+        urlset_delete(urls);        // delete the seen set
+        scheduler_delete(scheduler, NULL);    // delete the scheduler
+        bag_delete(fetched, NULL);
         exit(13);
       }
     }
   }
-  int counter = 1; // counter to produce unique id code
-  // while bag is not empty, pull a webpage from the bag one at a time
-  while ((webpage = bag_extract(bag)) != NULL) {
-    // fetch the HTML for that webpage
-    if (webpage_fetch(webpage)) {  // if fetch was successful
-      logr("Fetched", webpage_getDepth(webpage), webpage_getURL(webpage));  // print that the webpage is being fetched
-      pagedir_save(webpage, pageDirectory, counter);  // save the webpage to pageDirectory
-      counter++; // increase counter by one
-      if (webpage_getDepth(webpage) < maxDepth) { // if the webpage is not at maxDepth
-        pageScan(webpage, bag, ht);   // pageScan the HTML
+
+  // the fetcher keeps up to numConns pages in flight
+  state.fetcher = fetcher_new(options->numConns);
+  if (state.fetcher == NULL) {
+    fprintf(stderr, "error when creating fetcher\n");
+    urlset_delete(urls);
+    scheduler_delete(scheduler, webpage_delete);
+    bag_delete(fetched, NULL);
+    exit(18);
+  }
+
+  // set up the state shared by the workers
+  state.frontier.scheduler = scheduler;
+  state.frontier.fetched = fetched;
+  state.frontier.numFetched = 0;
+  state.frontier.claimed = NULL;
+  state.frontier.numClaimed = 0;
+  state.frontier.maxClaimed = 0;
+  state.frontier.busy = 0;
+  state.frontier.over = false;
+  pthread_mutex_init(&state.frontier.lock, NULL);
+  pthread_cond_init(&state.frontier.changed, NULL);
+  state.seen.urls = urls;
+  pthread_mutex_init(&state.seen.lock, NULL);
+  state.seedURL = seedURL;
+  state.pageDirectory = pageDirectory;
+  state.maxDepth = maxDepth;
+  pthread_mutex_init(&state.docLock, NULL);
+  // prefer the checkpoint writer, so that a steady stream of pages cannot hold it off
+  pthread_rwlockattr_t commitAttr;
+  pthread_rwlockattr_init(&commitAttr);
+  pthread_rwlockattr_setkind_np(&commitAttr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&state.commitLock, &commitAttr);
+  pthread_rwlockattr_destroy(&commitAttr);
+  state.stopping = false;
+  pthread_mutex_init(&state.stopLock, NULL);
+  pthread_cond_init(&state.stop, NULL);
+
+  // checkpoints are written by a thread of their own, so the fetching thread never waits on the disk
+  pthread_t writer;
+  if (pthread_create(&writer, NULL, checkpointWriter, &state) != 0) {
+    fprintf(stderr, "error when creating checkpoint thread\n");
+    exit(16);
+  }
+
+  // with one worker, pages are saved and scanned right on the fetching thread
+  int numWorkers = options->numThreads > 1 ? options->numThreads : 0;
+  pthread_t* workers = mem_malloc_assert((numWorkers + 1) * sizeof(pthread_t), "workers");
+  for (int i = 0; i < numWorkers; i++) {
+    if (pthread_create(&workers[i], NULL, crawlWorker, &state) != 0) {
+      fprintf(stderr, "error when creating worker thread\n");
+      exit(16);
+    }
+  }
+  bool complete = fetchLoop(&state, options);
+  for (int i = 0; i < numWorkers; i++) {
+    pthread_join(workers[i], NULL);   // wait for the workers to see the crawl is over
+  }
+  mem_free(workers);
+
+  // stop the checkpoint writer; if the crawl is complete its checkpoint is no longer needed, 
+  // otherwise take a last one, of the pages left to crawl
+  pthread_mutex_lock(&state.stopLock);
+  state.stopping = true;
+  pthread_cond_signal(&state.stop);
+  pthread_mutex_unlock(&state.stopLock);
+  pthread_join(writer, NULL);
+  if (complete) {
+    checkpoint_remove(pageDirectory);
+  } else {
+    writeCheckpoint(&state);
+    printf("Stopped with %d pages left to crawl; continue with --resume\n", scheduler_count(scheduler));
+  }
+
+  fetcher_delete(state.fetcher);
+  dnscache_clear();   // no thread looks up hosts any more
+  pagedir_close(pageDirectory);   // no thread saves pages any more
+  pthread_cond_destroy(&state.stop);
+  pthread_mutex_destroy(&state.stopLock);
+  pthread_rwlock_destroy(&state.commitLock);
+  pthread_mutex_destroy(&state.docLock);
+  pthread_mutex_destroy(&state.seen.lock);
+  pthread_cond_destroy(&state.frontier.changed);
+  pthread_mutex_destroy(&state.frontier.lock);
+  urlset_delete(urls);        // delete the seen set
+  scheduler_delete(scheduler, webpage_delete);    // delete the scheduler, and any pages left in it
+  bag_delete(fetched, NULL);
+  free(state.frontier.claimed);
+}
+
+/* *************************************************************************************************
+ * Takes the crawlstate_t* for the crawl and the options_t* it was started with
+ *
+ * Loops on the calling thread: hands the fetcher as many pages to fetch as it will take and their 
+ * hosts allow, then waits for one to complete and passes it on to be saved and scanned (by a worker, or right here 
+ * if there are no workers); a worker that adds pages or finishes one wakes the loop
+ *
+ * Once the budget is spent no new fetch starts; the loop waits for those in flight to be saved 
+ * and scanned, and then stops too
+ *
+ * Returns true once the crawl is over, false if it stopped short at the budget, after telling the 
+ * workers so
+ */ 
+static bool fetchLoop(crawlstate_t* state, const options_t* options) {
+  webpage_t* webpage;
+  bool success;
+  long wait = -1;
+  bool complete;
+  int claimed = 0;    // pages fetched, or being fetched, toward --max-pages
+  long deadline = options->maxSeconds > 0 ? nowMs() + options->maxSeconds * 1000L : -1;
+  for (;;) {
+    // hand the fetcher as many pages as it will take, as their hosts come due, while the budget lasts
+    bool spent = outOfBudget(options, claimed, deadline);
+    while (!spent && !fetcher_isFull(state->fetcher)
+           && (webpage = frontier_takeUnfetched(&state->frontier, &wait)) != NULL) {
+      fetcher_submit(state->fetcher, webpage);
+      spent = outOfBudget(options, ++claimed, deadline);
+    }
+    if (fetcher_inFlight(state->fetcher) == 0) {
+      if ((complete = frontier_isOver(&state->frontier))) {
+        break;  // nothing in flight, and nothing left that could add pages
+      }
+      if (spent && frontier_isIdle(&state->frontier)) {
+        break;  // out of budget, and every page fetched has been saved and scanned
       }
     }
-    webpage_delete(webpage);    // delete the webpage
+
+    // wait for a fetch to complete, for a worker to wake us, or for the next host to come due;
+    // when the fetcher is full, or the budget spent, only a completion lets the loop go on
+    long timeout = (fetcher_isFull(state->fetcher) || spent) ? -1 : wait;
+    if (!spent && deadline >= 0 && (timeout < 0 || deadline - nowMs() < timeout)) {
+      timeout = deadline > nowMs() ? deadline - nowMs() : 0;
+    }
+    webpage = fetcher_next(state->fetcher, timeout, &success);
+    if (webpage == NULL) {
+      continue;
+    }
+    if (!success) {
+      // could not fetch it; move on, and do not try it again on resume
+      claimed--;
+      pthread_rwlock_rdlock(&state->commitLock);
+      frontier_release(&state->frontier, webpage);
+      pthread_rwlock_unlock(&state->commitLock);
+      webpage_delete(webpage);
+      continue;
+    }
+    logr("Fetched", webpage_getDepth(webpage), webpage_getURL(webpage));  // print that the webpage is being fetched
+    if (options->numThreads > 1) {
+      frontier_addFetched(&state->frontier, webpage);
+    } else {
+      processPage(state, webpage);
+    }
   }
-  hashtable_delete(ht, NULL); // delete the hashtable
-  bag_delete(bag, NULL);    // delete the bag
+
+  // let the workers know the crawl is over
+  pthread_mutex_lock(&state->frontier.lock);
+  state->frontier.over = true;
+  pthread_cond_broadcast(&state->frontier.changed);
+  pthread_mutex_unlock(&state->frontier.lock);
+  return complete;
 }
 
+/* *************************************************************************************************
+ * Takes the options_t* with the budget, the pages claimed from it so far, and the time it runs 
+ * out (-1 for none)
+ *
+ * Returns true if no more fetches should start
+ */ 
+static bool outOfBudget(const options_t* options, const int claimed, const long deadline) {
+  return (options->maxPages > 0 && claimed >= options->maxPages)
+         || (deadline >= 0 && nowMs() >= deadline);
+}
 
 /* *************************************************************************************************
- * Takes webpage_t* that we want to scan, the bag_t* that we are checking from, and the hashtable_t* 
- * that we are inserting the webpage into
+ * Takes a webpage_t* waiting to be crawled
+ *
+ * Scores it for the frontier, which takes pages shallowest first and, among pages of the same 
+ * depth, best score first: pages with fewer path segments, which tend to be the index pages of a 
+ * site, score higher
+ *
+ * Returns the score (the urlqueue clamps it to its range)
+ */ 
+static int scorePage(const webpage_t* page) {
+  const char* path = strstr(webpage_getURL(page), "://");
+  path = path ? strchr(path + 3, '/') : NULL;
+  int segments = 0;
+  for (; path != NULL && *path != '\0'; path++) {
+    if (*path == '/') {
+      segments++;
+    }
+  }
+  return URLQUEUE_SCORES - segments;
+}
+
+/* *************************************************************************************************
+ * Takes the crawlstate_t* shared by all workers (as a void* so it can be a thread's start routine)
+ *
+ * Takes fetched pages one at a time until the crawl is over, and saves and scans each of them
+ *
+ * Returns NULL
+ */ 
+static void* crawlWorker(void* arg) {
+  crawlstate_t* state = arg;
+  webpage_t* webpage;
+  while ((webpage = frontier_takeFetched(&state->frontier)) != NULL) {
+    processPage(state, webpage);
+    frontier_done(state);
+  }
+  return NULL;
+}
+
+/* *************************************************************************************************
+ * Takes the crawlstate_t* and a webpage_t* that has been fetched
+ *
+ * Saves the page to the pageDirectory under the next docID; only fetched pages get one, so 
+ * docIDs stay dense. Then scans it for more pages to crawl, unless it is at maxDepth, and 
+ * deletes it. A checkpoint sees all of this done, or none of it
+ */ 
+static void processPage(crawlstate_t* state, webpage_t* page) {
+  pthread_rwlock_rdlock(&state->commitLock);
+  pthread_mutex_lock(&state->docLock);
+  int docID = state->nextDocID++;
+  pthread_mutex_unlock(&state->docLock);
+  pagedir_save(page, state->pageDirectory, docID);  // save the webpage to pageDirectory
+  if (webpage_getDepth(page) < state->maxDepth) { // if the webpage is not at maxDepth
+    pageScan(page, state);   // pageScan the HTML
+  }
+  frontier_release(&state->frontier, page);
+  pthread_rwlock_unlock(&state->commitLock);
+  webpage_delete(page);    // delete the webpage
+}
+
+/* *************************************************************************************************
+ * Takes webpage_t* that we want to scan and the crawlstate_t* whose frontier and seen set we are 
+ * adding to
  *
  * Given a webpage, scan the given page to extract any links (URLs), ignoring non-internal URLs; 
- * for any URL not already seen before (i.e., not in the hashtable), add the URL to both the hashtable 
- * pages_seen and to the bag pages_to_crawl
+ * for any URL not already seen before (i.e., not in the seen set), add the URL to both the seen 
+ * set and to the frontier of pages to crawl
  */ 
-static void pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen) {
-  // check that the page, bag, and hashtable are not empty; otherwise delete the webpage and return
-  if (pagesToCrawl == NULL || pagesSeen == NULL || page == NULL) {
-    webpage_delete(page);
+static void pageScan(webpage_t* page, crawlstate_t* state) {
+  // check that the page and state are not empty; otherwise return
+  if (page == NULL || state == NULL) {
     return;  
   }
 
@@ -234,26 +696,331 @@ static void pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSee
   int depth = webpage_getDepth(page);
   logr("Scanning", depth, webpage_getURL(page));
 
-  int count = 0;
-  char* next;
-  // look through each URL that the webpage has
-  while ((next = webpage_getNextURL(page, &count)) != NULL) {
-    logr("Found", depth, next);   // print found for all urls in the webpage
-    if (!isInternalURL(next)) {   // check if the urls are internal
-      logr("IgnExtrn", depth, next);  // if not, print they are external and continue
-      mem_free(next);
-      continue;
-    } else {                      // if they are internal, try to insert them into hashtable
-      if (hashtable_insert(pagesSeen, next, "item")) {  // if the url is new and can be inserted
-        webpage_t* nextPage = webpage_new(next, webpage_getDepth(page) + 1, NULL);  // give it memory
-        bag_insert(pagesToCrawl, nextPage);             // and insert it in the bag of pages that need to be crawled
-        logr("Added", depth, next);     // print that the url has been added
-      } else {
-        logr("IgnDupl", depth, next);   // print that this is a duplicate url and continue
-        mem_free(next);
-        continue;
+  // look through each URL that the webpage has, in one pass over its HTML
+  scan_t scan = { state, depth };
+  webpage_iterateURLs(page, &scan, scanURL);
+}
+
+/* *************************************************************************************************
+ * Takes the scan_t* of the page being scanned (as a void*), and a URL found on it, which this 
+ * function now owns
+ *
+ * Ignores the URL if it is external or already seen; otherwise adds a page for it to the frontier
+ */ 
+static void scanURL(void* arg, char* url) {
+  scan_t* scan = arg;
+  logr("Found", scan->depth, url);    // print found for all urls in the webpage
+  // (plain free() below: webpage_iterateURLs mallocs the URLs itself)
+  if (!isInternalURL(url)) {          // check if the urls are internal
+    logr("IgnExtrn", scan->depth, url);   // if not, print they are external
+    free(url);
+  } else if (seenset_insert(&scan->state->seen, url)) {   // if the url is new and can be inserted
+    logr("Added", scan->depth, url);  // print that the url has been added, before another thread may crawl it
+    webpage_t* nextPage = webpage_new(url, scan->depth + 1, NULL);  // give it memory
+    frontier_add(scan->state, nextPage);  // and add it to the pages that need to be crawled
+  } else {
+    logr("IgnDupl", scan->depth, url);    // print that this is a duplicate url
+    free(url);
+  }
+}
+
+/* *************************************************************************************************
+ * Takes the crawlstate_t* and a webpage_t* to crawl
+ *
+ * Adds the page to the pages waiting to be fetched, and wakes the fetching thread
+ */ 
+static void frontier_add(crawlstate_t* state, webpage_t* page) {
+  pthread_mutex_lock(&state->frontier.lock);
+  scheduler_add(state->frontier.scheduler, page);
+  pthread_mutex_unlock(&state->frontier.lock);
+  fetcher_wake(state->fetcher);
+}
+
+/* *************************************************************************************************
+ * Takes the frontier_t* to take a page from, and a long* for how long to wait if there is none
+ *
+ * Returns the next page whose host may be fetched from now, or NULL if there is none right now;
+ * then *waitMs is how long until there may be one, or -1 if no page is waiting at all
+ */ 
+static webpage_t* frontier_takeUnfetched(frontier_t* frontier, long* waitMs) {
+  pthread_mutex_lock(&frontier->lock);
+  webpage_t* page = scheduler_next(frontier->scheduler, nowMs(), waitMs);
+  if (page != NULL) {
+    // remember it until it is finished, so that a checkpoint still counts it as to be crawled
+    if (frontier->numClaimed == frontier->maxClaimed) {
+      int maxClaimed = frontier->maxClaimed ? frontier->maxClaimed * 2 : 16;
+      webpage_t** claimed = realloc(frontier->claimed, maxClaimed * sizeof(webpage_t*));
+      if (claimed == NULL) {
+        fprintf(stderr, "error when allocating the pages being crawled\n");
+        exit(9);
+      }
+      frontier->claimed = claimed;
+      frontier->maxClaimed = maxClaimed;
+    }
+    frontier->claimed[frontier->numClaimed++] = page;
+  }
+  pthread_mutex_unlock(&frontier->lock);
+  return page;
+}
+
+/* *************************************************************************************************
+ * Takes the frontier_t* and a fetched webpage_t*, and wakes a worker to save and scan it
+ */ 
+static void frontier_addFetched(frontier_t* frontier, webpage_t* page) {
+  pthread_mutex_lock(&frontier->lock);
+  bag_insert(frontier->fetched, page);
+  frontier->numFetched++;
+  pthread_cond_signal(&frontier->changed);
+  pthread_mutex_unlock(&frontier->lock);
+}
+
+/* *************************************************************************************************
+ * Takes the frontier_t* to take a fetched page from
+ *
+ * Waits until a fetched page arrives or the crawl is over; the caller becomes busy until it 
+ * calls frontier_done
+ *
+ * Returns the fetched page, or NULL once the crawl is over
+ */ 
+static webpage_t* frontier_takeFetched(frontier_t* frontier) {
+  webpage_t* page;
+  pthread_mutex_lock(&frontier->lock);
+  while ((page = bag_extract(frontier->fetched)) == NULL && !frontier->over) {
+    pthread_cond_wait(&frontier->changed, &frontier->lock);
+  }
+  if (page != NULL) {
+    frontier->numFetched--;
+    frontier->busy++;
+  }
+  pthread_mutex_unlock(&frontier->lock);
+  return page;
+}
+
+/* *************************************************************************************************
+ * Takes the crawlstate_t* of a worker that finished with its page
+ *
+ * Marks the worker as no longer busy and wakes the fetching thread, which may find the crawl over
+ */ 
+static void frontier_done(crawlstate_t* state) {
+  pthread_mutex_lock(&state->frontier.lock);
+  state->frontier.busy--;
+  pthread_mutex_unlock(&state->frontier.lock);
+  fetcher_wake(state->fetcher);
+}
+
+/* *************************************************************************************************
+ * Takes the frontier_t* to check
+ *
+ * Returns true if no page waits to be fetched, saved, or scanned, and no worker is busy
+ */ 
+static bool frontier_isOver(frontier_t* frontier) {
+  pthread_mutex_lock(&frontier->lock);
+  bool over = scheduler_count(frontier->scheduler) == 0 && frontier->numFetched == 0 && frontier->busy == 0;
+  pthread_mutex_unlock(&frontier->lock);
+  return over;
+}
+
+/* *************************************************************************************************
+ * Takes the frontier_t* to check
+ *
+ * Returns true if every fetched page has been saved and scanned, whether or not pages are still 
+ * waiting to be fetched
+ */ 
+static bool frontier_isIdle(frontier_t* frontier) {
+  pthread_mutex_lock(&frontier->lock);
+  bool idle = frontier->numFetched == 0 && frontier->busy == 0;
+  pthread_mutex_unlock(&frontier->lock);
+  return idle;
+}
+
+/* *************************************************************************************************
+ * Takes the frontier_t* and a page taken from it that has been crawled, or failed to be
+ *
+ * Forgets the page, so that a checkpoint does not ask for it again
+ */ 
+static void frontier_release(frontier_t* frontier, webpage_t* page) {
+  pthread_mutex_lock(&frontier->lock);
+  for (int i = frontier->numClaimed - 1; i >= 0; i--) {
+    if (frontier->claimed[i] == page) {
+      frontier->claimed[i] = frontier->claimed[--frontier->numClaimed];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&frontier->lock);
+}
+
+/* *************************************************************************************************
+ * Takes the seenset_t* to insert into, and a URL
+ *
+ * Returns true if the URL was not seen before, and is now
+ */ 
+static bool seenset_insert(seenset_t* seen, const char* url) {
+  pthread_mutex_lock(&seen->lock);
+  bool inserted = urlset_insert(seen->urls, url);
+  pthread_mutex_unlock(&seen->lock);
+  return inserted;
+}
+
+/* *************************************************************************************************
+ * Takes the crawlstate_t* (as a void* so it can be a thread's start routine)
+ *
+ * Writes a checkpoint every CHECKPOINT_SECONDS until the crawl is over
+ *
+ * Returns NULL
+ */ 
+static void* checkpointWriter(void* arg) {
+  crawlstate_t* state = arg;
+  pthread_mutex_lock(&state->stopLock);
+  while (!state->stopping) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);   // the clock pthread_cond_timedwait uses
+    deadline.tv_sec += CHECKPOINT_SECONDS;
+    int waited = 0;
+    while (!state->stopping && waited != ETIMEDOUT) {
+      waited = pthread_cond_timedwait(&state->stop, &state->stopLock, &deadline);
+    }
+    if (!state->stopping) {
+      pthread_mutex_unlock(&state->stopLock);
+      writeCheckpoint(state);
+      pthread_mutex_lock(&state->stopLock);
+    }
+  }
+  pthread_mutex_unlock(&state->stopLock);
+  return NULL;
+}
+
+/* *************************************************************************************************
+ * Takes the crawlstate_t* to checkpoint
+ *
+ * Waits for the pages being finished to be done, and holds off the next ones, while the pages 
+ * still to be crawled, the seen set, and the docID counter are copied into a new checkpoint; then lets the crawl go on while the 
+ * checkpoint is flushed to disk and put in place of the last one, once the pages it counts on are
+ */ 
+static void writeCheckpoint(crawlstate_t* state) {
+  pthread_rwlock_wrlock(&state->commitLock);
+  pthread_mutex_lock(&state->docLock);
+  int nextDocID = state->nextDocID;
+  pthread_mutex_unlock(&state->docLock);
+  checkpoint_t* checkpoint = checkpoint_begin(state->pageDirectory, state->seedURL, state->maxDepth, nextDocID);
+  if (checkpoint != NULL) {
+    pthread_mutex_lock(&state->frontier.lock);
+    scheduler_iterate(state->frontier.scheduler, checkpoint, checkpointURL);
+    for (int i = 0; i < state->frontier.numClaimed; i++) {
+      checkpointURL(checkpoint, state->frontier.claimed[i]);
+    }
+    pthread_mutex_unlock(&state->frontier.lock);
+    pthread_mutex_lock(&state->seen.lock);
+    urlset_iterate(state->seen.urls, checkpoint, checkpointSeen);
+    pthread_mutex_unlock(&state->seen.lock);
+  }
+  pthread_rwlock_unlock(&state->commitLock);
+
+  // every page below nextDocID was saved before the write lock was taken; a resume starts past them
+  if (checkpoint != NULL && !pagedir_sync(state->pageDirectory, nextDocID)) {
+    fprintf(stderr, "error when syncing pages in %s; checkpoint not written\n", state->pageDirectory);
+    checkpoint_abandon(checkpoint);
+    return;
+  }
+  if (!checkpoint_commit(checkpoint)) {
+    fprintf(stderr, "error when writing checkpoint to %s\n", state->pageDirectory);
+  }
+}
+
+/* *************************************************************************************************
+ * Takes the checkpoint_t* being written (as a void*), and a page still to be crawled
+ *
+ * Records the page's URL and depth in the checkpoint
+ */ 
+static void checkpointURL(void* arg, webpage_t* page) {
+  checkpoint_addURL(arg, webpage_getURL(page), webpage_getDepth(page));
+}
+
+/* *************************************************************************************************
+ * Takes the checkpoint_t* being written (as a void*), and the fingerprint of a URL seen
+ *
+ * Records the fingerprint in the checkpoint
+ */ 
+static void checkpointSeen(void* arg, const uint64_t fingerprint) {
+  checkpoint_addSeen(arg, fingerprint);
+}
+
+/* *************************************************************************************************
+ * Takes the resumestate_t* being filled in (as a void*), and a URL still to be crawled and its 
+ * depth, as read from a checkpoint
+ *
+ * Adds a page for the URL to the scheduler
+ */ 
+static void resumeURL(void* arg, const char* url, const int depth) {
+  resumestate_t* resume = arg;
+  char* copy = mem_malloc_assert(strlen(url) + 1, "url");
+  strcpy(copy, url);
+  scheduler_add(resume->scheduler, webpage_new(copy, depth, NULL));
+}
+
+/* *************************************************************************************************
+ * Takes the resumestate_t* being filled in (as a void*), and the fingerprint of a URL seen, as 
+ * read from a checkpoint
+ *
+ * Adds the fingerprint to the seen set
+ */ 
+static void resumeSeen(void* arg, const uint64_t fingerprint) {
+  resumestate_t* resume = arg;
+  urlset_insertFingerprint(resume->urls, fingerprint);
+}
+
+/* *************************************************************************************************
+ * Takes the pageDirectory of a crawl to recrawl, the name of a file listing the URLs to fetch 
+ * again, one per line (or NULL for every page), the seen set and scheduler to fill in, and where 
+ * to put the next docID
+ *
+ * Marks the URL of every page in the pageDirectory seen, and queues the pages to fetch again, 
+ * each URL once, at the depth it was crawled at; a URL the file lists that the pageDirectory does 
+ * not have is ignored. The next docID is the first with no page, after every page already saved
+ *
+ * Returns false if the file cannot be read, or the pageDirectory has no pages
+ */ 
+static bool recrawlLoad(char* pageDirectory, char* listFilename, urlset_t* urls, scheduler_t* scheduler,
+                        int* nextDocID) {
+  urlset_t* listed = NULL;
+  if (listFilename != NULL) {
+    FILE* fp = fopen(listFilename, "r");
+    if (fp == NULL || (listed = urlset_new(0, false)) == NULL) {
+      if (fp != NULL) {
+        fclose(fp);
       }
+      return false;
     }
+    char* url;
+    while ((url = file_readLine(fp)) != NULL) {
+      urlset_insert(listed, url);
+      free(url);
+    }
+    fclose(fp);
   }
-  mem_free(next); // free the char*
+
+  webpage_t* page;
+  int docID;
+  for (docID = 1; (page = pagedir_loadMapped(pageDirectory, docID)) != NULL; docID++) {
+    const char* url = webpage_getURL(page);
+    // an earlier recrawl may have saved the URL again; it is fetched once
+    if (urlset_insert(urls, url) && (listed == NULL || urlset_contains(listed, url))) {
+      char* copy = mem_malloc_assert(strlen(url) + 1, "url");
+      strcpy(copy, url);
+      scheduler_add(scheduler, webpage_new(copy, webpage_getDepth(page), NULL));
+    }
+    webpage_delete(page);
+  }
+  pagedir_close(pageDirectory);   // which unmaps the pages; saving opens the directory again
+  urlset_delete(listed);
+  *nextDocID = docID;
+  return docID > 1;
+}
+
+/* *************************************************************************************************
+ * Returns the current time in milliseconds, from a clock that never jumps
+ */ 
+static long nowMs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000 + now.tv_nsec / 1000000;
 }
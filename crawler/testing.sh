@@ -39,6 +39,30 @@ mkdir testDirectory
 # depth above upper bound
 ./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory 15
 
+# unknown option
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory 1 -x 4
+
+# number of threads out of bounds
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory 1 -j 0
+
+# number of connections out of bounds
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory 1 -c 2000
+
+# politeness delay out of bounds
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory 1 -d -5
+
+# resume without a checkpoint
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory 1 --resume
+
+# page budget out of bounds
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory 1 --max-pages 0
+
+# time budget missing its value
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory 1 --max-seconds
+
+# recrawl resumed into
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory 1 --recrawl --resume
+
 
 ##### Valgrind #####
 mkdir testDirectory/valgrind
@@ -62,6 +86,43 @@ mkdir testDirectory/letters-2
 mkdir testDirectory/letters-10
 ./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10 10
 
+# depth 10 with 4 worker threads
+mkdir testDirectory/letters-10-j4
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10-j4 10 -j 4
+
+# depth 10 with 16 fetches in flight
+mkdir testDirectory/letters-10-c16
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10-c16 10 -c 16
+
+# depth 10 with a 100ms politeness delay
+mkdir testDirectory/letters-10-d100
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10-d100 10 -c 8 -d 100
+
+# depth 10, killed after a checkpoint and then resumed
+mkdir testDirectory/letters-10-resume
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10-resume 10 -d 2000 &
+sleep 15; kill -9 $!
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10-resume 10 -d 2000 --resume
+
+# depth 10, stopped at a budget of 5 pages and then resumed
+mkdir testDirectory/letters-10-budget
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10-budget 10 -d 100 --max-pages 5
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10-budget 10 -d 100 --resume --max-seconds 60
+
+# depth 10, one file per page
+mkdir testDirectory/letters-10-legacy
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10-legacy 10 --legacy
+
+# depth 10 fetched again, every page and then B alone, each saved again after the pages already there
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10 10 -d 100 --recrawl
+echo http://cs50tse.cs.dartmouth.edu/tse/letters/B.html > testDirectory/recrawlURLs
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-10 10 -d 100 --recrawl-list testDirectory/recrawlURLs
+
+# recrawl of a crawl with no pages
+mkdir testDirectory/letters-empty
+touch testDirectory/letters-empty/.crawler
+./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testDirectory/letters-empty 10 --recrawl
+
 
 ##### Toscrape #####
 # depth 0
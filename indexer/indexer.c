@@ -7,7 +7,18 @@
  * by the indexer and saves it to another file.
  * usage:
  *   2 command-line arguments for the pageDirectory produced by crawler 
- *   and indexFilename
+ *   and indexFilename, optionally followed by
+ *     -j N  to build the index with N worker threads
+ *     --mem-budget SIZE  to build it in pieces of at most SIZE (MB, or
+ *       with a K, M, or G suffix) of memory, written out as runs to a
+ *       temporary directory next to indexFilename and merged at the end
+ *     --append  to index only the pages past those already in indexFilename,
+ *       as a new segment of it (see segments.h), rather than rebuild it;
+ *       a page whose URL is in the index already replaces the old one
+ *     --delete FILE  with --append, to delete the pages whose URLs FILE
+ *       lists, one per line, from the index
+ *     --positions  to write where each word is in each page, too, as
+ *       indexFilename.pos, so that the querier can find phrases
  *
  * output:
  *   a file (indexFilename) with the formatted index
@@ -16,32 +27,89 @@
  * Used pseudocode from cs50 webpage
  */
 
+#define _POSIX_C_SOURCE 200809L   // mkdtemp
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "bag.h"
 #include "hashtable.h"
 #include "mem.h"
+#include "file.h"
 #include "webpage.h"
 #include "pagedir.h"
 #include "index.h"
 #include "word.h"
+#include "docmeta.h"
+#include "segments.h"
+#include "positions.h"
 
 /**************** file-local global variables ****************/
-/* none */
+static const int MAX_THREADS = 64;    // upper bound on the -j argument
+static const long MAX_BUDGET = 1L << 40;    // upper bound on the --mem-budget argument, in bytes
+static const int MAX_MERGE = 128;     // most runs merged at once; more are merged in rounds
 
 /**************** local types ****************/
-/* none */
+// where a build with a memory budget writes its indexes out, as runs
+typedef struct spill {
+  size_t budget;              // bytes an index may take before it is written out
+  char* directory;            // the temporary directory of the runs, named by number
+  int numRuns;                // runs written so far, under 'lock'
+  bool ok;                    // false once a run could not be written; under 'lock'
+  pthread_mutex_t lock;
+} spill_t;
+
+// what the workers of a parallel build share
+typedef struct build {
+  char* pageDirectory;
+  spill_t* spill;             // where to write the workers' indexes out, or NULL for no budget
+  docmeta_t* meta;            // the document table, under 'lock'
+  bool positions;             // whether the workers keep the words' positions
+  int next;                   // the next docID to index, under 'lock'
+  int end;                    // the first docID with no page, once found; under 'lock'
+  pthread_mutex_t lock;
+} build_t;
+
+// one worker of a parallel build, and the index of the pages it took
+typedef struct worker {
+  build_t* build;
+  index_t* index;
+  positions_t* positions;     // of the pages it took, or NULL if not kept
+  pthread_t thread;
+} worker_t;
 
 /**************** global types ****************/
 /* none */
 
 /**************** function prototypes ****************/
 int main(const int argc, char* argv[]);
-void indexBuild(char* pageDirectory, char* indexFilename);
-void indexPage(index_t* index, webpage_t* webpage, int docID);
+void indexBuild(char* pageDirectory, char* indexFilename, int numThreads, size_t budget, bool positions);
+void indexAppend(char* pageDirectory, char* indexFilename, int numThreads, FILE* deletedFile);
+void indexPage(index_t* index, positions_t* positions, webpage_t* webpage, int docID);
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool parseOptions(const int argc, char* argv[], char** threads, char** budget, bool* append, char** deleted,
+                         bool* positions);
+static int indexPages(char* pageDirectory, int first, index_t** index, positions_t* positions, docmeta_t* meta,
+                      spill_t* spill);
+static int indexParallel(char* pageDirectory, int first, index_t** index, positions_t* positions, docmeta_t* meta,
+                         int numThreads, spill_t* spill);
+static void* workerMain(void* arg);
+static bool isContinued(segments_t* segs, char* pageDirectory, char* crawl, int first);
+static void removeUpdated(segments_t* segs, docmeta_t* meta, int first, int end);
+static void removeURLs(segments_t* segs, FILE* fp);
+static spill_t* spillStart(char* indexFilename, size_t budget);
+static index_t* spillFull(spill_t* spill, index_t* index);
+static void writeRun(spill_t* spill, index_t* index);
+static bool mergeRuns(spill_t* spill, char* indexFilename, int limit);
+static char* runFilename(spill_t* spill, int run);
+static void spillEnd(spill_t* spill);
 
 /*********************** main() ***********************/
 /* Takes int argc for the number of command-line arguments and 
@@ -54,12 +122,17 @@ void indexPage(index_t* index, webpage_t* webpage, int docID);
  * otherwise exit at non-zero integer to show error in the program
  */
 int main(const int argc, char* argv[]) {
+  char* threadsArg = NULL;    // the options' arguments, if given
+  char* budgetArg = NULL;
+  bool append = false;
+  char* deletedArg = NULL;
+  bool positions = false;
   // check argc to make sure the only arguments are pageDirectory and indexFilename
   if (argc < 3) {
     // too few arguments, print error message to stderr
     fprintf(stderr, "usage: %s [indexer]: too few arguments\n", argv[0]);
     exit(1);  // non-zero exit to represent unsuccessful exit status
-  } else if (argc == 3) {   // correct number of arguments
+  } else if (parseOptions(argc, argv, &threadsArg, &budgetArg, &append, &deletedArg, &positions)) {   // correct number of arguments
     // now parse the arguments and make sure they are valid
     char* pageDirectory = argv[1];                              // parse the command line
     char* indexFilename = argv[2];
@@ -77,14 +150,56 @@ int main(const int argc, char* argv[]) {
       fprintf(stderr, "usage: %s [pageDirectory]: directory is not a crawler directory\n", argv[1]);
       exit(3);
     }
-    // check that the index filename can be opened or created
+    // and that the number of threads, if given, is in range
+    int numThreads = 1;
+    char ignore;
+    if (threadsArg != NULL && (sscanf(threadsArg, "%d%c", &numThreads, &ignore) != 1 || numThreads < 1 || numThreads > MAX_THREADS)) {
+      fprintf(stderr, "usage: %s [-j bounds [1, %d]]; improper number of threads\n", threadsArg, MAX_THREADS);
+      exit(5);
+    }
+    // and that the memory budget, if given, is a size: MB by default
+    long budget = 0;
+    char unit = 'M';
+    if (budgetArg != NULL) {
+      int fields = sscanf(budgetArg, "%ld%c%c", &budget, &unit, &ignore);
+      long scale = unit == 'K' ? 1L << 10 : unit == 'M' ? 1L << 20 : unit == 'G' ? 1L << 30 : 0;
+      if (fields < 1 || fields > 2 || scale == 0 || budget < 1 || budget > MAX_BUDGET / scale) {
+        fprintf(stderr, "usage: %s [--mem-budget SIZE[K|M|G]]; improper memory budget\n", budgetArg);
+        exit(7);
+      }
+      budget *= scale;
+    }
+    if (append && budget > 0) {
+      fprintf(stderr, "usage: %s [--mem-budget]; cannot be used with --append\n", budgetArg);
+      exit(7);
+    }
+    // and that the list of URLs to delete, if given, can be read, and is for an index being added to
+    FILE* deletedFile = NULL;
+    if (deletedArg != NULL && (!append || (deletedFile = fopen(deletedArg, "r")) == NULL)) {
+      fprintf(stderr, "usage: %s [--delete FILE]; needs --append and a readable file\n", deletedArg);
+      exit(10);
+    }
+    // positions are written next to one index file, which --mem-budget and --append do not build
+    if (positions && (append || budget > 0)) {
+      fprintf(stderr, "usage: %s [--positions]; cannot be used with --append or --mem-budget\n", indexFilename);
+      exit(11);
+    }
+    // check that the index filename can be opened or created, leaving it be if it is to be added to;
+    // last, as "w" empties it, and a usage error should not
     FILE* file;
-    if ((file = fopen(argv[2], "w")) == NULL) { // if it cannot be, print error to stderr, free memory, close file, and exit
+    if ((file = fopen(argv[2], append ? "a" : "w")) == NULL) { // if it cannot be, print error to stderr, free memory, close file, and exit
       fprintf(stderr, "usage: %s [indexFilename]: problem creating/opening index file\n", argv[2]);
       exit(4);
     }
     fclose(file); 
-    indexBuild(pageDirectory, indexFilename);
+    if (append) {
+      indexAppend(pageDirectory, indexFilename, numThreads, deletedFile);
+      if (deletedFile != NULL) {
+        fclose(deletedFile);
+      }
+    } else {
+      indexBuild(pageDirectory, indexFilename, numThreads, budget, positions);
+    }
   } else {
     // too many arguments
     fprintf(stderr, "usage: %s [indexer]; too many arguments\n", argv[0]);
@@ -93,29 +208,490 @@ int main(const int argc, char* argv[]) {
   exit(0); //successful exit status
 }
 
-void indexBuild(char* pageDirectory, char* indexFilename) {
+/*********************** parseOptions() ***********************/
+/* Takes argc and argv of main, and where to put the arguments of the
+ * options
+ *
+ * Finds the options after pageDirectory and indexFilename - each of
+ * "-j threads", "--mem-budget SIZE", "--append", "--delete FILE", and
+ * "--positions" at most once, in any order - and sets threads, budget,
+ * and deleted to their arguments, if given, and append and positions
+ * to whether --append and --positions are
+ *
+ * Returns false if there is anything else after indexFilename
+ */
+static bool parseOptions(const int argc, char* argv[], char** threads, char** budget, bool* append, char** deleted,
+                         bool* positions) {
+  for (int i = 3; i < argc; i++) {
+    if (i + 1 < argc && strcmp(argv[i], "-j") == 0 && *threads == NULL) {
+      *threads = argv[++i];
+    } else if (i + 1 < argc && strcmp(argv[i], "--mem-budget") == 0 && *budget == NULL) {
+      *budget = argv[++i];
+    } else if (strcmp(argv[i], "--append") == 0 && !*append) {
+      *append = true;
+    } else if (i + 1 < argc && strcmp(argv[i], "--delete") == 0 && *deleted == NULL) {
+      *deleted = argv[++i];
+    } else if (strcmp(argv[i], "--positions") == 0 && !*positions) {
+      *positions = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*********************** indexBuild() ***********************/
+/* Takes the pageDirectory to index, the indexFilename to write, the 
+ * number of threads to build the index with, the bytes of memory 
+ * the index may take (0 for no limit), and whether to write the 
+ * words' positions (with no limit only)
+ *
+ * Indexes the pages from docID 1 up to the first docID with no page, 
+ * then writes the index, and the document table next to it, and the 
+ * positions, if kept, or else removes any left from an earlier build; 
+ * the files are the same whatever the number of threads or the budget. 
+ * With a budget, each index being built (one per thread) is written 
+ * out as a run whenever it reaches its share of the budget, and the 
+ * runs are merged into the index file at the end
+ */
+void indexBuild(char* pageDirectory, char* indexFilename, int numThreads, size_t budget, bool positions) {
   index_t* index = index_new();
+  positions_t* wordPositions = positions ? mem_assert(positions_new(), "positions") : NULL;
+  docmeta_t* meta = docmeta_new();    // what the querier prints of each page, by docID
+  spill_t* spill = budget > 0 ? spillStart(indexFilename, budget / numThreads) : NULL;
+  int end;
+  if (numThreads > 1) {
+    end = indexParallel(pageDirectory, 1, &index, wordPositions, meta, numThreads, spill);
+  } else {
+    end = indexPages(pageDirectory, 1, &index, wordPositions, meta, spill);
+  }
+  pagedir_close(pageDirectory);
+  if (spill != NULL && spill->numRuns > 0) {
+    // some of the index is in runs already: write the rest out too, and merge them all
+    if (index_count(index) > 0) {
+      writeRun(spill, index);
+    }
+    index_delete(index);
+    if (!mergeRuns(spill, indexFilename, end)) {
+      fprintf(stderr, "%s: error writing the index from its runs\n", indexFilename);
+      spillEnd(spill);
+      docmeta_delete(meta);
+      exit(8);
+    }
+  } else {
+    index_write(index, indexFilename);
+    index_delete(index);
+  }
+  spillEnd(spill);
+
+  // the document table goes next to the index, as indexFilename.meta
+  char* metaFilename = mem_malloc_assert(strlen(indexFilename) + 6, "metaFilename");
+  sprintf(metaFilename, "%s.meta", indexFilename);
+  if (!docmeta_write(meta, metaFilename)) {
+    fprintf(stderr, "error writing %s; the querier will read URLs from the pageDirectory\n", metaFilename);
+  }
+  mem_free(metaFilename);
+  docmeta_delete(meta);
+
+  // and the positions as indexFilename.pos, so that the querier never reads one build's with another's index
+  char* posFilename = mem_malloc_assert(strlen(indexFilename) + 5, "posFilename");
+  sprintf(posFilename, "%s.pos", indexFilename);
+  if (wordPositions == NULL) {
+    remove(posFilename);
+  } else if (!positions_write(wordPositions, posFilename, end)) {
+    fprintf(stderr, "error writing %s; the querier will not find phrases\n", posFilename);
+    remove(posFilename);
+  }
+  mem_free(posFilename);
+  positions_delete(wordPositions);
+}
+
+/*********************** indexAppend() ***********************/
+/* Takes the pageDirectory to index, the indexFilename of the index to
+ * add to (a manifest of segments, or an empty file), the number of
+ * threads to build the new segment with, and the open file of URLs to
+ * delete (or NULL)
+ *
+ * Indexes the pages from the first docID past the index's segments up
+ * to the first docID with no page, and adds them to the index as a
+ * new segment, with their document table; the segments are merged, as
+ * they need to be, meanwhile. A new page of a URL already in the
+ * index is an update: the old docID is deleted, as are those of the
+ * URLs to delete. Takes time for the new pages only, but for one
+ * pass over the URLs already indexed if any page is new or is deleted
+ *
+ * Exits (12) if the pageDirectory is not the crawl the index was built
+ * from, carried on
+ */
+void indexAppend(char* pageDirectory, char* indexFilename, int numThreads, FILE* deletedFile) {
+  segments_t* segs = segments_lock(indexFilename);
+  if (segs == NULL) {
+    exit(9);    // segments_lock said why
+  }
+  int first = segments_next(segs);
+  // the pages past the index's must be of the crawl it was built from, carried on: a new crawl
+  // in the directory numbers its pages from 1 again, and its pages past first are not updates
+  char* crawl = pagedir_getCrawlID(pageDirectory);
+  if (!isContinued(segs, pageDirectory, crawl, first)) {
+    fprintf(stderr, "%s: not the crawl %s was built from (a new crawl starts over at docID 1); "
+            "rebuild the index, or add to the crawl with the crawler's --recrawl\n", pageDirectory, indexFilename);
+    free(crawl);
+    segments_unlock(segs);
+    exit(12);
+  }
+  if (crawl != NULL) {
+    segments_setCrawl(segs, crawl);
+  }
+  free(crawl);
+  index_t* index = index_new();
+  docmeta_t* meta = docmeta_new();
+  int end;
+  if (numThreads > 1) {
+    end = indexParallel(pageDirectory, first, &index, NULL, meta, numThreads, NULL);
+  } else {
+    end = indexPages(pageDirectory, first, &index, NULL, meta, NULL);
+  }
+  pagedir_close(pageDirectory);
+  // the deletions go in the same manifest as the new pages, so that no reader sees the one without the other
+  removeUpdated(segs, meta, first, end);
+  if (deletedFile != NULL) {
+    removeURLs(segs, deletedFile);
+  }
+  bool ok = end == first || segments_add(segs, index, meta, first, end);    // nothing new, nothing to add
+  index_delete(index);
+  docmeta_delete(meta);
+  ok = segments_unlock(segs) && ok;
+  if (!ok) {
+    fprintf(stderr, "%s: error writing the index's segments\n", indexFilename);
+    exit(8);
+  }
+}
+
+/*********************** isContinued() ***********************/
+/* Takes the segments being added to, the pageDirectory, the identity
+ * of its crawl (NULL if it has none), and the first docID past the
+ * segments
+ *
+ * Returns true if the pageDirectory's pages up to first are those the
+ * segments hold: there are none yet, or the crawl is the one the
+ * manifest records (or neither knows its crawl) and still has a page
+ * at first - 1
+ */
+static bool isContinued(segments_t* segs, char* pageDirectory, char* crawl, int first) {
+  if (first == 1) {
+    return true;    // nothing indexed yet: any crawl will do
+  }
+  const char* indexed = segments_crawl(segs);
+  if ((crawl == NULL) != (indexed == NULL) || (crawl != NULL && strcmp(crawl, indexed) != 0)) {
+    return false;
+  }
+  char* url = pagedir_getURL(pageDirectory, first - 1);
+  bool found = url != NULL;
+  free(url);
+  return found;
+}
+
+/*********************** removeUpdated() ***********************/
+/* Takes the segments being added to, and the document table of the
+ * pages from first up to end, about to be added
+ *
+ * Deletes the docID already in the index of each page's URL, if any:
+ * the page is a newer version of it
+ */
+static void removeUpdated(segments_t* segs, docmeta_t* meta, int first, int end) {
+  for (int docID = first; docID < end; docID++) {
+    const char* url = docmeta_getURL(meta, docID);
+    int old = url != NULL ? segments_findURL(segs, url) : 0;
+    if (old > 0) {
+      segments_remove(segs, old);
+    }
+  }
+}
+
+/*********************** removeURLs() ***********************/
+/* Takes the segments being added to, and a file of URLs, one per line
+ *
+ * Deletes the docID in the index of each URL, if any; a URL not in
+ * the index is ignored
+ */
+static void removeURLs(segments_t* segs, FILE* fp) {
+  char* url;
+  while ((url = file_readLine(fp)) != NULL) {
+    int docID = url[0] != '\0' ? segments_findURL(segs, url) : 0;
+    if (docID > 0) {
+      segments_remove(segs, docID);
+    }
+    free(url);
+  }
+}
+
+/*********************** indexPages() ***********************/
+/* Takes the pageDirectory, the first docID to index, the index, 
+ * positions (or NULL), and document table to fill, and where to write 
+ * the index out when it is full (NULL for never)
+ *
+ * Indexes the pages in docID order on the calling thread; the index 
+ * is replaced with a new one each time it is written out
+ *
+ * Returns the first docID with no page
+ */
+static int indexPages(char* pageDirectory, int first, index_t** index, positions_t* positions, docmeta_t* meta,
+                      spill_t* spill) {
   webpage_t* webpage;
-  int docID = 1;
-  while ((webpage = pagedir_load(pageDirectory, docID)) != NULL) {
-    indexPage(index, webpage, docID);
+  int docID = first;
+  // map each page rather than copy it; the pages go before pagedir_close unmaps them
+  while ((webpage = pagedir_loadMapped(pageDirectory, docID)) != NULL) {
+    indexPage(*index, positions, webpage, docID);
+    *index = spillFull(spill, *index);
+    docmeta_add(meta, docID, webpage_getURL(webpage), webpage_getDepth(webpage), webpage_getHTMLLength(webpage));
     webpage_delete(webpage);
     docID++;
   }
-  index_write(index, indexFilename);
-  index_delete(index);
+  return docID;
+}
+
+/*********************** indexParallel() ***********************/
+/* Takes the pageDirectory, the first docID to index, the index, 
+ * positions (or NULL), and document table to fill, the number of 
+ * worker threads, and where to write their indexes out when full 
+ * (NULL for never)
+ *
+ * Each worker takes the next docID in turn and indexes its page into 
+ * an index (and positions) of its own, until some worker finds a docID 
+ * with no page; then the workers' indexes are merged into the index, 
+ * or, if any were written out, written out too, and their positions 
+ * into the positions. A worker may index pages past that docID before 
+ * it hears of it, so the merge, the document table, and the writing of 
+ * the positions drop them: the result is what indexPages would have built
+ *
+ * Returns the first docID with no page
+ */
+static int indexParallel(char* pageDirectory, int first, index_t** index, positions_t* positions, docmeta_t* meta,
+                         int numThreads, spill_t* spill) {
+  build_t build = { pageDirectory, spill, meta, positions != NULL, first, INT_MAX };
+  pthread_mutex_init(&build.lock, NULL);
+  worker_t* workers = mem_calloc_assert(numThreads, sizeof(worker_t), "workers");
+  int started = 0;
+  for (; started < numThreads; started++) {
+    workers[started].build = &build;
+    workers[started].index = mem_assert(index_new(), "worker index");
+    workers[started].positions = positions ? mem_assert(positions_new(), "worker positions") : NULL;
+    if (pthread_create(&workers[started].thread, NULL, workerMain, &workers[started]) != 0) {
+      index_delete(workers[started].index);
+      positions_delete(workers[started].positions);
+      break;
+    }
+  }
+  if (started == 0) {   // no threads to be had; index on this one
+    build.end = indexPages(pageDirectory, first, index, positions, meta, spill);
+  }
+  for (int i = 0; i < started; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  for (int i = 0; i < started; i++) {
+    if (spill != NULL && spill->numRuns > 0) {
+      writeRun(spill, workers[i].index);    // the run merge drops docIDs from build.end on
+    } else {
+      index_merge(*index, workers[i].index, build.end);
+    }
+    index_delete(workers[i].index);
+    if (positions != NULL && !positions_merge(positions, workers[i].positions)) {
+      fprintf(stderr, "out of memory merging the workers' positions\n");
+      exit(8);
+    }
+    positions_delete(workers[i].positions);
+  }
+  docmeta_truncate(meta, build.end - 1);
+  mem_free(workers);
+  pthread_mutex_destroy(&build.lock);
+  return build.end;
 }
 
-void indexPage(index_t* index, webpage_t* webpage, int docID) {
+/*********************** workerMain() ***********************/
+/* Takes the worker_t* of a worker thread of indexParallel
+ *
+ * Indexes pages into the worker's index until there are none left
+ */
+static void* workerMain(void* arg) {
+  worker_t* worker = arg;
+  build_t* build = worker->build;
+  for (;;) {
+    pthread_mutex_lock(&build->lock);
+    int docID = build->next < build->end ? build->next++ : -1;
+    pthread_mutex_unlock(&build->lock);
+    if (docID < 0) {
+      break;
+    }
+    webpage_t* webpage = pagedir_loadMapped(build->pageDirectory, docID);
+    if (webpage == NULL) {
+      // no such page: the build ends here, if not sooner
+      pthread_mutex_lock(&build->lock);
+      if (docID < build->end) {
+        build->end = docID;
+      }
+      pthread_mutex_unlock(&build->lock);
+      break;
+    }
+    indexPage(worker->index, worker->positions, webpage, docID);
+    worker->index = spillFull(build->spill, worker->index);
+    pthread_mutex_lock(&build->lock);
+    docmeta_add(build->meta, docID, webpage_getURL(webpage), webpage_getDepth(webpage), webpage_getHTMLLength(webpage));
+    pthread_mutex_unlock(&build->lock);
+    webpage_delete(webpage);
+  }
+  return NULL;
+}
+
+/*********************** indexPage() ***********************/
+/* Takes the index to add to, the positions to add to (or NULL), a 
+ * webpage, and its docID
+ *
+ * Adds each word of three or more letters on the page, normalized, 
+ * to the index under the docID, and, to the positions, where it is: 
+ * the number of words before it, short ones included, so that words 
+ * a short word apart are not next to each other
+ */
+void indexPage(index_t* index, positions_t* positions, webpage_t* webpage, int docID) {
   int pos = 0;
-  char* word;
-  while ((word = webpage_getNextWord(webpage, &pos)) != NULL) {
-    if (strlen(word) < 3) {
-      free(word);
-      continue;
+  const char* word;
+  size_t len;
+  // each word is a span of the page's html: nothing is allocated for the words skipped, and
+  // index_insertSpan normalizes the rest as it copies them
+  for (int position = 0; webpage_getNextSpan(webpage, &pos, &word, &len); position++) {
+    if (len >= 3) {
+      index_insertSpan(index, word, len, docID);
+      if (positions != NULL) {
+        positions_addSpan(positions, word, len, docID, position);
+      }
+    }
+  }
+}
+/*********************** spillStart() ***********************/
+/* Takes the indexFilename and the bytes each index being built may take
+ *
+ * Makes the temporary directory for the runs, next to indexFilename 
+ * rather than in /tmp, which is often in memory itself
+ *
+ * Returns the spill, or exits if the directory cannot be made
+ */
+static spill_t* spillStart(char* indexFilename, size_t budget) {
+  spill_t* spill = mem_calloc_assert(1, sizeof(spill_t), "spill");
+  spill->budget = budget;
+  spill->ok = true;
+  spill->directory = mem_malloc_assert(strlen(indexFilename) + 13, "run directory");
+  sprintf(spill->directory, "%s.runs-XXXXXX", indexFilename);
+  if (mkdtemp(spill->directory) == NULL) {
+    fprintf(stderr, "%s: cannot make a directory for the index's runs\n", spill->directory);
+    exit(8);
+  }
+  pthread_mutex_init(&spill->lock, NULL);
+  return spill;
+}
+
+/*********************** spillFull() ***********************/
+/* Takes the spill of a build with a memory budget (or NULL), and an 
+ * index being built
+ *
+ * If the index has reached the budget, writes it out as the next run
+ * and deletes it
+ *
+ * Returns the index to go on building: the same one, or a new one
+ */
+static index_t* spillFull(spill_t* spill, index_t* index) {
+  if (spill == NULL || index_size(index) < spill->budget) {
+    return index;
+  }
+  writeRun(spill, index);
+  index_delete(index);
+  return mem_assert(index_new(), "index");
+}
+
+/*********************** writeRun() ***********************/
+/* Takes the spill and an index
+ *
+ * Writes the index out as the next run: an index file, so its words 
+ * are in strcmp order, as the merge needs. Safe to call from any thread
+ */
+static void writeRun(spill_t* spill, index_t* index) {
+  pthread_mutex_lock(&spill->lock);
+  int run = spill->numRuns++;
+  pthread_mutex_unlock(&spill->lock);
+  char* filename = runFilename(spill, run);
+  bool written = index_write(index, filename);
+  free(filename);
+  if (!written) {
+    pthread_mutex_lock(&spill->lock);
+    spill->ok = false;
+    pthread_mutex_unlock(&spill->lock);
+  }
+}
+
+/*********************** mergeRuns() ***********************/
+/* Takes the spill, once every run is written, the indexFilename, and 
+ * the first docID to leave out
+ *
+ * Merges the runs into the index file, deleting each once merged; 
+ * MAX_MERGE at a time, into new runs, while there are more than that, 
+ * so that no more files than that are open at once
+ *
+ * Returns true if the index file was written
+ */
+static bool mergeRuns(spill_t* spill, char* indexFilename, int limit) {
+  char** filenames = mem_malloc_assert(MAX_MERGE * sizeof(char*), "run filenames");
+  int first = 0;    // the first run not yet merged
+  bool ok = spill->ok;
+  while (ok && first < spill->numRuns) {
+    int numFiles = spill->numRuns - first < MAX_MERGE ? spill->numRuns - first : MAX_MERGE;
+    for (int i = 0; i < numFiles; i++) {
+      filenames[i] = runFilename(spill, first + i);
+    }
+    bool last = first + numFiles == spill->numRuns;
+    char* merged = last ? indexFilename : runFilename(spill, spill->numRuns++);
+    ok = index_mergeFiles(filenames, numFiles, merged, limit);
+    for (int i = 0; i < numFiles; i++) {
+      remove(filenames[i]);
+      free(filenames[i]);
+    }
+    if (!last) {
+      free(merged);
+    }
+    first += numFiles;
+  }
+  mem_free(filenames);
+  return ok;
+}
+
+/*********************** runFilename() ***********************/
+/* Takes the spill and a run number
+ *
+ * Returns the name of the run's file, which the caller must free
+ */
+static char* runFilename(spill_t* spill, int run) {
+  // plain malloc, as in the common modules: workers call this
+  char* filename = malloc(strlen(spill->directory) + 16);
+  if (filename == NULL) {
+    fprintf(stderr, "out of memory naming a run\n");
+    exit(8);
+  }
+  sprintf(filename, "%s/%d", spill->directory, run);
+  return filename;
+}
+
+/*********************** spillEnd() ***********************/
+/* Takes the spill, or NULL
+ *
+ * Removes any runs left, and the directory, and frees the spill
+ */
+static void spillEnd(spill_t* spill) {
+  if (spill != NULL) {
+    for (int run = 0; run < spill->numRuns; run++) {
+      char* filename = runFilename(spill, run);
+      remove(filename);   // most are gone already
+      free(filename);
     }
-    normalizeWord(word);
-    index_insert(index, word, docID);
-    free(word);
+    rmdir(spill->directory);
+    pthread_mutex_destroy(&spill->lock);
+    mem_free(spill->directory);
+    mem_free(spill);
   }
-}
\ No newline at end of file
+}
@@ -3,7 +3,10 @@
  *
  * usage:
  *   2 command-line arguments for the oldIndexFilename that it reads from
- *      and the newIndexFilename which it writes the index into
+ *      and the newIndexFilename which it writes the index into, then
+ *      optionally --binary to write the binary index format, or --text
+ *      (the default) to write the text one; the old index may be either,
+ *      so that indextest converts between the two
  *   
  * Charlie Childress, February 2022
  * Used pseudocode from cs50 webpage
@@ -29,18 +32,27 @@ int main(const int argc, char* argv[]);
  *
  * load the index from the oldIndexFilename into an inverted-
  * index data structure. Then create a file newIndexFilename 
- * and write the index to that file
+ * and write the index to that file, in the format asked for
  *
  * Return 0 if everything in the program runs successfully, 
  * otherwise exit at non-zero integer to show error in the program
  */
 int main(const int argc, char* argv[]) {
-  // check argc to make sure the only arguments are oldIndexFilename and newIndexFilename
+  // check argc to make sure the only arguments are oldIndexFilename, newIndexFilename, and the format
   if (argc < 3) {
     // too few arguments, print error message to stderr
     fprintf(stderr, "usage: %s [indextest]: too few arguments\n", argv[0]);
     exit(1);  // non-zero exit to represent unsuccessful exit status
-  } else if (argc == 3) {   // correct number of arguments
+  } else if (argc <= 4) {   // correct number of arguments
+    bool binary = false;
+    if (argc == 4) {
+      if (strcmp(argv[3], "--binary") == 0) {
+        binary = true;
+      } else if (strcmp(argv[3], "--text") != 0) {
+        fprintf(stderr, "usage: %s [--binary | --text]; unknown index format\n", argv[3]);
+        exit(5);
+      }
+    }
     // load an index from the given parameters
     index_t* index = index_load(argv[1]);
     if (index == NULL) {  // if something went wrong with loading, print to stderr and exit
@@ -48,7 +60,7 @@ int main(const int argc, char* argv[]) {
       exit(2);
     }
     // write the index onto the new filename
-    if (!index_write(index, argv[2])) { // if something went wrong with loading, print to stderr and exit
+    if (!(binary ? index_writeBinary(index, argv[2]) : index_write(index, argv[2]))) { // if something went wrong with writing, print to stderr and exit
       fprintf(stderr, "usage: [index_write]: error when writing index onto newIndexFilename");
       exit(3);
     }
@@ -49,6 +49,112 @@
 # indexer letters depth 10
 ./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile5
 
+# indexer letters depth 10, with four threads; the index should match testFile5
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile6 -j 4
+cmp testFile5 testFile6
+
+# indexer letters depth 10, in runs of at most 16K each, with and without threads; both should match testFile5
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile6b --mem-budget 16K
+cmp testFile5 testFile6b
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile6c --mem-budget 16K -j 4
+cmp testFile5 testFile6c
+
+# indexer letters depth 10, appended as a segment, twice (the second adds nothing);
+# the segment, converted back to text, should match testFile5
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile6d --append
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile6d --append -j 4
+cat testFile6d
+./indextest testFile6d.0 testerFile6d
+cmp testFile5 testerFile6d
+
+# deleting a page from it: the querier finds the page for home before, and not after
+head -1 ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10/3 > deletedURLs
+echo home | ../querier/querier ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile6d | grep -F -f deletedURLs
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile6d --append --delete deletedURLs
+cat testFile6d
+echo home | ../querier/querier ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile6d | grep -F -f deletedURLs
+
+# --delete without --append
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 errorFile10 --delete deletedURLs
+
+# appending to an index that is not a manifest of segments
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile5 --append
+
+# letters depth 10 crawled two pages at a time, and appended as a segment after each run, so that
+# four segments are merged; the querier should answer as it does from the whole crawl indexed at once
+rm -rf testPages testFile10*
+mkdir testPages
+../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 10 -d 100 --max-pages 2
+./indexer testPages testFile10 --append
+for run in 2 3 4; do
+  ../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 10 -d 100 --resume --max-pages 2
+  ./indexer testPages testFile10 --append
+  cat testFile10
+done
+../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 10 -d 100 --resume
+./indexer testPages testFile10 --append
+cat testFile10
+./indexer testPages testFile10full
+printf 'home\nthe page\nsearch or transform\nbreadth and first\n' > testQueries
+../querier/querier testPages testFile10full < testQueries > testFile10full.out
+../querier/querier testPages testFile10 < testQueries > testFile10.out
+cmp testFile10full.out testFile10.out
+
+# deleting B, then fetching A and C again and appending each: the four segments are merged, leaving
+# out B and the old A and C, and then their tombstones (the manifest names none); the querier finds
+# one each of A and C for home, and no B, and the merged segment has no word that only B had
+echo http://cs50tse.cs.dartmouth.edu/tse/letters/B.html > deletedURLs
+./indexer testPages testFile10 --append --delete deletedURLs
+cat testFile10
+echo http://cs50tse.cs.dartmouth.edu/tse/letters/A.html > recrawlURLs
+../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 10 -d 100 --recrawl-list recrawlURLs
+./indexer testPages testFile10 --append
+echo http://cs50tse.cs.dartmouth.edu/tse/letters/C.html > recrawlURLs
+../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 10 -d 100 --recrawl-list recrawlURLs
+./indexer testPages testFile10 --append
+cat testFile10
+echo home | ../querier/querier testPages testFile10
+./indextest $(sed -n 2p testFile10 | cut -d ' ' -f 1) testerFile10
+grep breadth testerFile10
+
+# a new crawl in the same directory starts over at docID 1, so appending it to the index exits 12
+../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 10 -d 100 --max-pages 2
+./indexer testPages testFile10 --append
+
+# the same four segments, with the merge failing (a directory holds the name of its file), exits 8;
+# deleting B meanwhile also exits 8, as the merge fails again, but the deletion is in the manifest and
+# the querier finds no B for home; once the merge can go on, it leaves B out
+rm -rf testPages testFile14*
+mkdir testPages testFile14.4
+../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 10 -d 100 --max-pages 2
+./indexer testPages testFile14 --append
+for run in 2 3 4; do
+  ../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 10 -d 100 --resume --max-pages 2
+  ./indexer testPages testFile14 --append
+done
+echo http://cs50tse.cs.dartmouth.edu/tse/letters/B.html > deletedURLs
+./indexer testPages testFile14 --append --delete deletedURLs
+cat testFile14
+echo home | ../querier/querier testPages testFile14
+rmdir testFile14.4
+./indexer testPages testFile14 --append
+cat testFile14
+echo home | ../querier/querier testPages testFile14
+
+# with positions, for phrases: the same with 1 and 4 threads
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile7 --positions
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 testFile7j --positions -j 4
+cmp testFile7.pos testFile7j.pos
+
+# --positions with --append
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 errorFile11 --append --positions
+
+# invalid memory budget
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 errorFile5 --mem-budget 0
+
+# invalid number of threads
+./indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-10 errorFile4 -j 0
+
 ## indextest ##
 # indextest letters depth 0
 ./indextest testFile1 testerFile1
@@ -65,6 +171,25 @@
 # indextest letters depth 10
 ./indextest testFile5 testerFile5
 
+# convert letters depth 10 to the binary format and back; the round trip should match testFile5
+./indextest testFile5 testerFile5.bin --binary
+./indextest testerFile5.bin testerFile5.txt --text
+cmp testFile5 testerFile5.txt
+
+# a line with a word and no pairs is skipped, not the line after it: gamma should be loaded
+printf 'alpha 1 2 \nbeta\ngamma 3 4 \ndelta 5 6 \n' > testFile12
+./indextest testFile12 testerFile12
+cat testerFile12
+
+# the same in an index big enough (over 16 MB) to be loaded in chunks, in parallel; every
+# line with pairs should be loaded
+awk 'BEGIN { for (i = 0; i < 600000; i++) { printf "word%07d 1 2 3 4 5 6 \n", i; if (i % 3 == 0) printf "only%07d\n", i } }' > testFile13
+./indextest testFile13 testerFile13
+awk 'BEGIN { for (i = 0; i < 600000; i++) printf "word%07d 1 2  3 4  5 6 \n", i }' | cmp - testerFile13
+
+# unknown index format
+./indextest testFile5 errorFile5 --json
+
 
 ##### toscrape #####
 ## indexer ##
@@ -0,0 +1,174 @@
+/*
+ * tokenbench.c - CS50 tokenizer benchmark
+ *
+ * Times the tokenizer (webpage_getNextSpan) over every page of a
+ * crawler-produced pageDirectory with each kernel the CPU supports -
+ * scalar, SSE2, AVX2 - and, for comparison, webpage_getNextWord, which
+ * copies each word; checks that all of them find the same words.
+ * usage:
+ *   ./tokenbench pageDirectory [rounds]
+ *   where rounds (default 10) is how many times to tokenize each page
+ *
+ * output:
+ *   one line per kernel: its throughput in MB of html per second, and
+ *   the number of words it found
+ *   exits non-zero if any kernel disagrees with the scalar one
+ *
+ * Charlie Childress, February 2022
+ */
+
+#define _POSIX_C_SOURCE 199309L   // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "webpage.h"
+#include "pagedir.h"
+
+/**************** file-local global variables ****************/
+static const int MAX_ROUNDS = 100000;   // upper bound on the rounds argument
+
+/**************** local types ****************/
+// what one kernel found, and how long it took
+typedef struct result {
+  long words;                 // words found, over all pages and rounds
+  uint64_t checksum;          // of where those words are, to compare kernels
+  double seconds;
+} result_t;
+
+/**************** function prototypes ****************/
+int main(const int argc, char* argv[]);
+static result_t tokenize(webpage_t** pages, const int numPages, const int rounds, const bool copy);
+static double nowSeconds(void);
+
+/*********************** main() ***********************/
+/* Takes int argc for the number of command-line arguments and
+ * char* argv[] as a list of the command-line arguments
+ *
+ * loads every page of the pageDirectory, then tokenizes them with each
+ * kernel in turn and prints how fast each went
+ *
+ * Return 0 if every kernel found the same words, otherwise exit at
+ * non-zero integer to show error in the program
+ */
+int main(const int argc, char* argv[]) {
+  int rounds = 10;
+  char ignore;
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s pageDirectory [rounds]\n", argv[0]);
+    exit(1);
+  }
+  if (argc == 3 && (sscanf(argv[2], "%d%c", &rounds, &ignore) != 1 || rounds < 1 || rounds > MAX_ROUNDS)) {
+    fprintf(stderr, "usage: %s [rounds bounds [1, %d]]; improper number of rounds\n", argv[2], MAX_ROUNDS);
+    exit(2);
+  }
+  if (!pagedir_validate(argv[1])) {
+    fprintf(stderr, "usage: %s [pageDirectory]: directory is not a crawler directory\n", argv[1]);
+    exit(3);
+  }
+
+  // load every page up front, so that only tokenizing is timed
+  int numPages = 0;
+  int room = 64;
+  webpage_t** pages = malloc(room * sizeof(webpage_t*));
+  webpage_t* page;
+  size_t bytes = 0;
+  while (pages != NULL && (page = pagedir_loadMapped(argv[1], numPages + 1)) != NULL) {
+    if (numPages == room) {
+      webpage_t** more = realloc(pages, (room *= 2) * sizeof(webpage_t*));
+      if (more == NULL) {
+        webpage_delete(page);
+        break;
+      }
+      pages = more;
+    }
+    pages[numPages++] = page;
+    bytes += webpage_getHTMLLength(page);
+  }
+  if (pages == NULL || numPages == 0) {
+    fprintf(stderr, "%s: no pages to tokenize\n", argv[1]);
+    exit(4);
+  }
+  printf("%d pages, %zu bytes of html, %d rounds\n", numPages, bytes, rounds);
+
+  // the scalar kernel is the reference the others must agree with
+  const struct {
+    const char* name;
+    webpage_kernel_t kernel;
+    bool copy;
+  } runs[] = {
+    { "getNextWord", WEBPAGE_KERNEL_SCALAR, true },
+    { "scalar", WEBPAGE_KERNEL_SCALAR, false },
+    { "sse2", WEBPAGE_KERNEL_SSE2, false },
+    { "avx2", WEBPAGE_KERNEL_AVX2, false },
+  };
+  result_t reference = { 0, 0, 0 };
+  bool agree = true;
+  for (int i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+    if (webpage_setKernel(runs[i].kernel) != runs[i].kernel) {
+      printf("%-12s not supported here\n", runs[i].name);
+      continue;
+    }
+    result_t result = tokenize(pages, numPages, rounds, runs[i].copy);
+    if (i == 0) {
+      reference = result;
+    }
+    bool same = result.words == reference.words && result.checksum == reference.checksum;
+    agree = agree && same;
+    printf("%-12s %9.1f MB/s  %ld words%s\n", runs[i].name,
+           bytes * (double) rounds / result.seconds / 1e6, result.words / rounds,
+           same ? "" : "  MISMATCH");
+  }
+  webpage_setKernel(WEBPAGE_KERNEL_AUTO);
+
+  for (int i = 0; i < numPages; i++) {
+    webpage_delete(pages[i]);
+  }
+  free(pages);
+  pagedir_close(argv[1]);
+  exit(agree ? 0 : 5);
+}
+
+/*********************** tokenize() ***********************/
+/* Takes the pages, how many, the rounds to run, and whether to tokenize
+ * with webpage_getNextWord (which copies each word) rather than
+ * webpage_getNextSpan
+ *
+ * Returns the words found, a checksum of their positions and lengths,
+ * and the time taken
+ */
+static result_t tokenize(webpage_t** pages, const int numPages, const int rounds, const bool copy) {
+  result_t result = { 0, 0, 0 };
+  double start = nowSeconds();
+  for (int round = 0; round < rounds; round++) {
+    for (int i = 0; i < numPages; i++) {
+      int pos = 0;
+      const char* word;
+      size_t len;
+      char* copied;
+      while (copy ? (copied = webpage_getNextWord(pages[i], &pos)) != NULL
+                  : webpage_getNextSpan(pages[i], &pos, &word, &len)) {
+        if (copy) {
+          len = strlen(copied);
+          free(copied);
+        }
+        result.words++;
+        result.checksum = result.checksum * 31 + (uint64_t) pos * 7 + len;
+      }
+    }
+  }
+  result.seconds = nowSeconds() - start;
+  return result;
+}
+
+/*********************** nowSeconds() ***********************/
+/* Returns the time, in seconds, on a clock that only moves forward
+ */
+static double nowSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
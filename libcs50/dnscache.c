@@ -0,0 +1,155 @@
+/*
+ * dnscache.c - CS50 'dnscache' module
+ *
+ * see dnscache.h for more information.
+ *
+ * Charlie Childress, February 2022
+ */
+
+#define _GNU_SOURCE       // getaddrinfo
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include "dnscache.h"
+#include "hashtable.h"
+
+/**************** file-local global variables ****************/
+static const long TTL_SECONDS = 300;          // how long a resolved name is trusted
+static const long NEGATIVE_TTL_SECONDS = 30;  // how long a failed name is trusted
+
+// the cache is shared by every thread; 'lock' protects 'cache'
+static hashtable_t* cache = NULL;  // hostname -> dnsentry_t, created on first use
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**************** local types ****************/
+typedef struct dnsentry {
+  bool resolved;                  // false if the name did not resolve
+  struct sockaddr_storage addr;   // the address, with port 0
+  socklen_t addrlen;              // length of addr
+  long expires;                   // when to ask the resolver again
+} dnsentry_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static long now(void);
+static bool resolve(const char* hostname, dnsentry_t* entry);
+static void setPort(struct sockaddr_storage* addr, const int port);
+
+/**************** dnscache_lookup() ****************/
+/* see dnscache.h for description */
+bool
+dnscache_lookup(const char* hostname, const int port,
+                struct sockaddr_storage* addr, socklen_t* addrlen)
+{
+  if (hostname == NULL || addr == NULL || addrlen == NULL) {
+    return false;
+  }
+
+  // a fresh entry answers right away
+  pthread_mutex_lock(&lock);
+  if (cache == NULL) {
+    cache = hashtable_new(50);  // few hosts are expected; the crawler is limited to internal URLs
+  }
+  dnsentry_t* entry = hashtable_find(cache, hostname);
+  bool fresh = entry != NULL && entry->expires > now();
+  dnsentry_t found;
+  if (fresh) {
+    found = *entry;
+  }
+  pthread_mutex_unlock(&lock);
+
+  // otherwise ask the resolver, without holding the lock, and remember its answer
+  if (!fresh) {
+    resolve(hostname, &found);
+    pthread_mutex_lock(&lock);
+    entry = hashtable_find(cache, hostname);
+    if (entry == NULL) {
+      entry = malloc(sizeof(dnsentry_t));
+      if (entry != NULL && !hashtable_insert(cache, hostname, entry)) {
+        free(entry);
+        entry = NULL;
+      }
+    }
+    if (entry != NULL) {
+      *entry = found;
+    }
+    pthread_mutex_unlock(&lock);
+  }
+
+  if (!found.resolved) {
+    return false;
+  }
+  *addr = found.addr;
+  *addrlen = found.addrlen;
+  setPort(addr, port);
+  return true;
+}
+
+/**************** dnscache_clear() ****************/
+/* see dnscache.h for description */
+void
+dnscache_clear(void)
+{
+  pthread_mutex_lock(&lock);
+  hashtable_delete(cache, free);
+  cache = NULL;
+  pthread_mutex_unlock(&lock);
+}
+
+/**************** now() ****************/
+/* Return the current time in seconds, from a clock that never jumps.
+ */
+static long
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec;
+}
+
+/**************** resolve() ****************/
+/* Ask the resolver for the hostname's address, IPv4 or IPv6, taking
+ * the first one it suggests; fill in the entry either way.
+ * Return true if the name resolved.
+ */
+static bool
+resolve(const char* hostname, dnsentry_t* entry)
+{
+  struct addrinfo hints;
+  struct addrinfo* result;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;   // the resolver orders addresses by reachability
+
+  memset(entry, 0, sizeof(dnsentry_t));
+  if (getaddrinfo(hostname, NULL, &hints, &result) != 0) {
+    entry->resolved = false;
+    entry->expires = now() + NEGATIVE_TTL_SECONDS;
+    return false;
+  }
+  memcpy(&entry->addr, result->ai_addr, result->ai_addrlen);
+  entry->addrlen = result->ai_addrlen;
+  entry->resolved = true;
+  entry->expires = now() + TTL_SECONDS;
+  freeaddrinfo(result);
+  return true;
+}
+
+/**************** setPort() ****************/
+/* Set the port of an IPv4 or IPv6 address.
+ */
+static void
+setPort(struct sockaddr_storage* addr, const int port)
+{
+  if (addr->ss_family == AF_INET6) {
+    ((struct sockaddr_in6*) addr)->sin6_port = htons(port);
+  } else {
+    ((struct sockaddr_in*) addr)->sin_port = htons(port);
+  }
+}
@@ -0,0 +1,50 @@
+/*
+ * dnscache.h - header file for CS50 'dnscache' module
+ *
+ * The 'dnscache' remembers, for a limited time, the address that each
+ * hostname resolved to, so that fetching many pages from one server
+ * asks the system resolver only once in a while rather than once per
+ * page. Lookups use getaddrinfo, so IPv4 and IPv6 servers both work,
+ * and the cache is shared by every thread in the process: it is safe
+ * to call from several threads at once.
+ *
+ * Names that fail to resolve are remembered too, for a shorter time,
+ * so a crawl does not keep asking about a host that does not exist.
+ *
+ * Charlie Childress, February 2022
+ */
+
+#ifndef __DNSCACHE_H
+#define __DNSCACHE_H
+
+#include <stdbool.h>
+#include <sys/socket.h>
+
+/**************** functions ****************/
+
+/**************** dnscache_lookup ****************/
+/* Find the address of a server.
+ *
+ * Caller provides:
+ *   a hostname, a port, and where to store the address and its length.
+ * We return:
+ *   true, with *addr and *addrlen filled in (port included), if the
+ *   hostname resolves; false if it does not, or on bad parameters.
+ * We guarantee:
+ *   the resolver is asked only if the hostname is not in the cache, or
+ *   its entry is older than the time-to-live; the answer is cached.
+ */
+bool dnscache_lookup(const char* hostname, const int port,
+                     struct sockaddr_storage* addr, socklen_t* addrlen);
+
+/**************** dnscache_clear ****************/
+/* Forget every cached address and free the cache's memory.
+ *
+ * We guarantee:
+ *   a later dnscache_lookup starts over with an empty cache.
+ * Note:
+ *   call it once no other thread is using the cache, e.g., at exit.
+ */
+void dnscache_clear(void);
+
+#endif // __DNSCACHE_H
@@ -6,11 +6,20 @@
  * David Kotz - 2016, 2017, 2019, 2021
  */
 
+#define _GNU_SOURCE       // getline, getc_unlocked, fileno
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <sys/stat.h>
 #include "file.h"
 
+/**************** file-local global variables ****************/
+static const size_t BLOCK = 65536;   // bytes read at a time when the size is not known
+
+/**************** local functions ****************/
+static char* readBlocks(FILE* fp, size_t size, const size_t limit);
 
 /**************** file_numLines ****************/
 int
@@ -22,10 +31,12 @@ file_numLines(FILE* fp)
 
   rewind(fp);
 
+  // count the newlines a block at a time
   int nlines = 0;
-  char c = '\0';
-  while ( (c = fgetc(fp)) != EOF) {
-    if (c == '\n') {
+  char block[BUFSIZ];
+  size_t n;
+  while ((n = fread(block, 1, sizeof(block), fp)) > 0) {
+    for (char* p = block; (p = memchr(p, '\n', block + n - p)) != NULL; p++) {
       nlines++;
     }
   }
@@ -38,15 +49,61 @@ file_numLines(FILE* fp)
 /**************** utility stopfuncs ****************/
 // for use with readuntil()
 static int never(int c) { return (0); }
-static int isnewline(int c) { return (c == '\n'); }
 
 /**************** file_readFile ****************/
 /* See file.h for documentation. */
-char* file_readFile(FILE* fp) { return file_readUntil(fp, never); }
+char* 
+file_readFile(FILE* fp)
+{
+  if (fp == NULL) {
+    return NULL;
+  }
+
+  // for a regular file, the rest of it can be read in one go
+  size_t size = BLOCK;
+  struct stat st;
+  long at;
+  if (fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode)
+      && (at = ftell(fp)) >= 0 && st.st_size > at) {
+    size = st.st_size - at;
+  }
+  return readBlocks(fp, size, (size_t) -1);
+}
+
+/**************** file_readN ****************/
+/* See file.h for documentation. */
+char* 
+file_readN(FILE* fp, const size_t n)
+{
+  if (fp == NULL) {
+    return NULL;
+  }
+  return readBlocks(fp, n, n);
+}
 
 /**************** file_readLine ****************/
 /* See file.h for documentation. */
-char* file_readLine(FILE* fp) { return file_readUntil(fp, isnewline); }
+char* 
+file_readLine(FILE* fp)
+{
+  if (fp == NULL) {
+    return NULL;
+  }
+
+  // getline finds the newline in stdio's buffer, and grows its own geometrically
+  char* line = NULL;
+  size_t size = 0;
+  ssize_t len = getline(&line, &size, fp);
+  if (len < 0) {
+    // error, or EOF reached without reading anything
+    free(line);
+    return NULL;
+  }
+  if (len > 0 && line[len - 1] == '\n') {
+    line[len - 1] = '\0';   // the newline is discarded
+  }
+  return line;
+}
 
 /**************** readword ****************/
 /* See file.h for documentation. */
@@ -57,28 +114,35 @@ char* file_readWord(FILE* fp) { return file_readUntil(fp, isspace); }
 char* 
 file_readUntil(FILE* fp, int (*stopfunc)(int c))
 {
+  if (fp == NULL) {
+    return NULL;
+  }
   if (stopfunc == NULL) {
     stopfunc = never;
   }
 
   // allocate buffer big enough for "typical" words/lines
-  int len = 81;
+  size_t len = 81;
   char* buf = malloc(len * sizeof(char));
   if (buf == NULL) {
     return NULL;
   }
 
   // Read characters from file until stop-character or EOF, 
-  // expanding the buffer when needed to hold more.
-  int pos;
-  char c;
-  for (pos = 0; (c = fgetc(fp)) != EOF && !(*stopfunc)(c); pos++) {
+  // doubling the buffer when needed to hold more.
+  // The stream is locked once, so each character costs no more than a 
+  // look into stdio's buffer.
+  size_t pos;
+  int c;
+  flockfile(fp);
+  for (pos = 0; (c = getc_unlocked(fp)) != EOF && !(*stopfunc)(c); pos++) {
     // We need to save buf[pos+1] for the terminating null
     // and buf[len-1] is the last usable slot, 
     // so if pos+1 is past that slot, we need to grow the buffer.
     if (pos+1 > len-1) {
-      char* newbuf = realloc(buf, ++len * sizeof(char));
+      char* newbuf = realloc(buf, (len *= 2) * sizeof(char));
       if (newbuf == NULL) {
+        funlockfile(fp);
         free(buf);
         return NULL;
       } else {
@@ -87,6 +151,7 @@ file_readUntil(FILE* fp, int (*stopfunc)(int c))
     }
     buf[pos] = c;
   }
+  funlockfile(fp);
 
   if (pos == 0 && c == EOF) {
     // no characters were read and we reached EOF
@@ -99,6 +164,56 @@ file_readUntil(FILE* fp, int (*stopfunc)(int c))
   }
 }
 
+/**************** readBlocks ****************/
+/* Read up to limit bytes, or to EOF, with fread, into a null-terminated
+ * string; size is how many bytes to expect, and the buffer doubles if
+ * more come.
+ * Returns NULL if error, or EOF reached without reading anything.
+ */
+static char*
+readBlocks(FILE* fp, size_t size, const size_t limit)
+{
+  if (size > limit) {
+    size = limit;
+  }
+  char* buf = malloc(size + 1);
+  if (buf == NULL) {
+    return NULL;
+  }
+
+  size_t len = 0;
+  for (;;) {
+    size_t want = size - len;
+    size_t n = fread(buf + len, 1, want, fp);
+    len += n;
+    if (n < want || len == limit) {
+      break;    // EOF or error, or all that was asked for
+    }
+    // the buffer is full; if there is more, grow it geometrically, but not past the limit
+    int c = getc(fp);
+    if (c == EOF) {
+      break;
+    }
+    size_t newsize = size < limit / 2 ? (size > 0 ? size * 2 : BLOCK) : limit;
+    char* newbuf = realloc(buf, newsize + 1);
+    if (newbuf == NULL) {
+      free(buf);
+      return NULL;
+    }
+    buf = newbuf;
+    size = newsize;
+    buf[len++] = c;
+  }
+
+  if (len == 0 || ferror(fp)) {
+    // error, or no characters were read and we reached EOF
+    free(buf);
+    return NULL;
+  }
+  buf[len] = '\0';
+  return buf;
+}
+
 /* ********************************************************** */
 /* a simple unit test of the code above */
 #ifdef QUICKTEST
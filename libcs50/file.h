@@ -8,6 +8,7 @@
 #define __FILE_H
 
 #include <stdio.h>
+#include <stddef.h>
 
 /**************** file_numLines ****************/
 /* Returns the number of lines in the given file,
@@ -36,9 +37,19 @@ char* file_readUntil(FILE* fp,    int (*stopfunc)(int c) );
  * and return a pointer to it; caller must later free() the pointer.
  * Returns NULL if error, or if EOF reached without reading anything.
  * After the call, file pointer is at EOF.
+ * A regular file is read in one block, sized by its length.
  */
 char* file_readFile(FILE* fp);
 
+/**************** file_readN ****************/
+/* 
+ * Read up to n bytes from the file, or to EOF, into a null-terminated
+ * string, and return a pointer to it; caller must later free() the pointer.
+ * For when the length is known beforehand, e.g., from a Content-Length.
+ * Returns NULL if error, or if EOF reached without reading anything.
+ */
+char* file_readN(FILE* fp, const size_t n);
+
 /**************** file_readLine ****************/
 /* 
  * Read a line from the file into a null-terminated string,
@@ -37,6 +37,7 @@ typedef struct webpage webpage_t;
 int   webpage_getDepth(const webpage_t* page);
 char* webpage_getURL(const webpage_t* page);
 char* webpage_getHTML(const webpage_t* page);
+size_t webpage_getHTMLLength(const webpage_t* page);
 
 /**************** webpage_new ****************/
 /* Allocate and initialize a new webpage_t structure.
@@ -62,6 +63,30 @@ char* webpage_getHTML(const webpage_t* page);
  */
 webpage_t* webpage_new(char* url, const int depth, char* html);
 
+/**************** webpage_newView ****************/
+/* Allocate and initialize a webpage_t whose html is a read-only view of
+ * memory the page does not own, e.g., a page file mapped with mmap.
+ *
+ * Caller provides:
+ *   url   must be a non-null pointer to malloc'd memory, as for webpage_new.
+ *   depth must be non-negative.
+ *   html  must be non-null; it need NOT be null-terminated.
+ *   len   the number of bytes of html.
+ *   release, if not NULL, is called as release(arg) by webpage_delete,
+ *         e.g., to unmap the html; otherwise html must outlive the page.
+ *
+ * We return:
+ *   pointer to new webpage_t, or NULL on any error.
+ *
+ * IMPORTANT:
+ *   html is never written or free()d by the webpage module. Callers of
+ *   webpage_getHTML on such a page must not write to it, nor assume a
+ *   '\0' after it: use webpage_getHTMLLength. webpage_getNextWord,
+ *   webpage_getNextURL, and webpage_iterateURLs all work on views.
+ */
+webpage_t* webpage_newView(char* url, const int depth, const char* html, const size_t len,
+                           void (*release)(void* arg), void* arg);
+
 /**************** webpage_delete ****************/
 /* Delete a webpage_t structure created by webpage_new().
  *
@@ -70,7 +95,9 @@ webpage_t* webpage_new(char* url, const int depth, char* html);
  *   (parameter is void* so this function can be used as an itemdelete()).
  *
  * IMPORTANT:
- *   we call free() on both the url and the html, if not NULL.
+ *   we call free() on both the url and the html, if not NULL; for a
+ *   page made by webpage_newView, we call its release function instead
+ *   of free()ing the html.
  */
 void webpage_delete(void* data);
 
@@ -106,6 +133,23 @@ void webpage_delete(void* data);
  */
 bool webpage_fetch(webpage_t* page);
 
+/***************** webpage_setHTML ******************************/
+/* store html, fetched by some means other than webpage_fetch, into page->html
+ *
+ * Caller provides
+ *   page, a valid webpage_t* whose page->html is NULL, and
+ *   html, a null-terminated string in malloc'd memory, and
+ *   len, the length of html, i.e., strlen(html).
+ *
+ * We return:
+ *   true if html was stored; false if page is NULL or already has html.
+ *
+ * IMPORTANT:
+ *   on success the webpage module adopts html, as with webpage_new,
+ *   and will free() it in webpage_delete().
+ */
+bool webpage_setHTML(webpage_t* page, char* html, const size_t len);
+
 
 /**************** webpage_getNextWord ***********************************/
 /* return the next word from page->html[pos]
@@ -119,8 +163,8 @@ bool webpage_fetch(webpage_t* page);
  * We return:
  *   pointer to string containing the next word, if any; otherwise NULL.
  * 
- * Side effect:
- *   page->html will be compressed to remove white space.
+ * page->html is not modified, and is read only up to its length, so
+ * it need not be null-terminated (see webpage_newView).
  *
  * Caller is responsible for:
  *   later free()ing the string returned.
@@ -137,6 +181,65 @@ bool webpage_fetch(webpage_t* page);
 
 char* webpage_getNextWord(webpage_t* page, int* pos);
 
+/**************** webpage_getNextSpan ***********************************/
+/* find the next word in page->html[pos], without copying it
+ *
+ * Caller provides
+ *   page: pointer to valid webpage_t with page->html not NULL.
+ *   pos: as for webpage_getNextWord; after return, *pos is the index
+ *        after the word found.
+ *   word, wordLen: where to put the word found.
+ *
+ * We return:
+ *   true if there is another word, with *word pointing at it in
+ *   page->html and *wordLen its length; otherwise false.
+ *
+ * The words are those webpage_getNextWord returns, but nothing is
+ * allocated: *word is NOT null-terminated, and is valid only as long
+ * as the page's html. page->html is not modified.
+ *
+ * Usage example: (count the words of three or more letters in a page)
+ * int pos = 0;
+ * const char* word;
+ * size_t len;
+ * int count = 0;
+ *
+ * while (webpage_getNextSpan(page, &pos, &word, &len)) {
+ *     if (len >= 3) count++;
+ * }
+ */
+bool webpage_getNextSpan(const webpage_t* page, int* pos, const char** word, size_t* wordLen);
+
+/**************** webpage_setKernel ***********************************/
+/* choose how webpage_getNextWord and webpage_getNextSpan scan the html
+ *
+ * The tokenizer finds the ends of words and tags by classifying bytes
+ * as letters, '<', or '>': on x86-64, 16 (SSE2) or 32 (AVX2) bytes at
+ * a time with vector instructions, elsewhere one at a time. Every
+ * kernel finds the same words; the choice matters only for speed,
+ * e.g., to compare them in a benchmark.
+ *
+ * Caller provides:
+ *   kernel: the one to use; WEBPAGE_KERNEL_AUTO, the default, is SSE2
+ *   on x86-64 (AVX2 is no faster on typical html, where words are
+ *   short) and scalar elsewhere.
+ *
+ * We return:
+ *   the kernel now in use: the one asked for, or the best supported
+ *   one below it if the CPU lacks it; for WEBPAGE_KERNEL_AUTO, the
+ *   kernel it stands for.
+ *
+ * Call it before any thread tokenizes pages.
+ */
+typedef enum webpage_kernel {
+  WEBPAGE_KERNEL_AUTO,
+  WEBPAGE_KERNEL_SCALAR,
+  WEBPAGE_KERNEL_SSE2,
+  WEBPAGE_KERNEL_AVX2,
+} webpage_kernel_t;
+
+webpage_kernel_t webpage_setKernel(const webpage_kernel_t kernel);
+
 /****************** webpage_getNextURL ***********************************/
 /* return the next url from page->html[pos]
  *
@@ -148,13 +251,15 @@ char* webpage_getNextWord(webpage_t* page, int* pos);
  *
  * We return:
  *   pointer to string containing the next URL, if any; otherwise NULL.
- *
- * Side effect:
- *   page->html will be compressed to remove white space.
+ *   Only http(s) links are returned, without any #fragment; relative
+ *   links are resolved against page->url.
  *
  * Caller is responsible for:
  *   later free()ing the string returned.
  *
+ * page->html is not modified. To get every URL on a page, 
+ * webpage_iterateURLs is simpler.
+ *
  * Known bugs:
  *   Does not work well on directory-type URLs like
  *      http://cs50tse.cs.dartmouth.edu/tse/letters
@@ -173,6 +278,25 @@ char* webpage_getNextWord(webpage_t* page, int* pos);
 
 char* webpage_getNextURL(webpage_t* page, int* pos);
 
+/****************** webpage_iterateURLs **********************************/
+/* pass every url in page->html to a function, in one pass over the html
+ *
+ * Caller provides:
+ *   page: pointer to valid webpage_t with page->html not NULL.
+ *   arg: passed through to urlfunc.
+ *   urlfunc: called as urlfunc(arg, url) on each URL, in the order they
+ *            appear; the URLs are as webpage_getNextURL returns them.
+ *
+ * We return:
+ *   the number of URLs passed to urlfunc; 0 on bad parameters.
+ *
+ * Caller is responsible for:
+ *   free()ing, in urlfunc or later, each url passed to urlfunc.
+ *
+ * page->html is not modified.
+ */
+int webpage_iterateURLs(webpage_t* page, void* arg, void (*urlfunc)(void* arg, char* url));
+
 /***********************************************************************
  * normalizeURL - returns a normalized form of the url
  *
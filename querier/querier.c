@@ -6,8 +6,11 @@
  * Querier, and answers search queries submitted via stdin.
  * usage:
  *   2 command-line arguments for the pageDirectory produced by crawler 
- *   and indexFilename produced by the Indexer
- *   Then reads searches from stdin, one per line, until EOF
+ *   and indexFilename produced by the Indexer (an index file, or the
+ *   manifest of an index built in segments with --append)
+ *   Then reads searches from stdin, one per line, until EOF; words in
+ *   double quotes are a phrase, which the indexer must have written
+ *   the positions of (with --positions)
  *
  * output:
  *   print a ordered query, nothing, or an error based on input
@@ -22,29 +25,32 @@
 #include <dirent.h>
 #include <unistd.h> 
 #include <ctype.h>
-#include "counters.h"
 #include "file.h"
-#include "hashtable.h"
 #include "mem.h"
 #include "webpage.h"
 #include "pagedir.h"
 #include "index.h"
+#include "postings.h"
 #include "word.h"
+#include "docmeta.h"
+#include "segments.h"
+#include "positions.h"
 
 /**************** file-local global variables ****************/
 /* none */
 
 /**************** local types ****************/
-// struct for two counters to 
-struct allcounters {
-  counters_t* ctrs1;
-  counters_t* ctrs2;
+// a document that matches the query, and its score, for ranking
+struct match {
+  int docID;
+  int score;
 };
 
-// struct for the array of counters 
-struct array {
-  counters_t** countersarray;
-  int* size;
+// where printIterate finds a document's URL: the document table of its
+// segment of the index, or if there is none, the pageDirectory
+struct docs {
+  segments_t* segs;
+  char* pageDirectory;
 };
 
 /**************** global types ****************/
@@ -53,33 +59,37 @@ struct array {
 /**************** global functions ****************/
 /* that is, visible outside this file */
 int main(const int argc, char* argv[]);
-bool querier(index_t* index, char* pageDirectory);
+bool querier(segments_t* segs, positions_t* positions, char* pageDirectory);
 bool verifyString(char* query);
-char** tokenize(char* query, int* size);
-bool verifyArray(char** wordArray, int size);
-counters_t* querySequence(char** wordArray, int size, hashtable_t* ht);
-counters_t* andSequence(char** wordArray, int firstIndex, int lastIndex, hashtable_t* ht);
-counters_t* intersection(counters_t* ctrs1, counters_t* ctrs2);
-counters_t* combination(counters_t* ctrs1, counters_t* ctrs2, bool free);
+char** tokenize(char* query, int* size, bool** literal);
+bool verifyArray(char** wordArray, bool* literal, int size);
+postings_t* querySequence(char** wordArray, bool* literal, int size, segments_t* segs, positions_t* positions);
+postings_t* andSequence(char** wordArray, bool* literal, int firstIndex, int lastIndex, segments_t* segs,
+                        positions_t* positions);
+postings_t* phraseSequence(char* phrase, segments_t* segs, positions_t* positions);
+postings_t* intersection(postings_t* postings1, postings_t* postings2);
+postings_t* combination(postings_t* postings1, postings_t* postings2, bool free);
 int fileno(FILE *stream);
 
 /**************** local functions ****************/
 /* not visible outside this file */
-static void docsIterate(void *arg, const int key, const int count);
-static void countersArrayIterate(void* arg, const int key, const int count);
-static void countersCountersIterate(void *arg, const int key, const int count);
-static void combinationIterate(void* arg, const int key, const int count);
-static void intersectionIterate(void* arg, const int key, const int count);
-static void printArray(struct array* arrayPrint, char* pageDirectory);
+static bool isOperator(char** wordArray, bool* literal, int i, const char* operator);
+static postings_t* lookupToken(char* token, segments_t* segs, positions_t* positions);
+static int lengthCompare(const void* a, const void* b);
+static int matchCompare(const void* a, const void* b);
+static void printArray(postings_t* result, struct docs* docs);
 static void printIterate(void* arg, const int key, const int count);
-static void deleteArray(struct array* arrayDel);
 
 /*********************** main() ***********************/
 /* Takes int argc for the number of command-line arguments and 
  * char* argv[] as a list of the command-line arguments
  *
- * parses arguments and make sure they are valid and then loads
- * index from indexFilename into an internal data structure
+ * parses arguments and make sure they are valid and then opens the
+ * index from indexFilename: maps each segment its manifest lists, or
+ * maps the index file, if it is binary, or else loads it into
+ * an internal data structure, with the document table
+ * indexFilename.meta, if the indexer wrote one, and maps the words'
+ * positions, indexFilename.pos, if the indexer wrote them;
  * calls querier, once done, the memory is freed;
  *
  * Return 0 if everything in the program runs successfully, 
@@ -121,21 +131,30 @@ int main(const int argc, char* argv[]) {
     strcpy(pageDirectory, argv[1]);
     strcpy(indexFilename, argv[2]);
 
-    // loads index from indexFilename into an internal data structure
-    index_t* index = index_load(indexFilename);
-    if (index == NULL) {
-      fprintf(stderr, "usage: [index_load]: error loading the index\n");
-      index_delete(index);
+    // map the index's segments, to search them in place, and their document tables, so that
+    // printing a result reads no page file; an index that is not binary is loaded into an internal data structure
+    segments_t* segs = segments_open(indexFilename);
+    if (segs == NULL) {
+      fprintf(stderr, "usage: [segments_open]: error loading the index\n");
       exit(5);
     }
 
+    // the positions, for phrases, are optional: without them, a query with a phrase is an error
+    char* posFilename = mem_malloc_assert(strlen(indexFilename) + 5, "posFilename");
+    sprintf(posFilename, "%s.pos", indexFilename);
+    positions_t* positions = positions_map(posFilename);
+    mem_free(posFilename);
+
     // run querier method, if it does not work at some point and returns false, delete the index and return an error
-    if(!querier(index, pageDirectory)) {
+    if(!querier(segs, positions, pageDirectory)) {
       fprintf(stderr, "usage: [querier]: error with querier\n");
-      index_delete(index);
+      segments_close(segs);
+      positions_delete(positions);
       exit(6);
     }
-    index_delete(index);
+    segments_close(segs);
+    positions_delete(positions);
+    pagedir_close(pageDirectory);
     free(pageDirectory);
     free(indexFilename);
   } else {
@@ -148,9 +167,11 @@ int main(const int argc, char* argv[]) {
 }
 
 /*********************** querier() ***********************/
-/* takes the index_t* index that we will use to find out 
- * the documents that match the query and char* pageDirectory
- * which is the crawler directory that we get our documents from
+/* takes the segments_t* segs of the index that we will use to find
+ * out the documents that match the query, with their URLs (if the
+ * indexer wrote them), the positions_t* positions of its words (or
+ * NULL), for phrases, and char* pageDirectory which is the 
+ * crawler directory that we get our documents from otherwise
  *
  * load the hashtable from the index. Then make sure the query
  * is good. Once checked, turn the query into an array of words
@@ -160,15 +181,9 @@ int main(const int argc, char* argv[]) {
  * returns a true that everything in the method and the subsequent
  * methods was successful, return false otherwise
  */
-bool querier(index_t* index, char* pageDirectory) {
+bool querier(segments_t* segs, positions_t* positions, char* pageDirectory) {
   // make sure all of the parameters are good
-  if (index == NULL || pageDirectory == NULL) {
-    return false;
-  }
-
-  // load in the hashtable from the index
-  hashtable_t* ht = index_get_hashtable(index);
-  if (ht == NULL) {
+  if (segs == NULL || pageDirectory == NULL) {
     return false;
   }
 
@@ -177,13 +192,12 @@ bool querier(index_t* index, char* pageDirectory) {
     printf("Query? ");
   }
 
+  struct docs docs = { segs, pageDirectory };
   char* query;
   int size;
   char** wordArray;
-  counters_t* ctrs1;
-  int countersSize;
-  counters_t** countersArray;
-  int arraySize;
+  bool* literal;      // whether each token was quoted, and so is a word even if it is "and" or "or"
+  postings_t* result;
 
   // keep reading each line of stdin until EOF is reached
   while ((query = file_readLine(stdin)) != NULL) {
@@ -199,7 +213,7 @@ bool querier(index_t* index, char* pageDirectory) {
       // use a int* for the size of the array
       size = 0;
       // tokenize the query and create an array out of it
-      wordArray = tokenize(query, &size);
+      wordArray = tokenize(query, &size, &literal);
       // if wordArray is NULL, free the memory and move on to the next query
       if (wordArray == NULL) {
         fprintf(stderr, "Error: issue when tokenizing query\n");
@@ -213,45 +227,47 @@ bool querier(index_t* index, char* pageDirectory) {
         // if not, reprint the query prompty and go to the next query
         printf("Query: ");
         for (int i = 0; i < size; i++) {
-          printf("%s ", wordArray[i]);
+          printf(literal[i] ? "\"%s\" " : "%s ", wordArray[i]);
         }
         printf("\n");
       }
+      // a phrase can only be found in the positions of the words, if the indexer wrote them
+      bool phrase = false;
+      for (int i = 0; i < size; i++) {
+        phrase = phrase || strchr(wordArray[i], ' ') != NULL;
+      }
+      if (phrase && positions == NULL) {
+        fprintf(stderr, "Error: phrases need an index built with --positions\n");
+      }
       // now verify that the array is good
-      if (!verifyArray(wordArray, size)) {
+      if ((phrase && positions == NULL) || !verifyArray(wordArray, literal, size)) {
         // if not, reprint the query prompty and go to the next query and free the memory
         if (isatty(fileno(stdin))) {
         printf("Query? ");
         }
         free(wordArray);
+        free(literal);
         free(query);
         continue;
       } else {
-        ctrs1 = querySequence(wordArray, size, ht);
-        if (ctrs1 == NULL) {
+        result = querySequence(wordArray, literal, size, segs, positions);
+        if (result == NULL) {
           // if NULL, reprint the query prompty and go to the next query
           if (isatty(fileno(stdin))) {
           printf("Query? ");
           }
-          counters_delete(ctrs1);
           free(wordArray);
+          free(literal);
           free(query);
           continue;
         }
-        countersSize = 0;
-        counters_iterate(ctrs1, &countersSize, docsIterate); // get total docIDS
-        countersArray = mem_malloc(countersSize * sizeof(counters_t*));
-        arraySize = 0;
-        struct array array = { countersArray, &arraySize };
-        counters_iterate(ctrs1, &array, countersArrayIterate);  // order the counters
-        printArray(&array, pageDirectory);
-        counters_delete(ctrs1);
-        deleteArray(&array);
-        free(countersArray);
+        printArray(result, &docs);   // rank the matches and print them
+        postings_delete(result);
       }
     }
     // free the memory and move on to the next query
     free(wordArray);
+    free(literal);
     free(query);
     if (isatty(fileno(stdin))) {
       printf("Query? ");
@@ -264,11 +280,11 @@ bool querier(index_t* index, char* pageDirectory) {
 /* Takes a char* which represents a query
  *
  * loop through every character in the query to make sure that 
- * it consists of only letters and spaces with no other erroneous
- * characters
+ * it consists of only letters, spaces, and the double quotes of
+ * phrases with no other erroneous characters
  *
- * Return false if any character is not a space or letter. If 
- * every character is checked and there are no errors, return 
+ * Return false if any character is not a space, letter, or quote. 
+ * If every character is checked and there are no errors, return 
  * true
  */
 bool verifyString(char* query) {
@@ -283,6 +299,8 @@ bool verifyString(char* query) {
         continue;               // check the next character
       } else if (isspace(query[i])) {  // if the charcater is a space...
         continue;                      // check the next letter
+      } else if (query[i] == '"') {    // if the character starts or ends a phrase...
+        continue;                      // tokenize pairs them up
       } else {
         fprintf(stderr, "Error: bad character '%c' in query\n", __toascii(query[i])); // give error message to stdout if a character is bad
         return false;   // if there is a bad character, the query is bad, return false
@@ -297,9 +315,17 @@ bool verifyString(char* query) {
  * int* which is a pointer that will track how large the 
  * wordArray is for later methods
  *
- * 
+ * Splits the query, in place, into its words, normalized; the words
+ * between a double quote and the next (or the end of the query, if
+ * there is no next) are one token, a phrase: its words, normalized,
+ * one space apart. A phrase of one word is just that word. Sets
+ * *literal to an array, parallel to the tokens, of whether each was
+ * quoted: a quoted "and" or "or" is a word to look up, not an operator
+ *
+ * Return the array of tokens, which point into the query
  */
-char** tokenize(char* query, int* size) {
+char** tokenize(char* query, int* size, bool** literal) {
+  *literal = NULL;
   if (query == NULL) {
     fprintf(stderr, "Error: NULL query\n");
     return NULL;
@@ -307,20 +333,51 @@ char** tokenize(char* query, int* size) {
   char* word;
   bool wordBuild = false;
   char** wordArray = mem_malloc_assert(sizeof(query) * 100, "Error: cannot allocate memory for query");
+  *literal = mem_malloc_assert(sizeof(bool) * 100, "Error: cannot allocate memory for query");
   int wordIndex = 0;
   int length = strlen(query);
   for (int i = 0; i < length; i++) {
-    if (!wordBuild && isalpha(query[i])) {
+    if (query[i] == '"') {
+      if (wordBuild) {    // a quote ends a word, as a space does
+        query[i] = '\0';
+        (*literal)[wordIndex] = false;
+        wordArray[wordIndex++] = normalizeWord(word);
+        wordBuild = false;
+      }
+      // copy the phrase's words down, a space apart, over what is between them: a space is
+      // only copied in place of one skipped, so nothing is copied past where it is read
+      int start = i + 1;
+      int at = start;
+      bool gap = false;   // whether a space goes before the next letter
+      for (i++; i < length && query[i] != '"'; i++) {
+        if (isalpha(query[i])) {
+          if (gap && at > start) {
+            query[at++] = ' ';
+          }
+          query[at++] = tolower(query[i]);
+          gap = false;
+        } else {
+          gap = true;
+        }
+      }
+      query[at] = '\0';    // at most where the closing quote was
+      if (at > start) {     // "" is nothing
+        (*literal)[wordIndex] = true;
+        wordArray[wordIndex++] = &query[start];
+      }
+    } else if (!wordBuild && isalpha(query[i])) {
       word = &query[i];
       wordBuild = true;
     } else if (wordBuild && isspace(query[i])) {
       query[i] = '\0';
+      (*literal)[wordIndex] = false;
       wordArray[wordIndex] = normalizeWord(word);
       wordIndex++;
       wordBuild = false;
     }
   }
   if (wordBuild) {
+    (*literal)[wordIndex] = false;
     wordArray[wordIndex] = normalizeWord(word);
     wordIndex++;
   }
@@ -330,41 +387,42 @@ char** tokenize(char* query, int* size) {
 }
 
 /*********************** verifyArray() ***********************/
-/* Takes a char** wordArray which is a string to represent the query
- * and int size for the size of the string
+/* Takes a char** wordArray which is a string to represent the query,
+ * bool* literal for which of its tokens were quoted, and int size for
+ * the size of the string
  *
  * make sure the literal 'and' comes between words, and the literal 
  * 'or' must come between andsequences, so they cannot appear at the 
  * beginning or end of a query. Also check that the literals ('and' & 'or') 
- * are not  adjacent
+ * are not  adjacent. A quoted 'and' or 'or' is a word, and may go anywhere
  *
  * if there are any errors or improper formatting, print an error
  * message to stdout and return false. If no errors are found, return
  * true
  */
-bool verifyArray(char** wordArray, int size) {
+bool verifyArray(char** wordArray, bool* literal, int size) {
   // make sure the wordArray is not NULL and there is a positive size
   if(wordArray == NULL || size <= 0) {
     fprintf(stderr, "Error: NULL query\n");
     return false;
   }
 
-  if (strcmp(wordArray[0], "and") == 0) {
+  if (isOperator(wordArray, literal, 0, "and")) {
     fprintf(stderr, "Error: 'and' cannot be first\n");
     return false;
-  } else if (strcmp(wordArray[0], "or") == 0) {
+  } else if (isOperator(wordArray, literal, 0, "or")) {
     fprintf(stderr, "Error: 'or' cannot be first\n");
     return false;
-  } else if (strcmp(wordArray[size - 1], "and") == 0) {
+  } else if (isOperator(wordArray, literal, size - 1, "and")) {
     fprintf(stderr, "Error: 'and' cannot be last\n");
     return false;
-  } else if (strcmp(wordArray[size - 1], "or") == 0) {
+  } else if (isOperator(wordArray, literal, size - 1, "or")) {
     fprintf(stderr, "Error: 'or' cannot be last\n");
     return false;
   } else {
     for(int i = 1; i < size - 1; i++) {
-      if(strcmp(wordArray[i], "and") == 0 || strcmp(wordArray[i], "or") == 0) {
-        if(strcmp(wordArray[i + 1], "and") == 0 || strcmp(wordArray[i + 1], "or") == 0) {
+      if(isOperator(wordArray, literal, i, "and") || isOperator(wordArray, literal, i, "or")) {
+        if(isOperator(wordArray, literal, i + 1, "and") || isOperator(wordArray, literal, i + 1, "or")) {
           fprintf(stderr, "Error: '%s' and '%s' cannot be adjacent\n", wordArray[i], wordArray[i + 1]);
           return false;
         }
@@ -376,261 +434,277 @@ bool verifyArray(char** wordArray, int size) {
 
 /*********************** querySequence() ***********************/
 /* Takes the char** wordArray for the query that is being evaluated,
- * the int size for the number of words or indices in the array, and
- * the hashtable_t* ht from indexer
+ * with bool* literal for which of its tokens were quoted, the int
+ * size for the number of words or indices in the array, and
+ * the segments_t* segs of the index from indexer, with the 
+ * positions_t* positions of its words (or NULL)
  *
  * Go through each word, using the combination method to add it to the
- * total counter until there is an "or" then create a separate counter
+ * total postings until there is an "or" then create separate postings
  * for the words after the "or" so we can compare them
  *
- * return the totalCounter that contains all documents that match the 
- * query and their counters
+ * return the total postings that contains all documents that match the 
+ * query and their scores
  */
-counters_t* querySequence(char** wordArray, int size, hashtable_t* ht) {
+postings_t* querySequence(char** wordArray, bool* literal, int size, segments_t* segs, positions_t* positions) {
   // make sure none of the parameters are empty
-  if (wordArray == NULL || size < 0 || ht == NULL) {
+  if (wordArray == NULL || size < 0 || segs == NULL) {
     return NULL;
   }
-  counters_t* totalCounter = mem_assert(counters_new(), "totalCounter");
+  postings_t* total = mem_assert(postings_new(), "total");
   int orAppearance = -1; //start out not in the array
   for(int i = 0; i < size; i++) {
-    if(strcmp(wordArray[i], "or") == 0) {
-      // have total counter be the sequence of words before the current "or"
-      totalCounter = combination(totalCounter, andSequence(wordArray, orAppearance+1, i, ht), true);
+    if(isOperator(wordArray, literal, i, "or")) {
+      // have total be the sequence of words before the current "or"
+      total = combination(total, andSequence(wordArray, literal, orAppearance+1, i, segs, positions), true);
       orAppearance = i;
     }
   }
   // then compare this sequence before the or with the sequence after the or
   // if no or appears, this is just the entire sequence
-  totalCounter = combination(totalCounter, andSequence(wordArray, orAppearance+1, size, ht), true);
-  return totalCounter;
+  total = combination(total, andSequence(wordArray, literal, orAppearance+1, size, segs, positions), true);
+  return total;
 
 }
 
 /*********************** andSequence() ***********************/
 /* Takes the char** wordArray for the query that is being evaluated,
- * the int firstIndex for the first index of the sequence and 
+ * with bool* literal for which of its tokens were quoted, the int
+ * firstIndex for the first index of the sequence and 
  * int lastIndex for the last index of the sequence, and the 
- * hashtable_t* ht from indexer
+ * segments_t* segs of the index from indexer, with the 
+ * positions_t* positions of its words (or NULL)
  *
- * Go through each word from the first index to the last index, 
- * using the combination method to add all words with an intersection
+ * Go through each word (or phrase) from the first index to the last 
+ * index, using the intersection method to keep only the documents 
+ * that every word is in, and stopping early once there are none
  *
- * return the totalCounter that contains all documents in the sequence
+ * return the total postings that contains all documents in the sequence
  * that share a word in the query
  */
-counters_t* andSequence(char** wordArray, int firstIndex, int lastIndex, hashtable_t* ht) {
+postings_t* andSequence(char** wordArray, bool* literal, int firstIndex, int lastIndex, segments_t* segs,
+                        positions_t* positions) {
   // make sure all the parameters are valid and that the first index is before the last index
-  if (wordArray == NULL || firstIndex < 0 || lastIndex < 0 || firstIndex > lastIndex || ht == NULL) {
+  if (wordArray == NULL || firstIndex < 0 || lastIndex < 0 || firstIndex > lastIndex || segs == NULL) {
     return NULL;
   }
 
-  counters_t* totalCounter = mem_assert(counters_new(), "totalCounter");
-  // have total counter be the sequence of words before the current word
-  totalCounter = combination(totalCounter, hashtable_find(ht, wordArray[firstIndex]), false);
-  for (int i = firstIndex + 1; i < lastIndex; i++) {
-    if(strcmp(wordArray[i], "and") != 0) {
-      // as long as the word is not "and", find the intersection the array and the current word
-      totalCounter = intersection(totalCounter, hashtable_find(ht, wordArray[i]));
+  // have total be the postings of the first word
+  postings_t* total = lookupToken(wordArray[firstIndex], segs, positions);
+  for (int i = firstIndex + 1; i < lastIndex && postings_length(total) > 0; i++) {
+    if(!isOperator(wordArray, literal, i, "and")) {
+      // as long as the word is not "and", find the intersection the total and the current word
+      postings_t* postings = lookupToken(wordArray[i], segs, positions);
+      total = intersection(total, postings);
+      postings_delete(postings);
     }
   }
-  return totalCounter;
+  return total;
 }
 
-/*********************** intersection() ***********************/
-/* Takes the two counters that want to find the intersection of
+/*********************** phraseSequence() ***********************/
+/* Takes the char* phrase, its words a space apart, the segments_t*
+ * segs of the index from indexer, and the positions_t* positions of
+ * its words
  *
- * Creates an allcounters struct from the intersection counter and
- * use it to compare the two counters while putting their intersection
- * into a third counter. Must iterate through both counters to do it
+ * Intersect the postings of the phrase's words first, the shortest
+ * first, so that the documents that lack any word cost nothing more;
+ * then read the positions of the documents left only, to find where
+ * the words are next to each other, in order. A word of fewer than
+ * three letters is not indexed, so it stands for any word in its
+ * place in the phrase
  *
- * return the counter that contains the counters that intersect
+ * return the postings of the documents the phrase is in, each scored
+ * by the number of times it is
  */
-counters_t* intersection(counters_t* ctrs1, counters_t* ctrs2) {
-  counters_t* intersection = mem_assert(counters_new(), "intersection");
-  struct allcounters counters = { intersection, ctrs2 };
-  counters_iterate(ctrs1, &counters, intersectionIterate);
-  counters_delete(ctrs1);
-  return intersection;
+postings_t* phraseSequence(char* phrase, segments_t* segs, positions_t* positions) {
+  if (phrase == NULL || segs == NULL || positions == NULL) {
+    return NULL;
+  }
+  // split a copy of the phrase into the words to look up, and where each is in the phrase
+  char* copy = mem_malloc_assert(strlen(phrase) + 1, "phrase");
+  strcpy(copy, phrase);
+  int room = strlen(copy) / 2 + 1;    // each word takes a letter and a space
+  const char** words = mem_malloc_assert(room * sizeof(char*), "phrase words");
+  int* offsets = mem_malloc_assert(room * sizeof(int), "phrase offsets");
+  postings_t** postings = mem_malloc_assert(room * sizeof(postings_t*), "phrase postings");
+  int numWords = 0;
+  int offset = 0;
+  for (char* word = strtok(copy, " "); word != NULL; word = strtok(NULL, " "), offset++) {
+    if (strlen(word) >= 3) {
+      words[numWords] = word;
+      offsets[numWords] = offset;
+      postings[numWords++] = mem_assert(segments_lookup(segs, word), "postings");
+    }
+  }
+
+  // the documents with every word, from the fewest up, and then those with the phrase
+  postings_t** order = mem_malloc_assert((numWords + 1) * sizeof(postings_t*), "phrase order");
+  memcpy(order, postings, numWords * sizeof(postings_t*));
+  qsort(order, numWords, sizeof(postings_t*), lengthCompare);
+  postings_t* candidates = mem_assert(postings_union(numWords > 0 ? order[0] : NULL, NULL), "candidates");
+  for (int i = 1; i < numWords && postings_length(candidates) > 0; i++) {
+    candidates = intersection(candidates, order[i]);
+  }
+  postings_t* total = candidates;
+  if (numWords > 0 && postings_length(candidates) > 0) {
+    total = mem_assert(positions_phrase(positions, words, offsets, numWords, candidates), "phrase");
+    postings_delete(candidates);
+  }
+
+  for (int i = 0; i < numWords; i++) {
+    postings_delete(postings[i]);
+  }
+  mem_free(order);
+  mem_free(postings);
+  mem_free(offsets);
+  mem_free(words);
+  mem_free(copy);
+  return total;
 }
 
-/*********************** combination() ***********************/
-/* Takes the two counters that want to find the combination of
- *
- * Creates an a counters struct for the combination of the two
- * other counters, then iterate through both counters and put 
- * them into the combination counter. After that delete the first
- * counter as it is no longer useful and delete the second counter
- * if specified.
+/*********************** isOperator() ***********************/
+/* Takes the char** wordArray of the query, the bool* literal of which
+ * of its tokens were quoted, the int i of a token, and the char*
+ * operator, "and" or "or"
  *
- * return the combination counter
+ * return true if the token is the operator: that word, not quoted
  */
-counters_t* combination(counters_t* ctrs1, counters_t* ctrs2, bool free) {
-  counters_t* combination = mem_assert(counters_new(), "combination");
-  counters_iterate(ctrs1, combination, combinationIterate);
-  counters_iterate(ctrs2, combination, combinationIterate);
-  counters_delete(ctrs1);
-  if (free) {
-    counters_delete(ctrs2);
-  }
-  return combination;
+static bool isOperator(char** wordArray, bool* literal, int i, const char* operator) {
+  return !literal[i] && strcmp(wordArray[i], operator) == 0;
 }
 
-/*********************** docsIterate() ***********************/
-/* itemfunc for the iteration in the querier method
+/*********************** lookupToken() ***********************/
+/* Takes a char* token of the query, a word or a phrase (with a
+ * space in it), the segments_t* segs of the index, and the
+ * positions_t* positions of its words
+ *
+ * return the postings of the documents the word or the phrase is in,
+ * which the caller must postings_delete
  */
-static void docsIterate(void *arg, const int key, const int count) {
-  int* num;
-  if ((num = arg) != NULL && key >=0 && count >=0) {
-    (*num)++;
+static postings_t* lookupToken(char* token, segments_t* segs, positions_t* positions) {
+  if (strchr(token, ' ') != NULL) {
+    return mem_assert(phraseSequence(token, segs, positions), "phrase");
   }
+  return mem_assert(segments_lookup(segs, token), "postings");
 }
 
-/*********************** countersArrayIterate() ***********************/
-/* itemfunc for the iteration in the querier method
+/*********************** intersection() ***********************/
+/* Takes the two postings that want to find the intersection of
+ *
+ * Walk both postings together in docID order, keeping each docID
+ * they share with the lesser of its two scores. Then delete the
+ * first postings as it is no longer useful
+ *
+ * return the postings that contains the documents that intersect
  */
-static void countersArrayIterate(void* arg, const int key, const int count) {
-  struct array* array = arg;
-  counters_t** countersarray = array->countersarray;
-  int* size = array->size;
-
-  countersarray[*size] = counters_new();
-  counters_set(countersarray[*size], key, count);
-  counters_t* add = countersarray[*size];
-
-  int index = *size - 1;
-  while(index >= 0) {
-    int count2 = 0;
-    counters_iterate(countersarray[index], &count2, countersCountersIterate);
-    if(count2 > count) {
-      break;
-    } else {
-      countersarray[index+1] = countersarray[index];
-      index--;
-    }
-  }
-  (*size)++;
-  countersarray[index + 1] = add;
+postings_t* intersection(postings_t* postings1, postings_t* postings2) {
+  postings_t* intersection = mem_assert(postings_intersect(postings1, postings2), "intersection");
+  postings_delete(postings1);
+  return intersection;
 }
 
-/*********************** countersCountersIterate() ***********************/
-/* itemfunc for the iteration in the countersArrayIterate method
+/*********************** combination() ***********************/
+/* Takes the two postings that want to find the combination of
+ *
+ * Walk both postings together in docID order, keeping every docID
+ * either has with the sum of its scores. After that delete the first
+ * postings as it is no longer useful and delete the second postings
+ * if specified.
+ *
+ * return the combination postings
  */
-static void countersCountersIterate(void* arg, const int key, const int count) {
-  int* num = arg;
-  if (num != NULL && key >=0 && count >=0) {
-    *num += count;
+postings_t* combination(postings_t* postings1, postings_t* postings2, bool free) {
+  postings_t* combination = mem_assert(postings_union(postings1, postings2), "combination");
+  postings_delete(postings1);
+  if (free) {
+    postings_delete(postings2);
   }
+  return combination;
 }
 
-/*********************** combinationIterate() ***********************/
-/* itemfunc for the iteration in the combination method
+/*********************** lengthCompare() ***********************/
+/* qsort comparator for phraseSequence: postings_t* by increasing
+ * length
  */
-static void combinationIterate(void* arg, const int key, const int count) {
-  counters_t* ctrs = arg;
-  int count2;
-  if ((count2 = counters_get(ctrs, key)) != 0) {
-    counters_set(ctrs, key, count + count2);
-  } else {
-    counters_set(ctrs, key, count);
-  }
+static int lengthCompare(const void* a, const void* b) {
+  int lengthA = postings_length(*(postings_t* const*) a);
+  int lengthB = postings_length(*(postings_t* const*) b);
+  return (lengthA > lengthB) - (lengthA < lengthB);
 }
 
-/*********************** intersectionIterate() ***********************/
-/* itemfunc for the iteration in the intersection method
+/*********************** matchCompare() ***********************/
+/* qsort comparator for printArray: by decreasing score, and among
+ * equal scores, by decreasing docID
  */
-static void intersectionIterate(void* arg, const int key, const int count) {
-  struct allcounters* allCounters= arg;
-  counters_t* totalCounter = allCounters->ctrs1;
-  counters_t* ctr2 = allCounters->ctrs2;
-  int count2;
-  if ((count2 = counters_get(ctr2, key)) == 0) {
-    counters_set(totalCounter, key, count2);
-  } else {
-    if (count > count2) {
-      counters_set(totalCounter, key, count2);
-    } else if (count <= count2) {
-      counters_set(totalCounter, key, count);
-    }
+static int matchCompare(const void* a, const void* b) {
+  const struct match* matchA = a;
+  const struct match* matchB = b;
+  if (matchA->score != matchB->score) {
+    return matchA->score < matchB->score ? 1 : -1;
   }
+  return (matchA->docID < matchB->docID) - (matchA->docID > matchB->docID);
 }
 
 /*********************** printArray() ***********************/
-/* Takes the array* array of pointers to the (docID, count) 
- * counters that match the query and the char* pageDirectory
- * where the documents with these docIDs exist
+/* Takes the postings_t* result of (docID, score) pairs that match
+ * the query and the struct docs* where the URLs of the documents
+ * with these docIDs are found
  *
- * Iterate through the now ordered array and print out each counters
- * information and the URL for the docs that match the query. 
+ * Sort the matches by score and print out each one's information
+ * and the URL for the docs that match the query. 
  * If there are no matches, print "No documents match."
  * 
  * Return nothing, just print statements
  */
-static void printArray(struct array* arrayPrint, char* pageDirectory) {
-  // get the information held by the array
-  struct array* array = arrayPrint;
-  counters_t** countersArray = array->countersarray;
-  int* num = array->size;
-
-  // if there are no counters meaning that there are no documents that represent the query...
-  if (*num <= 0) {
+static void printArray(postings_t* result, struct docs* docs) {
+  int num = postings_length(result);
+  // if there are no matches meaning that there are no documents that represent the query...
+  if (num <= 0) {
     printf("No documents match.\n");  // print no matches
-  } else {
-    printf("Matches %d documents (ranked):\n", *num);   // else print the ranked list of doc
-    for (int i = 0; i < *num; i++) {    // do this by iterating through each counter 
-      counters_iterate(countersArray[i], pageDirectory, printIterate);
-    }
+    return;
+  }
+  // gather the matches and rank them
+  const int* docIDs = postings_docIDs(result);
+  const int* scores = postings_counts(result);
+  struct match* matches = mem_malloc_assert(num * sizeof(struct match), "matches");
+  for (int i = 0; i < num; i++) {
+    matches[i] = (struct match) { docIDs[i], scores[i] };
   }
+  qsort(matches, num, sizeof(struct match), matchCompare);
+
+  printf("Matches %d documents (ranked):\n", num);   // else print the ranked list of doc
+  for (int i = 0; i < num; i++) {    // do this by going through each match
+    printIterate(docs, matches[i].docID, matches[i].score);
+  }
+  mem_free(matches);
 }
 
 /*********************** printIterate() ***********************/
-/* Takes arg which is a pageDirectory, key which is a docID, and 
+/* Takes arg which is a struct docs*, key which is a docID, and 
  * count which is used to keep track of the count of each counter
  *
- * Load files from pageDirectory and unique docID.
+ * Look the docID's URL up in the document table of its segment, or
+ * if there is none, read it from the pageDirectory.
  * Then print all query documents and their scores and information
  * 
  * Return nothing, only print
  */
 static void printIterate(void* arg, const int key, const int count) {
   if (arg != NULL && key >= 0 && count > 0) {
-    FILE* fp;
-    char* pageDirectory = arg;
-    char* filename = malloc((strlen(arg) + 10));  // alloate memory for the filename
-    sprintf(filename, "%s/%d", pageDirectory, key);  //the filename is of form pageDirectory/id
-    fp = fopen(filename, "r");
-    if (fp == NULL) { // if there is an error opening the file, free the memory and return null
-      free(filename);
-    } else {
-      char* URL = file_readLine(fp); // get URL is the top line of the file
+    struct docs* docs = arg;
+    docmeta_t* meta = segments_meta(docs->segs, key);
+    if (meta != NULL) {
+      const char* URL = docmeta_getURL(meta, key);  // an array lookup
+      if (URL != NULL) {
+        printf("score   %d doc   %d: %s\n", count, key, URL);
+      }
+      return;
+    }
+    char* URL = pagedir_getURL(docs->pageDirectory, key); // the URL is the top line of the page
+    if (URL != NULL) {
       printf("score   %d doc   %d: %s\n", count, key, URL);
-      fclose(fp);
-      free(filename);
       free(URL);
     }
   }
 }
-
-/*********************** deleteArray() ***********************/
-/* Parameters:
- *  array struct that we want to delete
- *
- * If the array is not NULL, call counters_delete on each
- * counter in the array of counters in the array
- * to delete the counters and then free the array.
- * If the array is NULL, simply do nothing as there
- * is no memory to free
- *
- * Return nothing
- */
-static void deleteArray(struct array* arrayDel) {
-  if (arrayDel != NULL) {
-    struct array* array = arrayDel;
-    counters_t** countersArray = array->countersarray;
-    int* size = array->size;
-    // loop through each counter in the counterArray and delete it
-    for(int i = 0; i < *size; i++) {
-      counters_delete(countersArray[i]);
-    }
-  }
-}
\ No newline at end of file
@@ -37,6 +37,42 @@
 ##### Successful Queries #####
 ./querier ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-3 ~/cs50-dev/shared/tse/output/indexer/index-letters-3 < successtest
 
+# the same queries, from a mapped binary copy of the index, should give the same results
+../indexer/indextest ~/cs50-dev/shared/tse/output/indexer/index-letters-3 index-letters-3.bin --binary
+./querier ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-3 index-letters-3.bin < successtest
+rm -f index-letters-3.bin
+
+# and from an index built as segments with --append
+../indexer/indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-3 index-letters-3.seg --append
+./querier ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-3 index-letters-3.seg < successtest
+rm -f index-letters-3.seg*
+
+# and from one appended to as its crawl grew, a page at a time, so that its segments merged
+mkdir testPages
+../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 3 -d 100 --max-pages 1
+../indexer/indexer testPages index-letters-3.inc --append
+for run in 2 3 4; do
+  ../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 3 -d 100 --resume --max-pages 1
+  ../indexer/indexer testPages index-letters-3.inc --append
+done
+../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ testPages 3 -d 100 --resume
+../indexer/indexer testPages index-letters-3.inc --append
+cat index-letters-3.inc
+../indexer/indexer testPages index-letters-3.full
+./querier testPages index-letters-3.full < successtest > successtest.full
+./querier testPages index-letters-3.inc < successtest > successtest.inc
+cmp successtest.full successtest.inc
+rm -rf testPages index-letters-3.inc* index-letters-3.full* successtest.full successtest.inc
+
+# phrases, from an index built with --positions, and an error without it
+../indexer/indexer ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-3 index-letters-3.phr --positions
+echo '"for the" or "search engine" and home' | ./querier ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-3 index-letters-3.phr
+echo '"for the"' | ./querier ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-3 ~/cs50-dev/shared/tse/output/indexer/index-letters-3
+# quoted, 'and' and 'or' are words to look up, wherever they are, not operators
+echo '"and"' | ./querier ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-3 index-letters-3.phr
+echo 'home "or" "and" or playground' | ./querier ~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-3 index-letters-3.phr
+rm -f index-letters-3.phr*
+
 ##### valgrind #####
 valgrind --leak-check=full --show-leak-kinds=all ./querier ~/cs50-dev/shared/tse/output/crawler/pages-wikipedia-depth-2 ~/cs50-dev/shared/tse/output/indexer/index-wikipedia-2 <valgrindtest
 